@@ -12,6 +12,17 @@
 #define SDIO2_D3  GPIO_NUM_8
 #define SDIO2_RST GPIO_NUM_15
 
+// microSDスロット（SDMMC 4bit）。SDIO2はWi-Fiコプロセッサとの接続に使われている
+#define SD_CARD_CLK GPIO_NUM_43
+#define SD_CARD_CMD GPIO_NUM_44
+#define SD_CARD_D0  GPIO_NUM_39
+#define SD_CARD_D1  GPIO_NUM_40
+#define SD_CARD_D2  GPIO_NUM_41
+#define SD_CARD_D3  GPIO_NUM_42
+
+// 1回のクエリで取得して重ねて描画できる系列の上限
+#define MAX_DATA_SOURCES 4
+
 // データソース設定構造体
 struct DataSourceConfig {
     String measurement;
@@ -34,6 +45,8 @@ struct GraphConfig {
     int graphWidth;
     int graphHeight;
     int gridLines;
+    float pointsPerPixel;  // 1ピクセル列あたりの取得点数（集計間隔の決定に使用）
+    int gapIntervals;      // この集計間隔数を超えて点が空いた場合は線を途切れさせる
     bool showGrid;
     bool showLegend;
 };
@@ -46,11 +59,28 @@ struct SystemConfig {
     int reconnectTimeoutSeconds;
     bool enableSerial;
     bool enableStatusDisplay;
+    bool enableLocalStore;  // 取得したデータをmicroSDに保存し、起動時に表示する
+    bool enablePushIngest;  // ラインプロトコルの書き込みを受け付け、即座にグラフへ反映する
+    int pushPort;
+    bool enableMetricsServer;  // 計測値をHTTPでテキストとして公開する（GET /metrics）
+    int metricsPort;
+    bool showMetricsOverlay;   // 起動時から計測値を画面に表示する（タイトルのタップで切り替え）
+    bool enableConfigServer;   // 設定をHTTPで読み書きできるようにする（GET/PUT /config）
+    int configPort;
+};
+
+// 設定の変更で影響を受ける範囲（反映する側は該当するものだけを作り直す）
+enum ConfigChange : uint32_t {
+    CONFIG_CHANGE_SOURCES = 1u << 0,     // 取得する系列（クエリの雛形とキャッシュ）
+    CONFIG_CHANGE_APPEARANCE = 1u << 1,  // 表示名・色・単位・タイトルなど（描き直しのみ）
+    CONFIG_CHANGE_LAYOUT = 1u << 2,      // グラフ領域・点の密度（描画バッファと集計間隔）
+    CONFIG_CHANGE_INTERVAL = 1u << 3,    // 更新間隔・既定の表示範囲
+    CONFIG_CHANGE_SERVICES = 1u << 4,    // Wi-Fiの再接続・各サーバ・microSDへの保存・ログ
 };
 
 class ConfigManager {
 private:
-    DataSourceConfig dataSource;
+    std::vector<DataSourceConfig> dataSources;  // 先頭が主系列（最新値の表示などに使用）
     GraphConfig graph;
     SystemConfig system;
     
@@ -58,17 +88,22 @@ public:
     ConfigManager();
     
     // 設定の取得
-    const DataSourceConfig& getDataSourceConfig() const { return dataSource; }
+    const DataSourceConfig& getDataSourceConfig() const { return dataSources[0]; }
+    const std::vector<DataSourceConfig>& getDataSources() const { return dataSources; }
     const GraphConfig& getGraphConfig() const { return graph; }
     const SystemConfig& getSystemConfig() const { return system; }
     
     // 設定の変更
     void setDataSource(const String& measurement, const String& field, const String& unit = "units");
+    bool addDataSource(const String& measurement, const String& field, const String& unit,
+                       const String& displayName, uint32_t color);
+    void clearAdditionalDataSources();
     void setGraphTitle(const String& title);
     void setGraphAxes(const String& xLabel, const String& yLabel);
     void setUpdateInterval(int minutes);
     void setDataRange(int hours);
     void setGraphArea(int x, int y, int width, int height);
+    void setPointDensity(float pointsPerPixel);
     void setAutoScale(bool enable);
     void setValueRange(float min, float max);
     
@@ -77,4 +112,20 @@ public:
     void loadHumidityConfig();
     void loadPowerConfig();
     void loadCustomConfig(const String& measurement, const String& field);
+    // 名前でプリセットを選ぶ（"power", "temperature", "humidity"）
+    bool loadPreset(const String& name);
+
+    // JSONでの読み書き（含まれている項目のみを変更し、"preset"があれば先に適用する）
+    // 検証に失敗した場合は何も変更せずにfalseを返す。changesには変更された範囲を返す
+    // 設定用サーバを有効から無効にする変更は受け付けない（無効にする場合は既定値を変えて書き込む）
+    String toJson() const;
+    bool updateFromJson(const char* json, uint32_t& changes, String& error);
+
+    // NVSへの保存と起動時の読み込み（保存が無い場合は既定値のまま）
+    bool load();
+    bool save() const;
+
+private:
+    bool validate(String& error) const;
+    static uint32_t compare(const ConfigManager& before, const ConfigManager& after);
 };
\ No newline at end of file
@@ -1,9 +1,28 @@
 #include "../include/ConfigManager.h"
-#include "../include/env.h"
+#include <env.h>
 #include <M5GFX.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "common/Logger.h"
+
+// 設定を保存するNVSの名前空間とキー
+static const char *NVS_NAMESPACE = "tab5hems";
+static const char *NVS_CONFIG_KEY = "config";
+
+// プリセットが読む測定名とフィールド名（env.hで上書きできる）
+#ifndef MEASUREMENT_NAME_ENVIRONMENT
+#define MEASUREMENT_NAME_ENVIRONMENT MEASUREMENT_NAME
+#endif
+#ifndef FIELD_NAME_TEMPERATURE
+#define FIELD_NAME_TEMPERATURE "temperature"
+#endif
+#ifndef FIELD_NAME_HUMIDITY
+#define FIELD_NAME_HUMIDITY "humidity"
+#endif
 
 ConfigManager::ConfigManager() {
     // デフォルト設定
+    DataSourceConfig dataSource;
     dataSource.measurement = MEASUREMENT_NAME;
     dataSource.field = FIELD_NAME_INSTANT_POWER_W;
     dataSource.unit = "W";
@@ -12,6 +31,7 @@ ConfigManager::ConfigManager() {
     dataSource.minRange = 0.0;
     dataSource.maxRange = 100.0;
     dataSource.autoScale = true;
+    dataSources.push_back(dataSource);
     
     graph.title = GRAPH_TITLE;
     graph.xAxisLabel = X_AXIS_LABEL;
@@ -21,6 +41,8 @@ ConfigManager::ConfigManager() {
     graph.graphWidth = 1080;
     graph.graphHeight = 380;
     graph.gridLines = 8;
+    graph.pointsPerPixel = 1.0f;
+    graph.gapIntervals = 3;
     graph.showGrid = true;
     graph.showLegend = true;
     
@@ -30,15 +52,50 @@ ConfigManager::ConfigManager() {
     system.reconnectTimeoutSeconds = 30;
     system.enableSerial = true;
     system.enableStatusDisplay = true;
+    system.enableLocalStore = true;
+    system.enablePushIngest = false;
+    system.pushPort = 8086;
+    system.enableMetricsServer = true;
+    system.metricsPort = 8080;
+    system.showMetricsOverlay = false;
+    system.enableConfigServer = true;
+    system.configPort = 80;
 }
 
 void ConfigManager::setDataSource(const String& measurement, const String& field, const String& unit) {
+    DataSourceConfig& dataSource = dataSources[0];
     dataSource.measurement = measurement;
     dataSource.field = field;
     dataSource.unit = unit;
     dataSource.displayName = field + " (" + unit + ")";
 }
 
+bool ConfigManager::addDataSource(const String& measurement, const String& field, const String& unit,
+                                  const String& displayName, uint32_t color) {
+    // 取得結果の列名にフィールド名を使うため、同じフィールドは重複して追加できない
+    if (dataSources.size() >= MAX_DATA_SOURCES) {
+        return false;
+    }
+    for (const auto& existing : dataSources) {
+        if (existing.field == field) {
+            return false;
+        }
+    }
+
+    DataSourceConfig dataSource = dataSources[0];
+    dataSource.measurement = measurement;
+    dataSource.field = field;
+    dataSource.unit = unit;
+    dataSource.displayName = displayName;
+    dataSource.color = color;
+    dataSources.push_back(dataSource);
+    return true;
+}
+
+void ConfigManager::clearAdditionalDataSources() {
+    dataSources.resize(1);
+}
+
 void ConfigManager::setGraphTitle(const String& title) {
     graph.title = title;
 }
@@ -63,14 +120,20 @@ void ConfigManager::setGraphArea(int x, int y, int width, int height) {
     graph.graphHeight = height;
 }
 
+void ConfigManager::setPointDensity(float pointsPerPixel) {
+    if (pointsPerPixel > 0) {
+        graph.pointsPerPixel = pointsPerPixel;
+    }
+}
+
 void ConfigManager::setAutoScale(bool enable) {
-    dataSource.autoScale = enable;
+    dataSources[0].autoScale = enable;
 }
 
 void ConfigManager::setValueRange(float min, float max) {
-    dataSource.minRange = min;
-    dataSource.maxRange = max;
-    dataSource.autoScale = false;
+    dataSources[0].minRange = min;
+    dataSources[0].maxRange = max;
+    dataSources[0].autoScale = false;
 }
 
 void ConfigManager::loadCustomConfig(const String& measurement, const String& field) {
@@ -78,5 +141,343 @@ void ConfigManager::loadCustomConfig(const String& measurement, const String& fi
     setGraphTitle(field + " Monitor");
     setGraphAxes("Time", field);
     setAutoScale(true);
-    dataSource.color = TFT_YELLOW;
-}
\ No newline at end of file
+    dataSources[0].color = TFT_YELLOW;
+}
+
+void ConfigManager::loadTemperatureConfig() {
+    clearAdditionalDataSources();
+    setDataSource(MEASUREMENT_NAME_ENVIRONMENT, FIELD_NAME_TEMPERATURE, "°C");
+    dataSources[0].displayName = "Temperature";
+    dataSources[0].color = TFT_ORANGE;
+    setValueRange(0.0f, 40.0f);
+    setGraphTitle("Temperature Monitor");
+    setGraphAxes("Time", "Temperature (°C)");
+}
+
+void ConfigManager::loadHumidityConfig() {
+    clearAdditionalDataSources();
+    setDataSource(MEASUREMENT_NAME_ENVIRONMENT, FIELD_NAME_HUMIDITY, "%");
+    dataSources[0].displayName = "Humidity";
+    dataSources[0].color = TFT_CYAN;
+    setValueRange(0.0f, 100.0f);
+    setGraphTitle("Humidity Monitor");
+    setGraphAxes("Time", "Humidity (%)");
+}
+
+void ConfigManager::loadPowerConfig() {
+    // 起動時の既定（瞬時電力）に戻す
+    clearAdditionalDataSources();
+    setDataSource(MEASUREMENT_NAME, FIELD_NAME_INSTANT_POWER_W, "W");
+    dataSources[0].displayName = "Sensor Data";
+    dataSources[0].color = TFT_YELLOW;
+    dataSources[0].minRange = 0.0f;
+    dataSources[0].maxRange = 100.0f;
+    setAutoScale(true);
+    setGraphTitle(GRAPH_TITLE);
+    setGraphAxes(X_AXIS_LABEL, Y_AXIS_LABEL);
+}
+
+bool ConfigManager::loadPreset(const String& name) {
+    if (name == "power") {
+        loadPowerConfig();
+    } else if (name == "temperature") {
+        loadTemperatureConfig();
+    } else if (name == "humidity") {
+        loadHumidityConfig();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// JSONの値が指定した型の場合のみ読み込む（含まれていない項目は元の値のまま）
+template <typename T>
+static void readValue(JsonVariantConst value, T& target) {
+    if (value.is<T>()) {
+        target = value.as<T>();
+    }
+}
+
+static void readValue(JsonVariantConst value, String& target) {
+    if (value.is<const char*>()) {
+        target = value.as<const char*>();
+    }
+}
+
+String ConfigManager::toJson() const {
+    JsonDocument doc;
+
+    JsonArray sources = doc["dataSources"].to<JsonArray>();
+    for (const auto& source : dataSources) {
+        JsonObject item = sources.add<JsonObject>();
+        item["measurement"] = source.measurement;
+        item["field"] = source.field;
+        item["unit"] = source.unit;
+        item["displayName"] = source.displayName;
+        item["color"] = source.color;
+        item["minRange"] = source.minRange;
+        item["maxRange"] = source.maxRange;
+        item["autoScale"] = source.autoScale;
+    }
+
+    JsonObject graphJson = doc["graph"].to<JsonObject>();
+    graphJson["title"] = graph.title;
+    graphJson["xAxisLabel"] = graph.xAxisLabel;
+    graphJson["yAxisLabel"] = graph.yAxisLabel;
+    graphJson["graphX"] = graph.graphX;
+    graphJson["graphY"] = graph.graphY;
+    graphJson["graphWidth"] = graph.graphWidth;
+    graphJson["graphHeight"] = graph.graphHeight;
+    graphJson["gridLines"] = graph.gridLines;
+    graphJson["pointsPerPixel"] = graph.pointsPerPixel;
+    graphJson["gapIntervals"] = graph.gapIntervals;
+    graphJson["showGrid"] = graph.showGrid;
+    graphJson["showLegend"] = graph.showLegend;
+
+    JsonObject systemJson = doc["system"].to<JsonObject>();
+    systemJson["updateIntervalMinutes"] = system.updateIntervalMinutes;
+    systemJson["dataHours"] = system.dataHours;
+    systemJson["enableWiFiReconnect"] = system.enableWiFiReconnect;
+    systemJson["reconnectTimeoutSeconds"] = system.reconnectTimeoutSeconds;
+    systemJson["enableSerial"] = system.enableSerial;
+    systemJson["enableStatusDisplay"] = system.enableStatusDisplay;
+    systemJson["enableLocalStore"] = system.enableLocalStore;
+    systemJson["enablePushIngest"] = system.enablePushIngest;
+    systemJson["pushPort"] = system.pushPort;
+    systemJson["enableMetricsServer"] = system.enableMetricsServer;
+    systemJson["metricsPort"] = system.metricsPort;
+    systemJson["showMetricsOverlay"] = system.showMetricsOverlay;
+    systemJson["enableConfigServer"] = system.enableConfigServer;
+    systemJson["configPort"] = system.configPort;
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+bool ConfigManager::updateFromJson(const char* json, uint32_t& changes, String& error) {
+    changes = 0;
+
+    JsonDocument doc;
+    DeserializationError parseError = deserializeJson(doc, json);
+    if (parseError) {
+        error = String("Invalid JSON: ") + parseError.c_str();
+        return false;
+    }
+
+    // 複製に適用して検証し、問題が無い場合のみ置き換える
+    ConfigManager next = *this;
+    if (doc["preset"].is<const char*>() && !next.loadPreset(doc["preset"].as<const char*>())) {
+        error = "Unknown preset";
+        return false;
+    }
+
+    // 系列は配列全体を置き換える（各項目で省略した値は同じ位置の現在の値を引き継ぐ）
+    if (doc["dataSources"].is<JsonArrayConst>()) {
+        JsonArrayConst sources = doc["dataSources"].as<JsonArrayConst>();
+        if (sources.size() < 1 || sources.size() > MAX_DATA_SOURCES) {
+            error = "dataSources must have 1 to " + String(MAX_DATA_SOURCES) + " entries";
+            return false;
+        }
+
+        std::vector<DataSourceConfig> updated;
+        for (JsonVariantConst item : sources) {
+            size_t index = updated.size();
+            DataSourceConfig source = next.dataSources[index < next.dataSources.size() ? index : 0];
+            readValue(item["measurement"], source.measurement);
+            readValue(item["field"], source.field);
+            readValue(item["unit"], source.unit);
+            readValue(item["displayName"], source.displayName);
+            readValue(item["color"], source.color);
+            readValue(item["minRange"], source.minRange);
+            readValue(item["maxRange"], source.maxRange);
+            readValue(item["autoScale"], source.autoScale);
+            updated.push_back(source);
+        }
+        next.dataSources.swap(updated);
+    }
+
+    JsonVariantConst graphJson = doc["graph"];
+    readValue(graphJson["title"], next.graph.title);
+    readValue(graphJson["xAxisLabel"], next.graph.xAxisLabel);
+    readValue(graphJson["yAxisLabel"], next.graph.yAxisLabel);
+    readValue(graphJson["graphX"], next.graph.graphX);
+    readValue(graphJson["graphY"], next.graph.graphY);
+    readValue(graphJson["graphWidth"], next.graph.graphWidth);
+    readValue(graphJson["graphHeight"], next.graph.graphHeight);
+    readValue(graphJson["gridLines"], next.graph.gridLines);
+    readValue(graphJson["pointsPerPixel"], next.graph.pointsPerPixel);
+    readValue(graphJson["gapIntervals"], next.graph.gapIntervals);
+    readValue(graphJson["showGrid"], next.graph.showGrid);
+    readValue(graphJson["showLegend"], next.graph.showLegend);
+
+    JsonVariantConst systemJson = doc["system"];
+    readValue(systemJson["updateIntervalMinutes"], next.system.updateIntervalMinutes);
+    readValue(systemJson["dataHours"], next.system.dataHours);
+    readValue(systemJson["enableWiFiReconnect"], next.system.enableWiFiReconnect);
+    readValue(systemJson["reconnectTimeoutSeconds"], next.system.reconnectTimeoutSeconds);
+    readValue(systemJson["enableSerial"], next.system.enableSerial);
+    readValue(systemJson["enableStatusDisplay"], next.system.enableStatusDisplay);
+    readValue(systemJson["enableLocalStore"], next.system.enableLocalStore);
+    readValue(systemJson["enablePushIngest"], next.system.enablePushIngest);
+    readValue(systemJson["pushPort"], next.system.pushPort);
+    readValue(systemJson["enableMetricsServer"], next.system.enableMetricsServer);
+    readValue(systemJson["metricsPort"], next.system.metricsPort);
+    readValue(systemJson["showMetricsOverlay"], next.system.showMetricsOverlay);
+    readValue(systemJson["enableConfigServer"], next.system.enableConfigServer);
+    readValue(systemJson["configPort"], next.system.configPort);
+
+    // 設定用サーバ自身を止めると書き込み直す手段が無くなるので、JSONからは無効にさせない
+    if (system.enableConfigServer && !next.system.enableConfigServer) {
+        error = "system.enableConfigServer cannot be disabled remotely";
+        return false;
+    }
+    if (!next.validate(error)) {
+        return false;
+    }
+
+    changes = compare(*this, next);
+    *this = next;
+    return true;
+}
+
+bool ConfigManager::validate(String& error) const {
+    for (size_t i = 0; i < dataSources.size(); i++) {
+        const auto& source = dataSources[i];
+        // 名前はFluxの文字列リテラルにそのまま埋め込むので引用符とエスケープは使えない
+        if (source.measurement.isEmpty() || source.field.isEmpty() ||
+            source.measurement.indexOf('"') >= 0 || source.measurement.indexOf('\\') >= 0 ||
+            source.field.indexOf('"') >= 0 || source.field.indexOf('\\') >= 0) {
+            error = "Invalid measurement or field in dataSources[" + String((int)i) + "]";
+            return false;
+        }
+        // 取得結果の列名にフィールド名を使うため、同じフィールドは重複できない
+        for (size_t j = 0; j < i; j++) {
+            if (dataSources[j].field == source.field) {
+                error = "Duplicate field: " + source.field;
+                return false;
+            }
+        }
+    }
+
+    if (graph.graphX < 0 || graph.graphY < 0 || graph.graphWidth < 100 || graph.graphHeight < 100 ||
+        graph.graphX + graph.graphWidth > DISPLAY_WIDTH ||
+        graph.graphY + graph.graphHeight > DISPLAY_HEIGHT) {
+        error = "Graph area must fit on the display";
+        return false;
+    }
+    if (graph.pointsPerPixel <= 0 || graph.pointsPerPixel > 8 || graph.gapIntervals < 0) {
+        error = "Invalid pointsPerPixel or gapIntervals";
+        return false;
+    }
+
+    if (system.updateIntervalMinutes < 1 || system.dataHours < 1 ||
+        system.reconnectTimeoutSeconds < 1) {
+        error = "Intervals must be positive";
+        return false;
+    }
+    // ミリ秒に直した時に溢れない範囲（1日まで）
+    if (system.updateIntervalMinutes > 1440) {
+        error = "Update interval must be at most 1440 minutes";
+        return false;
+    }
+    const int ports[] = {system.pushPort, system.metricsPort, system.configPort};
+    for (int i = 0; i < 3; i++) {
+        if (ports[i] < 1 || ports[i] > 65535) {
+            error = "Ports must be between 1 and 65535";
+            return false;
+        }
+        for (int j = 0; j < i; j++) {
+            if (ports[i] == ports[j]) {
+                error = "Each server needs its own port";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t ConfigManager::compare(const ConfigManager& before, const ConfigManager& after) {
+    uint32_t changes = 0;
+
+    if (before.dataSources.size() != after.dataSources.size()) {
+        changes |= CONFIG_CHANGE_SOURCES;
+    }
+    for (size_t i = 0; i < before.dataSources.size() && i < after.dataSources.size(); i++) {
+        const auto& a = before.dataSources[i];
+        const auto& b = after.dataSources[i];
+        if (a.measurement != b.measurement || a.field != b.field) {
+            changes |= CONFIG_CHANGE_SOURCES;
+        }
+        if (a.unit != b.unit || a.displayName != b.displayName || a.color != b.color ||
+            a.minRange != b.minRange || a.maxRange != b.maxRange || a.autoScale != b.autoScale) {
+            changes |= CONFIG_CHANGE_APPEARANCE;
+        }
+    }
+
+    const GraphConfig& g0 = before.graph;
+    const GraphConfig& g1 = after.graph;
+    if (g0.title != g1.title || g0.xAxisLabel != g1.xAxisLabel || g0.yAxisLabel != g1.yAxisLabel ||
+        g0.gridLines != g1.gridLines || g0.showGrid != g1.showGrid ||
+        g0.showLegend != g1.showLegend) {
+        changes |= CONFIG_CHANGE_APPEARANCE;
+    }
+    if (g0.graphX != g1.graphX || g0.graphY != g1.graphY || g0.graphWidth != g1.graphWidth ||
+        g0.graphHeight != g1.graphHeight || g0.pointsPerPixel != g1.pointsPerPixel ||
+        g0.gapIntervals != g1.gapIntervals) {
+        changes |= CONFIG_CHANGE_LAYOUT;
+    }
+
+    const SystemConfig& s0 = before.system;
+    const SystemConfig& s1 = after.system;
+    if (s0.updateIntervalMinutes != s1.updateIntervalMinutes || s0.dataHours != s1.dataHours) {
+        changes |= CONFIG_CHANGE_INTERVAL;
+    }
+    if (s0.enableWiFiReconnect != s1.enableWiFiReconnect ||
+        s0.reconnectTimeoutSeconds != s1.reconnectTimeoutSeconds ||
+        s0.enableSerial != s1.enableSerial || s0.enableStatusDisplay != s1.enableStatusDisplay ||
+        s0.enableLocalStore != s1.enableLocalStore || s0.enablePushIngest != s1.enablePushIngest ||
+        s0.pushPort != s1.pushPort || s0.enableMetricsServer != s1.enableMetricsServer ||
+        s0.metricsPort != s1.metricsPort || s0.showMetricsOverlay != s1.showMetricsOverlay ||
+        s0.enableConfigServer != s1.enableConfigServer || s0.configPort != s1.configPort) {
+        changes |= CONFIG_CHANGE_SERVICES;
+    }
+    return changes;
+}
+
+bool ConfigManager::load() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {
+        return false;
+    }
+    String json = prefs.getString(NVS_CONFIG_KEY, "");
+    prefs.end();
+    if (json.isEmpty()) {
+        return false;
+    }
+
+    // 保存後にファームウェアの既定や検証が変わった場合は、保存された設定を使わない
+    uint32_t changes;
+    String error;
+    if (!updateFromJson(json.c_str(), changes, error)) {
+        LOG_W("Stored configuration ignored: %s", error.c_str());
+        return false;
+    }
+    LOG_I("Configuration loaded from NVS");
+    return true;
+}
+
+bool ConfigManager::save() const {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        LOG_E("Failed to open NVS for configuration");
+        return false;
+    }
+    String json = toJson();
+    bool saved = prefs.putString(NVS_CONFIG_KEY, json) == json.length();
+    prefs.end();
+    if (!saved) {
+        LOG_E("Failed to save configuration (%u bytes)", (unsigned)json.length());
+    }
+    return saved;
+}
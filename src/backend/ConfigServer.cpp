@@ -0,0 +1,262 @@
+#include "ConfigServer.h"
+#include <string.h>
+#include <strings.h>
+#include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
+#include "../common/TokenAuth.h"
+
+// GET / で返す編集画面（現在の設定を読み込み、書き換えてPUTする）
+static const char CONFIG_PAGE[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>tab5_hems config</title></head>"
+    "<body style=\"font-family:sans-serif\"><h3>Configuration</h3>"
+    "<p>Token: <input id=\"t\" type=\"password\" size=\"40\"></p>"
+    "<p>Presets: <button onclick=\"send('{&quot;preset&quot;:&quot;power&quot;}')\">power</button>"
+    " <button onclick=\"send('{&quot;preset&quot;:&quot;temperature&quot;}')\">temperature</button>"
+    " <button onclick=\"send('{&quot;preset&quot;:&quot;humidity&quot;}')\">humidity</button></p>"
+    "<textarea id=\"c\" rows=\"40\" cols=\"80\"></textarea><br>"
+    "<button onclick=\"send(document.getElementById('c').value)\">Apply</button>"
+    " <span id=\"s\"></span><script>"
+    "function show(t){try{t=JSON.stringify(JSON.parse(t),null,2)}catch(e){}"
+    "document.getElementById('c').value=t}"
+    "function send(b){fetch('/config',{method:'PUT',body:b,"
+    "headers:{Authorization:'Token '+document.getElementById('t').value}})"
+    ".then(r=>r.text().then(t=>{"
+    "document.getElementById('s').textContent=r.ok?'Applied':t;if(r.ok)show(t)}))}"
+    "fetch('/config').then(r=>r.text()).then(show)"
+    "</script></body></html>";
+
+ConfigServer::ConfigServer()
+    : config(nullptr), handler(nullptr), server(nullptr), serverPort(0), state(STATE_IDLE),
+      route(ROUTE_NOT_FOUND), clientMillis(0), pendingMillis(0), bodyLength(0), bodyReceived(0),
+      lineLength(0), lineOverflow(false), authorized(false) {}
+
+ConfigServer::~ConfigServer() { end(); }
+
+void ConfigServer::setConfig(ConfigManager *configManager) { config = configManager; }
+
+void ConfigServer::setHandler(ApplyHandler applyHandler) { handler = applyHandler; }
+
+bool ConfigServer::begin() {
+    if (server) {
+        return true;
+    }
+    if (!config || !config->getSystemConfig().enableConfigServer) {
+        return false;
+    }
+
+    serverPort = config->getSystemConfig().configPort;
+    server = new WiFiServer(serverPort);
+    server->begin();
+    LOG_I("Configuration available at http://%s:%d/", WiFi.localIP().toString().c_str(),
+          serverPort);
+    return true;
+}
+
+void ConfigServer::end() {
+    if (state != STATE_IDLE) {
+        client.stop();
+        state = STATE_IDLE;
+    }
+    if (server) {
+        server->end();
+        delete server;
+        server = nullptr;
+    }
+}
+
+void ConfigServer::poll() {
+    if (!server) {
+        return;
+    }
+
+    if (state == STATE_IDLE) {
+        client = server->accept();
+        if (!client) {
+            return;
+        }
+        state = STATE_REQUEST_LINE;
+        route = ROUTE_NOT_FOUND;
+        clientMillis = millis();
+        bodyLength = 0;
+        bodyReceived = 0;
+        lineLength = 0;
+        lineOverflow = false;
+        authorized = false;
+    }
+
+    // 取得タスクの更新中で反映できなかった設定は、ここで試し直す
+    if (state == STATE_PENDING) {
+        handleRequest();
+    }
+
+    // 届いている分だけ読み、残りは次のpoll()で続きから読む
+    while (state != STATE_IDLE && state != STATE_PENDING && client.available() > 0) {
+        if (state == STATE_BODY) {
+            int n = client.read((uint8_t *)body + bodyReceived, bodyLength - bodyReceived);
+            if (n <= 0) {
+                break;
+            }
+            bodyReceived += n;
+            if (bodyReceived >= bodyLength) {
+                body[bodyReceived] = '\0';
+                handleRequest();
+            }
+            continue;
+        }
+
+        char c = (char)client.read();
+        if (c == '\n') {
+            handleLine();
+        } else if (c != '\r') {
+            if (lineLength < LINE_SIZE - 1) {
+                line[lineLength++] = c;
+            } else {
+                lineOverflow = true;
+            }
+        }
+    }
+
+    if (state == STATE_PENDING && !client.connected()) {
+        LOG_W("Config request closed before it was applied");
+        client.stop();
+        state = STATE_IDLE;
+    } else if (state != STATE_IDLE && state != STATE_PENDING &&
+               (!client.connected() || millis() - clientMillis > CLIENT_TIMEOUT_MS)) {
+        LOG_W("Config request timed out");
+        client.stop();
+        state = STATE_IDLE;
+    }
+
+    // 応答を返し終えてから、ポートや有効/無効の変更を反映する
+    if (state == STATE_IDLE) {
+        restartIfChanged();
+    }
+}
+
+void ConfigServer::handleLine() {
+    line[lineLength] = '\0';
+    bool overflow = lineOverflow;
+    lineLength = 0;
+    lineOverflow = false;
+
+    switch (state) {
+        case STATE_REQUEST_LINE:
+            parseRequestLine();
+            state = STATE_HEADERS;
+            break;
+
+        case STATE_HEADERS:
+            if (line[0] != '\0') {
+                if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                    bodyLength = strtoul(line + 15, nullptr, 10);
+                } else if (strncasecmp(line, "Authorization:", 14) == 0) {
+                    authorized = !overflow && TokenAuth::check(line + 14);
+                }
+                break;
+            }
+            // ヘッダの終わり（変更は本文を受け取る前に認証する）
+            if (route == ROUTE_PUT_CONFIG && !authorized) {
+                LOG_W_EVERY(10000, "Config request rejected: missing or wrong token");
+                static const char message[] = "Missing or wrong token";
+                respond(401, "Unauthorized", "text/plain", message, sizeof(message) - 1);
+            } else if (route == ROUTE_PUT_CONFIG && bodyLength > MAX_BODY_SIZE) {
+                respond(413, "Payload Too Large", "text/plain", "", 0);
+            } else if (route == ROUTE_PUT_CONFIG && bodyLength > 0) {
+                state = STATE_BODY;
+            } else {
+                body[0] = '\0';
+                handleRequest();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ConfigServer::parseRequestLine() {
+    if (strncmp(line, "GET / ", 6) == 0) {
+        route = ROUTE_PAGE;
+    } else if (strncmp(line, "GET /config ", 12) == 0) {
+        route = ROUTE_GET_CONFIG;
+    } else if (strncmp(line, "PUT /config ", 12) == 0 || strncmp(line, "POST /config ", 13) == 0) {
+        route = ROUTE_PUT_CONFIG;
+    } else {
+        route = ROUTE_NOT_FOUND;
+    }
+}
+
+void ConfigServer::handleRequest() {
+    switch (route) {
+        case ROUTE_PAGE:
+            respond(200, "OK", "text/html; charset=utf-8", CONFIG_PAGE, sizeof(CONFIG_PAGE) - 1);
+            break;
+
+        case ROUTE_GET_CONFIG: {
+            String json = config->toJson();
+            respond(200, "OK", "application/json", json.c_str(), json.length());
+            break;
+        }
+
+        case ROUTE_PUT_CONFIG: {
+            String error;
+            ApplyResult result = APPLY_REJECTED;
+            if (!handler) {
+                error = "Configuration is read-only";
+            } else if (bodyLength == 0) {
+                error = "Empty request body";
+            } else {
+                result = handler(body, error);
+            }
+
+            if (result == APPLY_OK) {
+                // 反映後の設定全体を返す
+                String json = config->toJson();
+                respond(200, "OK", "application/json", json.c_str(), json.length());
+                break;
+            }
+            if (result == APPLY_BUSY) {
+                // 応答は反映できるまで返さない（長く待たされた場合のみ諦める）
+                if (state != STATE_PENDING) {
+                    state = STATE_PENDING;
+                    pendingMillis = millis();
+                } else if (millis() - pendingMillis > APPLY_TIMEOUT_MS) {
+                    LOG_W("Configuration could not be applied in time");
+                    respond(503, "Service Unavailable", "text/plain", "", 0);
+                }
+                break;
+            }
+            LOG_W("Configuration rejected: %s", error.c_str());
+            respond(400, "Bad Request", "text/plain; charset=utf-8", error.c_str(), error.length());
+            break;
+        }
+
+        default:
+            respond(404, "Not Found", "text/plain", "", 0);
+            break;
+    }
+}
+
+void ConfigServer::respond(int status, const char *reason, const char *contentType,
+                           const char *content, size_t length) {
+    client.printf("HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                  "Connection: close\r\n\r\n",
+                  status, reason, contentType, (unsigned)length);
+    if (length > 0) {
+        client.write((const uint8_t *)content, length);
+    }
+    client.stop();
+    state = STATE_IDLE;
+}
+
+void ConfigServer::restartIfChanged() {
+    if (!config) {
+        return;
+    }
+
+    const auto &systemConfig = config->getSystemConfig();
+    if (server && (!systemConfig.enableConfigServer || systemConfig.configPort != serverPort)) {
+        end();
+        begin();
+    }
+}
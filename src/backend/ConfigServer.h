@@ -0,0 +1,79 @@
+#pragma once
+
+#include <WiFi.h>
+
+class ConfigManager; // 前方宣言
+
+// LAN内から設定をJSONで読み書きするHTTPサーバ
+// GET /config で現在の設定、PUT/POST /config で変更（含まれている項目のみ）、GET / で簡易な編集画面
+// 変更の反映は呼び出し側のハンドラで行い、ポートや有効/無効が変わった場合は応答後に自身を再起動する
+// 変更にはInfluxDBと同じ「Authorization: Token <トークン>」が必要（トークンはINFLUXDB_TOKEN）
+// loop()から呼ぶpoll()は待たずに戻り、1接続ずつ少しずつ読み進める
+// ハンドラがすぐに反映できない場合は、受信した設定を保持して次のpoll()で反映を試し直す
+class ConfigServer {
+public:
+    enum ApplyResult {
+        APPLY_OK,
+        APPLY_REJECTED,  // 設定の誤り（errorに理由を入れる）
+        APPLY_BUSY,      // 今は反映できない（次のpoll()で呼び直す）
+    };
+    // 設定の変更を反映するハンドラ
+    typedef ApplyResult (*ApplyHandler)(const char* json, String& error);
+
+private:
+    static const size_t LINE_SIZE = 256;
+    static const size_t MAX_BODY_SIZE = 4096;
+    static const unsigned long CLIENT_TIMEOUT_MS = 2000;
+    // 反映を待つ最長時間（取得タスクのクエリ1回分より長くする）
+    static const unsigned long APPLY_TIMEOUT_MS = 30000;
+
+    enum State {
+        STATE_IDLE,
+        STATE_REQUEST_LINE,
+        STATE_HEADERS,
+        STATE_BODY,
+        STATE_PENDING,  // 受信済みの設定の反映待ち
+    };
+
+    enum Route {
+        ROUTE_NOT_FOUND,
+        ROUTE_PAGE,
+        ROUTE_GET_CONFIG,
+        ROUTE_PUT_CONFIG,
+    };
+
+    ConfigManager* config;
+    ApplyHandler handler;
+    WiFiServer* server;
+    int serverPort;
+    WiFiClient client;
+    State state;
+    Route route;
+    unsigned long clientMillis;
+    unsigned long pendingMillis;
+    size_t bodyLength;
+    size_t bodyReceived;
+    char line[LINE_SIZE];
+    size_t lineLength;
+    bool lineOverflow;    // 現在の行がLINE_SIZEを超えて切り詰められたか
+    bool authorized;      // Authorizationヘッダのトークンが一致したか
+    char body[MAX_BODY_SIZE + 1];  // 要求の本文（設定のJSON）
+
+    void handleLine();
+    void parseRequestLine();
+    void handleRequest();
+    void respond(int status, const char* reason, const char* contentType, const char* content,
+                 size_t length);
+    void restartIfChanged();
+
+public:
+    ConfigServer();
+    ~ConfigServer();
+    void setConfig(ConfigManager* configManager);
+    void setHandler(ApplyHandler applyHandler);
+
+    // Wi-Fiの接続後に呼ぶ（設定で無効な場合は何もしない）
+    bool begin();
+    void end();
+    void poll();
+};
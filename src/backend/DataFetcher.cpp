@@ -0,0 +1,110 @@
+#include "DataFetcher.h"
+#include "InfluxDBManager.h"
+#include "../common/Logger.h"
+
+// UIのloop()はコア1で動くため、取得処理はもう一方のコアで実行する
+static const BaseType_t FETCH_TASK_CORE = 0;
+static const uint32_t FETCH_TASK_STACK = 16384;
+static const UBaseType_t FETCH_TASK_PRIORITY = 1;
+
+// 連続したボタン操作をまとめるための待ち時間
+static const uint32_t COALESCE_DELAY_MS = 150;
+
+DataFetcher::DataFetcher()
+    : influx(nullptr), task(nullptr), busy(nullptr), requestedHours(0), requestSeq(0), completedSeq(0) {}
+
+bool DataFetcher::begin(InfluxDBManager *manager) {
+    influx = manager;
+    if (task) {
+        return true;
+    }
+
+    if (!busy) {
+        busy = xSemaphoreCreateMutex();
+    }
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "DataFetcher", FETCH_TASK_STACK, this,
+                                                 FETCH_TASK_PRIORITY, &task, FETCH_TASK_CORE);
+    if (created != pdPASS) {
+        task = nullptr;
+        LOG_E("Failed to start data fetch task");
+        return false;
+    }
+    return true;
+}
+
+uint32_t DataFetcher::request(int hours) {
+    requestedHours.store(hours);
+    uint32_t id = requestSeq.fetch_add(1) + 1;
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+    return id;
+}
+
+bool DataFetcher::poll(FetchResult &result) {
+    if (!results.update()) {
+        return false;
+    }
+
+    FetchResult &latest = results.read();
+    result.requestId = latest.requestId;
+    result.hours = latest.hours;
+    result.aggregateSeconds = latest.aggregateSeconds;
+    result.series.swap(latest.series);
+    result.monthlyUsage = latest.monthlyUsage;
+    result.hasMonthlyUsage = latest.hasMonthlyUsage;
+    result.ok = latest.ok;
+    return true;
+}
+
+bool DataFetcher::isBusy() const { return completedSeq.load() != requestSeq.load(); }
+
+bool DataFetcher::tryLock() {
+    return !busy || xSemaphoreTake(busy, 0) == pdTRUE;
+}
+
+void DataFetcher::unlock() {
+    if (busy) {
+        xSemaphoreGive(busy);
+    }
+}
+
+void DataFetcher::taskEntry(void *arg) {
+    static_cast<DataFetcher *>(arg)->run();
+}
+
+void DataFetcher::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // 続けて届いた要求を待ってから、最新の要求だけを実行する
+        vTaskDelay(pdMS_TO_TICKS(COALESCE_DELAY_MS));
+        ulTaskNotifyTake(pdTRUE, 0);
+
+        uint32_t id = requestSeq.load();
+        int hours = requestedHours.load();
+
+        FetchResult &result = results.write();
+        result.requestId = id;
+        result.hours = hours;
+        xSemaphoreTake(busy, portMAX_DELAY);
+        result.aggregateSeconds = influx->getAggregateSeconds(hours);
+        result.hasMonthlyUsage = influx->refresh(hours, result.series, result.monthlyUsage);
+        result.ok = influx->lastRefreshSucceeded();
+        xSemaphoreGive(busy);
+
+        // 実行中に新しい要求が来た場合は結果を捨てて次の要求を処理する
+        if (requestSeq.load() != id) {
+            continue;
+        }
+
+        bool ok = result.ok;
+        results.publish();
+        completedSeq.store(id);
+
+        // 長い時間範囲の過去分が残っている場合は、UIからの要求を待たずに続けて取得する
+        if (ok && influx->hasPendingBackfill(hours)) {
+            xTaskNotifyGive(task);
+        }
+    }
+}
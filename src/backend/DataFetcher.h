@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "DataPoint.h"
+#include "TripleBuffer.h"
+
+class InfluxDBManager; // 前方宣言
+
+// ワーカーからUIへ渡す取得結果
+struct FetchResult {
+    uint32_t requestId;
+    int hours;
+    int aggregateSeconds;
+    SeriesSet series;
+    float monthlyUsage;
+    bool hasMonthlyUsage;
+    bool ok;  // クエリが成功したか（失敗時のseriesはキャッシュ済みの分のみ）
+};
+
+// InfluxDBからの取得をUIとは別コアのFreeRTOSタスクで実行する
+// 短時間に複数の要求が来た場合は最後の要求だけを実行する
+class DataFetcher {
+private:
+    InfluxDBManager* influx;
+    TaskHandle_t task;
+    SemaphoreHandle_t busy;  // 取得中はタスクが保持する
+    std::atomic<int> requestedHours;
+    std::atomic<uint32_t> requestSeq;
+    std::atomic<uint32_t> completedSeq;
+    TripleBuffer<FetchResult> results;
+
+    static void taskEntry(void* arg);
+    void run();
+
+public:
+    DataFetcher();
+    bool begin(InfluxDBManager* manager);
+
+    // UI側から呼び出す
+    uint32_t request(int hours);
+    bool poll(FetchResult& result);
+    bool isBusy() const;
+    // 取得タスクが参照する設定を書き換える間、取得を止める
+    // 待たずに戻り、取得の実行中はfalseを返す（UIを止めないよう呼び出し側で後から試し直す）
+    bool tryLock();
+    void unlock();
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// 集計済みデータ点（エポック秒 + 平均/最小/最大）
+// 1点16バイトの固定長で、文字列への変換はラベル表示時のみ行う
+struct DataPoint {
+    int32_t time;
+    float value;  // 集計ウィンドウ内の平均
+    float min;
+    float max;
+};
+
+// 受信した1点とその系列（設定のデータソースの番号）
+struct LivePoint {
+    int seriesIndex;
+    DataPoint point;
+};
+
+// 系列ごとの点列（並びは設定のデータソース順、時刻軸は全系列で共通）
+typedef std::vector<std::vector<DataPoint>> SeriesSet;
@@ -0,0 +1,69 @@
+#include "FluxBatch.h"
+#include <string.h>
+
+FluxBatch::FluxBatch() { clear(); }
+
+void FluxBatch::clear() {
+    partCount = 0;
+    importCount = 0;
+    resultColumn = -1;
+}
+
+void FluxBatch::addImport(const char *package) {
+    for (int i = 0; i < importCount; i++) {
+        if (strcmp(imports[i], package) == 0) {
+            return;
+        }
+    }
+    if (importCount < MAX_IMPORTS) {
+        imports[importCount++] = package;
+    }
+}
+
+bool FluxBatch::add(const FluxTemplate &queryTemplate, const FluxParams &params,
+                    FluxCsvParser::RowHandler handler, void *context) {
+    if (partCount >= MAX_PARTS) {
+        return false;
+    }
+
+    parts[partCount].queryTemplate = &queryTemplate;
+    parts[partCount].params = params;
+    parts[partCount].handler = handler;
+    parts[partCount].context = context;
+    partCount++;
+    return true;
+}
+
+bool FluxBatch::build(FluxWriter &out) const {
+    // importはスクリプトの先頭にまとめる必要がある
+    for (int i = 0; i < importCount; i++) {
+        out.append("import \"");
+        out.append(imports[i]);
+        out.append("\"\n");
+    }
+
+    for (int i = 0; i < partCount; i++) {
+        const Part &part = parts[i];
+        part.queryTemplate->render(out, part.params);
+        out.append(" |> yield(name: \"");
+        out.append(part.params.name);
+        out.append("\")\n");
+    }
+    return !out.overflowed();
+}
+
+void FluxBatch::attach(FluxCsvParser &parser) {
+    resultColumn = parser.addColumn("result");
+    parser.setRowHandler(route, this);
+}
+
+void FluxBatch::route(void *context, const FluxCsvParser &parser) {
+    FluxBatch *batch = static_cast<FluxBatch *>(context);
+    const char *result = parser.getText(batch->resultColumn);
+    for (int i = 0; i < batch->partCount; i++) {
+        if (strcmp(result, batch->parts[i].params.name) == 0) {
+            batch->parts[i].handler(batch->parts[i].context, parser);
+            return;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FluxCsvParser.h"
+#include "FluxTemplate.h"
+
+// 複数の取得を1つのFluxスクリプトにまとめ、応答の行をyield名（result列）で振り分ける
+// 1回の更新に必要なクエリを1往復で実行するために使う
+class FluxBatch {
+public:
+    static const int MAX_PARTS = 6;
+    static const int MAX_IMPORTS = 4;
+
+private:
+    struct Part {
+        const FluxTemplate* queryTemplate;
+        FluxParams params;
+        FluxCsvParser::RowHandler handler;
+        void* context;
+    };
+
+    Part parts[MAX_PARTS];
+    int partCount;
+    const char* imports[MAX_IMPORTS];
+    int importCount;
+    int resultColumn;
+
+    static void route(void* context, const FluxCsvParser& parser);
+
+public:
+    FluxBatch();
+    void clear();
+
+    void addImport(const char* package);
+    // 雛形はテーブルのストリームを返す式（前置きの代入文を含んでもよい）
+    // 末尾にyield(name: params.name)を付けて追加し、その結果の行をhandlerへ渡す
+    // paramsの文字列はbuild()まで保持されている必要がある
+    bool add(const FluxTemplate& queryTemplate, const FluxParams& params,
+             FluxCsvParser::RowHandler handler, void* context);
+
+    bool isEmpty() const { return partCount == 0; }
+    int size() const { return partCount; }
+    // スクリプトをoutへ書き込む（入りきらない場合はfalse）
+    bool build(FluxWriter& out) const;
+
+    // パーサにresult列を登録し、行ハンドラを振り分け用に設定する
+    void attach(FluxCsvParser& parser);
+};
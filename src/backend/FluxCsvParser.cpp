@@ -0,0 +1,264 @@
+#include "FluxCsvParser.h"
+#include <stdlib.h>
+#include <string.h>
+
+FluxCsvParser::FluxCsvParser() { begin(); }
+
+void FluxCsvParser::begin() {
+    columnCount = 0;
+    handler = nullptr;
+    handlerContext = nullptr;
+    for (int i = 0; i < MAX_CSV_COLUMNS; i++) {
+        columnSlots[i] = -1;
+    }
+    errorColumn = -1;
+    expectHeader = true;
+    headerRow = false;
+    rowCount = 0;
+    error[0] = '\0';
+    resetLine();
+}
+
+int FluxCsvParser::addColumn(const char *name) {
+    if (columnCount >= MAX_COLUMNS) {
+        return -1;
+    }
+    columnNames[columnCount] = name;
+    return columnCount++;
+}
+
+void FluxCsvParser::setRowHandler(RowHandler rowHandler, void *context) {
+    handler = rowHandler;
+    handlerContext = context;
+}
+
+void FluxCsvParser::resetLine() {
+    state = FIELD_START;
+    csvColumn = 0;
+    fieldLength = 0;
+    lineEmpty = true;
+    lineIsAnnotation = false;
+    for (int i = 0; i < MAX_COLUMNS; i++) {
+        cellPresent[i] = false;
+    }
+}
+
+void FluxCsvParser::feed(const char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+
+        // 行頭で行の種類（空行/注釈/ヘッダ/データ）を判定
+        if (lineEmpty) {
+            if (c == '\r') {
+                continue;
+            }
+            if (c == '\n') {
+                endLine();
+                continue;
+            }
+            lineEmpty = false;
+            if (c == '#') {
+                lineIsAnnotation = true;
+            } else {
+                headerRow = expectHeader;
+                if (headerRow) {
+                    for (int j = 0; j < MAX_CSV_COLUMNS; j++) {
+                        columnSlots[j] = -1;
+                    }
+                    errorColumn = -1;
+                }
+            }
+        }
+
+        // 注釈行は読み飛ばす
+        if (lineIsAnnotation) {
+            if (c == '\n') {
+                endLine();
+            }
+            continue;
+        }
+
+        switch (state) {
+        case FIELD_START:
+            if (c == '"') {
+                state = QUOTED;
+            } else if (c == ',') {
+                endField();
+            } else if (c == '\n') {
+                endLine();
+            } else if (c != '\r') {
+                if (fieldLength < CELL_SIZE - 1) {
+                    field[fieldLength++] = c;
+                }
+                state = UNQUOTED;
+            }
+            break;
+        case UNQUOTED:
+            if (c == ',') {
+                endField();
+                state = FIELD_START;
+            } else if (c == '\n') {
+                endLine();
+            } else if (c != '\r' && fieldLength < CELL_SIZE - 1) {
+                field[fieldLength++] = c;
+            }
+            break;
+        case QUOTED:
+            if (c == '"') {
+                state = QUOTE_IN_QUOTED;
+            } else if (fieldLength < CELL_SIZE - 1) {
+                field[fieldLength++] = c;
+            }
+            break;
+        case QUOTE_IN_QUOTED:
+            if (c == '"') {
+                // "" はエスケープされた引用符
+                if (fieldLength < CELL_SIZE - 1) {
+                    field[fieldLength++] = c;
+                }
+                state = QUOTED;
+            } else if (c == ',') {
+                endField();
+                state = FIELD_START;
+            } else if (c == '\n') {
+                endLine();
+            }
+            break;
+        }
+    }
+}
+
+void FluxCsvParser::finish() {
+    // 改行で終わっていない最終行を処理
+    if (!lineEmpty) {
+        endLine();
+    }
+}
+
+void FluxCsvParser::endField() {
+    field[fieldLength] = '\0';
+
+    if (csvColumn < MAX_CSV_COLUMNS) {
+        if (headerRow) {
+            for (int i = 0; i < columnCount; i++) {
+                if (strcmp(field, columnNames[i]) == 0) {
+                    columnSlots[csvColumn] = i;
+                    break;
+                }
+            }
+            if (strcmp(field, "error") == 0) {
+                errorColumn = csvColumn;
+            }
+        } else {
+            int slot = columnSlots[csvColumn];
+            if (slot >= 0 && fieldLength > 0) {
+                memcpy(cells[slot], field, fieldLength + 1);
+                cellPresent[slot] = true;
+            }
+            if (csvColumn == errorColumn && fieldLength > 0) {
+                strncpy(error, field, sizeof(error) - 1);
+                error[sizeof(error) - 1] = '\0';
+            }
+        }
+    }
+
+    csvColumn++;
+    fieldLength = 0;
+}
+
+void FluxCsvParser::endLine() {
+    if (lineEmpty || lineIsAnnotation) {
+        // 空行と注釈はテーブルの区切り。次の行はヘッダになる
+        expectHeader = true;
+    } else {
+        endField();
+        if (headerRow) {
+            expectHeader = false;
+        } else if (errorColumn < 0) {
+            rowCount++;
+            if (handler) {
+                handler(handlerContext, *this);
+            }
+        }
+    }
+    resetLine();
+}
+
+bool FluxCsvParser::has(int column) const {
+    return column >= 0 && column < columnCount && cellPresent[column];
+}
+
+const char *FluxCsvParser::getText(int column) const { return has(column) ? cells[column] : ""; }
+
+bool FluxCsvParser::getFloat(int column, float &value) const {
+    if (!has(column)) {
+        return false;
+    }
+    char *end = nullptr;
+    value = strtof(cells[column], &end);
+    return end != cells[column];
+}
+
+bool FluxCsvParser::getTime(int column, int32_t &epoch) const {
+    return has(column) && parseTime(cells[column], epoch);
+}
+
+// 固定桁の数字を読む
+static bool readDigits(const char *&p, int count, int &value) {
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    p += count;
+    return true;
+}
+
+bool FluxCsvParser::parseTime(const char *text, int32_t &epoch) {
+    // 例: 2025-10-26T12:34:56Z / 2025-10-26T12:34:56.123456789+09:00
+    const char *p = text;
+    int year, month, day, hour, minute, second;
+    if (!readDigits(p, 4, year) || *p++ != '-' || !readDigits(p, 2, month) || *p++ != '-' ||
+        !readDigits(p, 2, day) || (*p != 'T' && *p != 't' && *p != ' ')) {
+        return false;
+    }
+    p++;
+    if (!readDigits(p, 2, hour) || *p++ != ':' || !readDigits(p, 2, minute) || *p++ != ':' ||
+        !readDigits(p, 2, second)) {
+        return false;
+    }
+
+    // 小数秒は切り捨て
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    int offset = 0;
+    if (*p == '+' || *p == '-') {
+        int sign = *p == '-' ? -1 : 1;
+        int offsetHour, offsetMinute;
+        p++;
+        if (!readDigits(p, 2, offsetHour) || *p++ != ':' || !readDigits(p, 2, offsetMinute)) {
+            return false;
+        }
+        offset = sign * (offsetHour * 3600 + offsetMinute * 60);
+    } else if (*p != 'Z' && *p != 'z') {
+        return false;
+    }
+
+    // 日付を1970-01-01からの日数に変換
+    int y = year - (month <= 2 ? 1 : 0);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int32_t days = era * 146097 + dayOfEra - 719468;
+
+    epoch = days * 86400 + hour * 3600 + minute * 60 + second - offset;
+    return true;
+}
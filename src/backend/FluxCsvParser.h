@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// InfluxDBのクエリ応答（Flux CSV）を受信しながら逐次解析するパーサ
+// 列の位置はヘッダ行で一度だけ解決し、行ごとのヒープ確保は行わない
+class FluxCsvParser {
+public:
+    static const int MAX_COLUMNS = 20;        // 取り出す列の最大数（時刻/値/結果名 + 4系列×4）
+    static const int MAX_CSV_COLUMNS = 32;    // CSV全体の列数の上限
+    static const int CELL_SIZE = 48;          // 1セルの最大長（超過分は切り捨て）
+
+    typedef void (*RowHandler)(void* context, const FluxCsvParser& parser);
+
+private:
+    enum State { FIELD_START, UNQUOTED, QUOTED, QUOTE_IN_QUOTED };
+
+    const char* columnNames[MAX_COLUMNS];
+    int columnCount;
+    RowHandler handler;
+    void* handlerContext;
+
+    // ヘッダで解決した列番号 -> 取り出し列の対応
+    int8_t columnSlots[MAX_CSV_COLUMNS];
+    int errorColumn;
+
+    // 現在の行の状態
+    State state;
+    int csvColumn;
+    bool lineEmpty;
+    bool lineIsAnnotation;
+    bool expectHeader;
+    bool headerRow;
+    char field[CELL_SIZE];
+    int fieldLength;
+    char cells[MAX_COLUMNS][CELL_SIZE];
+    bool cellPresent[MAX_COLUMNS];
+
+    size_t rowCount;
+    char error[128];
+
+    void endField();
+    void endLine();
+    void resetLine();
+
+public:
+    FluxCsvParser();
+
+    // 列の登録と行ハンドラの設定（応答ごとにbegin()から設定し直す）
+    void begin();
+    int addColumn(const char* name);
+    void setRowHandler(RowHandler rowHandler, void* context);
+
+    void feed(const char* data, size_t length);
+    void finish();
+
+    // 行ハンドラ内で使用するアクセサ
+    bool has(int column) const;
+    const char* getText(int column) const;
+    bool getFloat(int column, float& value) const;
+    bool getTime(int column, int32_t& epoch) const;
+
+    size_t getRowCount() const { return rowCount; }
+    bool hasError() const { return error[0] != '\0'; }
+    const char* getError() const { return error; }
+
+    // RFC3339形式の時刻をエポック秒に変換
+    static bool parseTime(const char* text, int32_t& epoch);
+};
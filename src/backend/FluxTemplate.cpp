@@ -0,0 +1,124 @@
+#include "FluxTemplate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+FluxWriter::FluxWriter(char *outputBuffer, size_t bufferSize)
+    : buffer(outputBuffer), capacity(bufferSize), length(0), overflow(false) {
+    if (capacity > 0) {
+        buffer[0] = '\0';
+    }
+}
+
+void FluxWriter::append(const char *text) { append(text, strlen(text)); }
+
+void FluxWriter::append(const char *text, size_t textLength) {
+    if (overflow) {
+        return;
+    }
+    // 終端の'\0'の分を残す
+    if (length + textLength >= capacity) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + length, text, textLength);
+    length += textLength;
+    buffer[length] = '\0';
+}
+
+void FluxWriter::appendInt(long value) {
+    char digits[16];
+    int n = snprintf(digits, sizeof(digits), "%ld", value);
+    append(digits, n);
+}
+
+// 差し込み位置の名前（Paramの順）
+static const char *const PARAM_NAMES[] = {"name", "start", "stop", "selector", "every"};
+static const int PARAM_COUNT = sizeof(PARAM_NAMES) / sizeof(PARAM_NAMES[0]);
+
+FluxTemplate::FluxTemplate() : text(nullptr), textCapacity(0), segmentCount(0) {}
+
+FluxTemplate::~FluxTemplate() { free(text); }
+
+bool FluxTemplate::addSegment(size_t offset, size_t length, int param) {
+    if (segmentCount >= MAX_SEGMENTS) {
+        return false;
+    }
+    segments[segmentCount].offset = (uint16_t)offset;
+    segments[segmentCount].length = (uint16_t)length;
+    segments[segmentCount].param = (int8_t)param;
+    segmentCount++;
+    return true;
+}
+
+bool FluxTemplate::compile(const char *source) {
+    segmentCount = 0;
+
+    // 固定部分は元の文字列より長くならない（組み立て直しで足りる場合は使い回す）
+    size_t sourceLength = strlen(source);
+    if (textCapacity < sourceLength + 1) {
+        char *grown = (char *)realloc(text, sourceLength + 1);
+        if (!grown) {
+            return false;
+        }
+        text = grown;
+        textCapacity = sourceLength + 1;
+    }
+
+    size_t length = 0;
+    size_t literalStart = 0;
+    const char *p = source;
+    while (*p) {
+        int param = PARAM_NONE;
+        size_t nameLength = 0;
+        if (*p == '{') {
+            for (int i = 0; i < PARAM_COUNT; i++) {
+                nameLength = strlen(PARAM_NAMES[i]);
+                if (strncmp(p + 1, PARAM_NAMES[i], nameLength) == 0 && p[1 + nameLength] == '}') {
+                    param = i;
+                    break;
+                }
+            }
+        }
+        if (param == PARAM_NONE) {
+            text[length++] = *p++;
+            continue;
+        }
+
+        if (!addSegment(literalStart, length - literalStart, param)) {
+            segmentCount = 0;
+            return false;
+        }
+        literalStart = length;
+        p += nameLength + 2;
+    }
+    text[length] = '\0';
+
+    // 末尾の固定部分
+    if (!addSegment(literalStart, length - literalStart, PARAM_NONE)) {
+        segmentCount = 0;
+        return false;
+    }
+    return true;
+}
+
+void FluxTemplate::render(FluxWriter &out, const FluxParams &params) const {
+    const char *base = text;
+    for (int i = 0; i < segmentCount; i++) {
+        const Segment &segment = segments[i];
+        out.append(base + segment.offset, segment.length);
+
+        const char *value = nullptr;
+        switch (segment.param) {
+            case PARAM_NAME: value = params.name; break;
+            case PARAM_START: value = params.start; break;
+            case PARAM_STOP: value = params.stop; break;
+            case PARAM_SELECTOR: value = params.selector; break;
+            case PARAM_EVERY: out.appendInt(params.every); break;
+            default: break;
+        }
+        if (value) {
+            out.append(value);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 雛形に差し込む値（使わない項目はnullptrでよい）
+struct FluxParams {
+    const char* name;      // {name}
+    const char* start;     // {start}
+    const char* stop;      // {stop}
+    const char* selector;  // {selector}
+    int every;             // {every}（秒）
+};
+
+// 呼び出し側が用意した固定長バッファへの書き込み
+// 入りきらない場合は以降を捨ててoverflowed()を立てる（確保し直しはしない）
+class FluxWriter {
+private:
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+public:
+    FluxWriter(char* outputBuffer, size_t bufferSize);
+
+    void append(const char* text);
+    void append(const char* text, size_t textLength);
+    void appendInt(long value);
+
+    const char* c_str() const { return buffer; }
+    size_t size() const { return length; }
+    bool overflowed() const { return overflow; }
+};
+
+// 差し込み位置を持つFluxクエリの雛形
+// 設定が決まった時点で固定部分を一度だけ組み立てて分割しておき、
+// クエリごとには固定部分と値をバッファへ順に書き込むだけにする
+// （FluxCsvParserと同様にArduinoに依存しないので、ホストのコンパイラでもビルドできる）
+class FluxTemplate {
+public:
+    static const int MAX_SEGMENTS = 32;
+
+private:
+    enum Param : int8_t {
+        PARAM_NONE = -1,
+        PARAM_NAME,
+        PARAM_START,
+        PARAM_STOP,
+        PARAM_SELECTOR,
+        PARAM_EVERY,
+    };
+
+    // 固定部分（text内の範囲）と、その直後に差し込む値
+    struct Segment {
+        uint16_t offset;
+        uint16_t length;
+        int8_t param;
+    };
+
+    char* text;  // 差し込み位置を除いた固定部分（compile()で確保）
+    size_t textCapacity;
+    Segment segments[MAX_SEGMENTS];
+    int segmentCount;
+
+    bool addSegment(size_t offset, size_t length, int param);
+
+public:
+    FluxTemplate();
+    ~FluxTemplate();
+    FluxTemplate(const FluxTemplate&) = delete;
+    FluxTemplate& operator=(const FluxTemplate&) = delete;
+
+    // 「{start}」などの既知の名前のみを差し込み位置とする（Fluxのレコード式の{}はそのまま残る）
+    // 差し込み位置が多すぎる、または確保に失敗した場合はfalse
+    bool compile(const char* source);
+    bool isCompiled() const { return segmentCount > 0; }
+
+    void render(FluxWriter& out, const FluxParams& params) const;
+};
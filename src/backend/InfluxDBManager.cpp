@@ -1,319 +1,1179 @@
 #include "InfluxDBManager.h"
-#include "../../include/env.h"
+#include <env.h>
 #include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
+#include "../common/Metrics.h"
 #include <WiFi.h>
-#include <InfluxDbClient.h>
-#include <InfluxDbCloud.h>
+#include <HTTPClient.h>
+#include <esp_heap_caps.h>
 
-InfluxDBManager::InfluxDBManager() : config(nullptr), client(nullptr) {
+InfluxDBManager::InfluxDBManager()
+    : config(nullptr), ready(false), lastRefreshOk(false), queryPort(0), queryTls(false),
+      queryBuffer(nullptr), store(nullptr), monthStartKey(0), monthStartValue(0),
+      latestCumulative(0), latestCumulativeTime(0), latestCumulativeMillis(0) {
+    // 応答を読み切った接続は閉じずに次のクエリで再利用する
+    queryHttp.setReuse(true);
+    for (int i = 0; i < MAX_SERIES_CACHES; i++) {
+        cacheLastUsed[i] = 0;
+    }
+
+    // クエリ本文は毎回この領域に書き込む（PSRAMが無い場合は内部RAM）
+    queryBuffer = (char *)heap_caps_malloc(QUERY_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!queryBuffer) {
+        queryBuffer = (char *)heap_caps_malloc(QUERY_BUFFER_SIZE, MALLOC_CAP_8BIT);
+    }
+    if (!queryBuffer) {
+        LOG_E("Query buffer allocation failed");
+    }
+    compileTemplates();
 }
 
 InfluxDBManager::~InfluxDBManager() {
-    if (client) {
-        delete client;
-        client = nullptr;
+    if (queryBuffer) {
+        heap_caps_free(queryBuffer);
+        queryBuffer = nullptr;
     }
 }
 
 void InfluxDBManager::setConfig(ConfigManager* configManager) {
     config = configManager;
+    compileTemplates();
+
+    // 系列の対応が変わるので、取得済みの点は使えない（キャッシュの領域は再利用する）
+    for (int i = 0; i < MAX_SERIES_CACHES; i++) {
+        seriesCaches[i].clear();
+    }
+    rollup.clear();
+}
+
+void InfluxDBManager::setSeriesStore(SeriesStore* seriesStore) {
+    store = seriesStore;
 }
 
 bool InfluxDBManager::connect() {
-    if (client) {
-        delete client;
+    // サーバー証明書の検証を無効化（ローカル環境の場合）
+    secureClient.setInsecure();
+
+    // クエリ用の接続は次のクエリで張り直す
+    plainClient.stop();
+    secureClient.stop();
+    parseServerUrl();
+
+    // 起動を待たせないよう、ここでは通信しない（疎通は最初のクエリで確認する）
+    ready = true;
+    LOG_I("InfluxDB endpoint: %s", queryUrl.c_str());
+    return true;
+}
+
+// 集計間隔の候補（秒）。ウィンドウ境界が揃うよう切りの良い値に丸める
+static const int AGGREGATE_STEPS[] = {10,   15,   20,    30,    60,    120,   180,
+                                      300,  600,  900,   1200,  1800,  3600,  7200,
+                                      10800, 21600, 43200, 86400};
+
+// これより前の時刻はNTP同期前の未設定の時計とみなす（2020-01-01）
+static const time_t CLOCK_VALID_EPOCH = 1577836800;
+
+// これ以上の時間範囲はロールアップから表示する（1m以上）
+static const int ROLLUP_MIN_HOURS = 720;
+// ロールアップの過去分を1回のクエリで取得するバケット数（15分で30日、1時間で120日）
+static const int ROLLUP_BACKFILL_ROWS = 2880;
+
+// 集計ウィンドウの境界に切り下げ
+static int32_t alignDown(int32_t time, int intervalSeconds) {
+    return (time / intervalSeconds) * intervalSeconds;
+}
+
+long InfluxDBManager::getTargetSeconds(int hours) const {
+    int graphWidth = 1080;
+    float pointsPerPixel = 1.0f;
+    if (config) {
+        graphWidth = config->getGraphConfig().graphWidth;
+        pointsPerPixel = config->getGraphConfig().pointsPerPixel;
     }
-    
-    // InfluxDBクライアントを初期化
-    client = new ::InfluxDBClient(INFLUXDB_URL, INFLUXDB_ORG, INFLUXDB_BUCKET, INFLUXDB_TOKEN, InfluxDbCloud2CACert);
 
-    
-    // サーバー証明書の検証を無効化（ローカル環境の場合）
-    client->setInsecure();
-    
-    // 接続テスト
-    if (client->validateConnection()) {
-        Serial.println("Connected to InfluxDB: " + client->getServerUrl());
-        return true;
-    } else {
-        Serial.print("InfluxDB connection failed: ");
-        Serial.println(client->getLastErrorMessage());
-        return false;
+    // 1ピクセル列あたり pointsPerPixel 点になる間隔を求める
+    int columns = (int)(graphWidth * pointsPerPixel);
+    if (columns < 1) {
+        columns = 1;
+    }
+    return ((long)hours * 3600 + columns - 1) / columns;
+}
+
+int InfluxDBManager::getAggregateSeconds(int hours) const {
+    long target = getTargetSeconds(hours);
+
+    // 長い時間範囲は画素の密度に合うロールアップのレベルの間隔にする
+    if (hours >= ROLLUP_MIN_HOURS) {
+        return RollupPyramid::getLevelSeconds(RollupPyramid::selectLevel(target, hours));
+    }
+
+    // 候補の中から切り上げる
+    for (int step : AGGREGATE_STEPS) {
+        if (step >= target) {
+            return step;
+        }
     }
+    return AGGREGATE_STEPS[sizeof(AGGREGATE_STEPS) / sizeof(AGGREGATE_STEPS[0]) - 1];
 }
 
-String InfluxDBManager::buildFluxQuery() {
-    String measurement = MEASUREMENT_NAME;
-    String field = FIELD_NAME_INSTANT_POWER_W;
-    int hours = DATA_HOURS;
-    int intervalMinutes = DATA_INTERVAL_MINUTES;
-    
+void InfluxDBManager::getDataSource(int index, String &measurement, String &field) const {
+    measurement = MEASUREMENT_NAME;
+    field = FIELD_NAME_INSTANT_POWER_W;
+
     // ConfigManagerが設定されている場合は、その設定を使用
     if (config) {
-        const auto& dataConfig = config->getDataSourceConfig();
-        const auto& systemConfig = config->getSystemConfig();
-        
+        const auto &dataConfig = config->getDataSources()[index];
         measurement = dataConfig.measurement;
         field = dataConfig.field;
-        hours = systemConfig.dataHours;
-        intervalMinutes = systemConfig.updateIntervalMinutes;
     }
-    
-    String query = "from(bucket: \"";
+}
+
+int InfluxDBManager::getSeriesCount() const {
+    return config ? (int)config->getDataSources().size() : 1;
+}
+
+// 系列の取得クエリ（{every}秒ごとの平均/最小/最大、withCountの場合は件数も）
+static String buildSeriesQuery(const String &predicate, bool withCount) {
+    // 列名を「field_mean」などにして_timeごとに1行へまとめる
+    // 同じスクリプト内の他の取得と変数名が重ならないよう、名前を接頭辞にする
+    static const char *FUNCTIONS[] = {"mean", "min", "max", "count"};
+    int functionCount = withCount ? 4 : 3;
+    String data = "{name}Data";
+    String query = data + " = from(bucket: \"";
     query += INFLUXDB_BUCKET;
     query += "\")";
-    query += " |> range(start: -";
-    query += String(hours);
-    query += "h)";
-    query += " |> filter(fn: (r) => r[\"_measurement\"] == \"";
-    query += measurement;
-    query += "\")";
-    query += " |> filter(fn: (r) => r[\"_field\"] == \"";
-    query += field;
-    query += "\")";
-    query += " |> aggregateWindow(every: ";
-    query += String(intervalMinutes);
-    query += "m, fn: mean, createEmpty: false)";
-    query += " |> yield(name: \"mean\")";
-    
+    query += " |> range(start: {start}, stop: {stop})";
+    query += " |> filter(fn: (r) => " + predicate + ")\n";
+    query += "union(tables: [";
+    for (int i = 0; i < functionCount; i++) {
+        String function = FUNCTIONS[i];
+        if (i > 0) {
+            query += ", ";
+        }
+        query += data + " |> aggregateWindow(every: {every}s, fn: " + function +
+                 ", createEmpty: false)";
+        query += " |> map(fn: (r) => ({r with _field: r._field + \"_" + function + "\"";
+        // 件数は整数なので、横持ちにした時に他の列と型が揃うよう実数にする
+        if (function == "count") {
+            query += ", _value: float(v: r._value)";
+        }
+        query += "}))";
+    }
+    query += "])";
+    // measurementやタグの違いで行が分かれないよう、必要な列だけにしてから横持ちにする
+    query += " |> keep(columns: [\"_time\", \"_field\", \"_value\"])";
+    query += " |> pivot(rowKey: [\"_time\"], columnKey: [\"_field\"], valueColumn: \"_value\")";
     return query;
 }
 
-std::vector<DataPoint> InfluxDBManager::getData(int hours) {
-    std::vector<DataPoint> dataPoints;
-    
-    if (!client || !isConnected()) {
-        Serial.println("InfluxDB not connected");
-        return dataPoints;
+void InfluxDBManager::compileTemplates() {
+    // 全系列を1つのfilterで読み出す（measurementごとにfieldをorでまとめる）
+    int seriesCount = getSeriesCount();
+    String measurements[MAX_DATA_SOURCES];
+    String fields[MAX_DATA_SOURCES];
+    for (int i = 0; i < seriesCount; i++) {
+        getDataSource(i, measurements[i], fields[i]);
+        // 横持ちにした後の列名（パーサへの登録用）
+        seriesColumnNames[i][0] = fields[i] + "_mean";
+        seriesColumnNames[i][1] = fields[i] + "_min";
+        seriesColumnNames[i][2] = fields[i] + "_max";
+        seriesColumnNames[i][3] = fields[i] + "_count";
     }
-    
-    // hoursパラメータが指定されていない場合はデフォルト値を使用
-    if (hours <= 0) {
-        hours = DATA_HOURS;
-        if (config) {
-            hours = config->getSystemConfig().dataHours;
+
+    String predicate;
+    for (int i = 0; i < seriesCount; i++) {
+        bool seen = false;
+        for (int j = 0; j < i; j++) {
+            seen = seen || measurements[j] == measurements[i];
         }
+        if (seen) {
+            continue;
+        }
+
+        if (!predicate.isEmpty()) {
+            predicate += " or ";
+        }
+        predicate += "(r[\"_measurement\"] == \"" + measurements[i] + "\" and (";
+        bool first = true;
+        for (int j = i; j < seriesCount; j++) {
+            if (measurements[j] != measurements[i]) {
+                continue;
+            }
+            if (!first) {
+                predicate += " or ";
+            }
+            predicate += "r[\"_field\"] == \"" + fields[j] + "\"";
+            first = false;
+        }
+        predicate += "))";
     }
-    
-    String measurement = MEASUREMENT_NAME;
-    String field = FIELD_NAME_INSTANT_POWER_W;
-    int intervalMinutes = DATA_INTERVAL_MINUTES;
-    
-    if (config) {
-        const auto& dataConfig = config->getDataSourceConfig();
-        measurement = dataConfig.measurement;
-        field = dataConfig.field;
-        intervalMinutes = config->getSystemConfig().updateIntervalMinutes;
+
+    String query = buildSeriesQuery(predicate, false);
+    if (!seriesTemplate.compile(query.c_str())) {
+        LOG_E("Series query template could not be compiled");
     }
-    
-    String query = "from(bucket: \"";
+    // ロールアップの粗いレベル用（合計を求めるため件数も集計する）
+    query = buildSeriesQuery(predicate, true);
+    if (!bucketTemplate.compile(query.c_str())) {
+        LOG_E("Bucket query template could not be compiled");
+    }
+
+    // 積算電力量の先頭/末尾の1点（月間使用量の計算用、積算値は主系列のmeasurementから読む）
+    query = "from(bucket: \"";
     query += INFLUXDB_BUCKET;
     query += "\")";
-    query += " |> range(start: -";
-    query += String(hours);
-    query += "h)";
-    query += " |> filter(fn: (r) => r[\"_measurement\"] == \"";
-    query += measurement;
-    query += "\")";
+    query += " |> range(start: {start}, stop: {stop})";
+    query += " |> filter(fn: (r) => r[\"_measurement\"] == \"" + measurements[0] + "\")";
     query += " |> filter(fn: (r) => r[\"_field\"] == \"";
-    query += field;
+    query += FIELD_NAME_CUMULATIVE_ENERGY_KWH;
     query += "\")";
-    query += " |> aggregateWindow(every: ";
-    query += String(intervalMinutes);
-    query += "m, fn: mean, createEmpty: false)";
-    query += " |> yield(name: \"mean\")";
-    
-    Serial.println("Executing Flux query: " + query);
-    
-    // Fluxクエリを実行
-    FluxQueryResult result = client->query(query);
-
-    // エラーチェック
-    if(result.getError() != "") {
-        Serial.printf("Query error: %s\n", result.getError().c_str());
-        Serial.printf("InfluxDB error: %s\n", client->getLastErrorMessage().c_str());
-        return dataPoints;
-    }
-
-    // 結果を解析
-    while (result.next()) {
+    query += " |> {selector}()";
+    if (!cumulativeTemplate.compile(query.c_str())) {
+        LOG_E("Cumulative query template could not be compiled");
+    }
+}
+
+// HTTPClientの受信データをそのままパーサへ流し込むStream
+class ParserStream : public Stream {
+private:
+    FluxCsvParser &parser;
+
+public:
+    explicit ParserStream(FluxCsvParser &csvParser) : parser(csvParser) {}
+    size_t write(uint8_t c) override {
+        char ch = (char)c;
+        parser.feed(&ch, 1);
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        parser.feed((const char *)buffer, size);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+// URLのクエリ文字列用にエンコード
+static String urlEncode(const char *text) {
+    static const char hex[] = "0123456789ABCDEF";
+    String encoded;
+    for (const char *p = text; *p; p++) {
+        char c = *p;
+        if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += c;
+        } else {
+            encoded += '%';
+            encoded += hex[(c >> 4) & 0xF];
+            encoded += hex[c & 0xF];
+        }
+    }
+    return encoded;
+}
+
+void InfluxDBManager::parseServerUrl() {
+    authHeader = String("Token ") + INFLUXDB_TOKEN;
+
+    String url = INFLUXDB_URL;
+    if (url.endsWith("/")) {
+        url = url.substring(0, url.length() - 1);
+    }
+    queryUrl = url + "/api/v2/query?org=" + urlEncode(INFLUXDB_ORG);
+
+    // 接続先は自前で接続するため、スキーム・ホスト・ポートを取り出しておく
+    queryTls = url.startsWith("https://");
+    int hostStart = url.indexOf("://");
+    String authority = hostStart >= 0 ? url.substring(hostStart + 3) : url;
+    int slash = authority.indexOf('/');
+    if (slash >= 0) {
+        authority = authority.substring(0, slash);
+    }
+    int colon = authority.indexOf(':');
+    if (colon >= 0) {
+        queryHost = authority.substring(0, colon);
+        queryPort = (uint16_t)authority.substring(colon + 1).toInt();
+    } else {
+        queryHost = authority;
+        queryPort = queryTls ? 443 : 80;
+    }
+}
+
+bool InfluxDBManager::streamQuery(const char *query, size_t length, FluxCsvParser &parser) {
+    if (queryUrl.isEmpty()) {
+        parseServerUrl();
+    }
+    WiFiClient &transport = queryTls ? secureClient : plainClient;
+
+    // 前回のクエリの接続が残っていれば使い回す（TLSのハンドシェイクも省ける）
+    // 無ければここで接続し、接続にかかった時間を応答待ちと分けて計測する
+    unsigned long startMillis = millis();
+    bool reused = transport.connected();
+    if (!reused && !transport.connect(queryHost.c_str(), queryPort)) {
+        LOG_E("Query connection to %s:%u failed", queryHost.c_str(), (unsigned)queryPort);
+        return false;
+    }
+    unsigned long connectedMillis = millis();
+
+    if (!queryHttp.begin(transport, queryUrl)) {
+        LOG_E("Query request could not be started");
+        return false;
+    }
+    queryHttp.addHeader("Authorization", authHeader);
+    queryHttp.addHeader("Content-Type", "application/vnd.flux");
+    queryHttp.addHeader("Accept", "application/csv");
+
+    int status = queryHttp.POST((uint8_t *)query, length);
+    if (status < 0 && reused) {
+        // サーバ側で既に閉じられていた接続だった場合は、接続し直して1回だけ送り直す
+        LOG_D("Reused query connection was closed, reconnecting");
+        queryHttp.end();
+        transport.stop();
+        return streamQuery(query, length, parser);
+    }
+    unsigned long responseMillis = millis();
+
+    if (status != HTTP_CODE_OK) {
+        if (status < 0) {
+            LOG_E("Query HTTP error: %s", HTTPClient::errorToString(status).c_str());
+            transport.stop();
+        } else {
+            LOG_E("Query HTTP status %d: %s", status, queryHttp.getString().c_str());
+        }
+        queryHttp.end();
+        return false;
+    }
+
+    // 受信しながら解析（応答全体をメモリに保持しない）
+    ParserStream sink(parser);
+    int received = queryHttp.writeToStream(&sink);
+    parser.finish();
+    queryHttp.end();
+
+    if (received < 0) {
+        // 応答の途中で切れた接続は再利用しない
+        transport.stop();
+        LOG_E("Query stream error: %s", HTTPClient::errorToString(received).c_str());
+        return false;
+    }
+
+    LOG_I("Query %s connection: connect %lu ms, ttfb %lu ms, transfer %lu ms, %d bytes",
+          reused ? "reused" : "new", connectedMillis - startMillis, responseMillis - connectedMillis,
+          millis() - responseMillis, received);
+
+    if (parser.hasError()) {
+        LOG_E("Query error: %s", parser.getError());
+        return false;
+    }
+    return true;
+}
+
+bool InfluxDBManager::runBatch(const FluxBatch &batch, FluxCsvParser &parser) {
+    if (!queryBuffer) {
+        return false;
+    }
+
+    FluxWriter writer(queryBuffer, QUERY_BUFFER_SIZE);
+    if (!batch.build(writer)) {
+        LOG_E("Flux query exceeds %u bytes", (unsigned)QUERY_BUFFER_SIZE);
+        return false;
+    }
+
+    LOG_D("Executing Flux query: %s", writer.c_str());
+    Metrics::increment(COUNTER_QUERIES);
+    bool ok;
+    {
+        ScopedTimer timer(METRIC_QUERY);
+        ok = streamQuery(writer.c_str(), writer.size(), parser);
+    }
+    Metrics::record(METRIC_QUERY_ROWS, parser.getRowCount());
+    if (!ok) {
+        Metrics::increment(COUNTER_QUERY_ERRORS);
+    }
+    return ok;
+}
+
+// 系列取得時の行ハンドラに渡す列番号と出力先
+struct SeriesRowContext {
+    SeriesSet *series;
+    RollupBucketSet *buckets;  // ロールアップのバケットとして取得する場合の出力先
+    int bucketSeconds;
+    int seriesCount;
+    int timeColumn;
+    int meanColumns[MAX_DATA_SOURCES];
+    int minColumns[MAX_DATA_SOURCES];
+    int maxColumns[MAX_DATA_SOURCES];
+    int countColumns[MAX_DATA_SOURCES];
+};
+
+// 横持ちの1行を系列ごとのバッファへ振り分ける（値が無い系列はその時刻を飛ばす）
+static void appendSeriesRow(void *context, const FluxCsvParser &parser) {
+    SeriesRowContext *ctx = static_cast<SeriesRowContext *>(context);
+
+    int32_t time;
+    if (!parser.getTime(ctx->timeColumn, time)) {
+        return;
+    }
+
+    for (int i = 0; i < ctx->seriesCount; i++) {
         DataPoint point;
-        
-        // タイムスタンプを取得
-        FluxValue timeValue = result.getValueByName("_time");
-        if (!timeValue.isNull()) {
-            FluxDateTime time = timeValue.getDateTime();
-            point.timestamp = time.format("%Y-%m-%d %H:%M:%S");
-            Serial.println("Timestamp: " + point.timestamp);
-        }
-        
-        // 値を取得
-        FluxValue valueFlux = result.getValueByName("_value");
-        if (!valueFlux.isNull()) {
-            point.value = valueFlux.getDouble();
-            Serial.println("Value: " + String(point.value));
-        }
-        
-        if (!point.timestamp.isEmpty()) {
-            dataPoints.push_back(point);
-        }
-    }
-    
-    // エラーチェック
-    if (result.getError() != "") {
-        Serial.print("Query result error: ");
-        Serial.println(result.getError());
-    }
-    
-    result.close();
-    
-    Serial.println("InfluxDB data retrieved successfully");
-    Serial.println("Data points count: " + String(dataPoints.size()));
-    
-    return dataPoints;
+        point.time = time;
+        if (!parser.getFloat(ctx->meanColumns[i], point.value)) {
+            continue;
+        }
+        if (!parser.getFloat(ctx->minColumns[i], point.min)) {
+            point.min = point.value;
+        }
+        if (!parser.getFloat(ctx->maxColumns[i], point.max)) {
+            point.max = point.value;
+        }
+        (*ctx->series)[i].push_back(point);
+    }
 }
 
-float InfluxDBManager::getLatestValue() {
-    std::vector<DataPoint> data = getData();
-    if (data.size() > 0) {
-        return data.back().value; // 最後のデータポイントを返す
+// 横持ちの1行をロールアップのバケットとして系列ごとに振り分ける（時刻はウィンドウの終端）
+static void appendBucketRow(void *context, const FluxCsvParser &parser) {
+    SeriesRowContext *ctx = static_cast<SeriesRowContext *>(context);
+
+    int32_t time;
+    if (!parser.getTime(ctx->timeColumn, time)) {
+        return;
+    }
+
+    for (int i = 0; i < ctx->seriesCount; i++) {
+        float mean, count;
+        if (!parser.getFloat(ctx->meanColumns[i], mean) ||
+            !parser.getFloat(ctx->countColumns[i], count) || count < 1.0f) {
+            continue;
+        }
+        RollupBucket bucket;
+        bucket.time = alignDown(time - 1, ctx->bucketSeconds);
+        bucket.count = (uint32_t)count;
+        bucket.sum = mean * bucket.count;
+        if (!parser.getFloat(ctx->minColumns[i], bucket.min)) {
+            bucket.min = mean;
+        }
+        if (!parser.getFloat(ctx->maxColumns[i], bucket.max)) {
+            bucket.max = mean;
+        }
+        (*ctx->buckets)[i].push_back(bucket);
     }
-    return 0.0;
 }
 
-bool InfluxDBManager::getMonthlyEnergyUsage(float &monthlyUsage) {
-    monthlyUsage = 0.0f;
+void InfluxDBManager::addSeriesColumns(SeriesRowContext &context, int timeColumn) {
+    // 列番号はヘッダ行で一度だけ解決し、各行はバッファへ直接追加する
+    context.seriesCount = getSeriesCount();
+    context.timeColumn = timeColumn;
+    for (int i = 0; i < context.seriesCount; i++) {
+        context.meanColumns[i] = csvParser.addColumn(seriesColumnNames[i][0].c_str());
+        context.minColumns[i] = csvParser.addColumn(seriesColumnNames[i][1].c_str());
+        context.maxColumns[i] = csvParser.addColumn(seriesColumnNames[i][2].c_str());
+        context.countColumns[i] = csvParser.addColumn(seriesColumnNames[i][3].c_str());
+    }
+    context.series = nullptr;
+    context.buckets = nullptr;
+    context.bucketSeconds = 0;
+}
+
+SeriesCacheSet *InfluxDBManager::selectCache(int hours, int aggregateSeconds) {
+    // 同じ集計間隔・系列数のキャッシュがあればそれを使う
+    int seriesCount = getSeriesCount();
+    int target = -1;
+    for (int i = 0; i < MAX_SERIES_CACHES; i++) {
+        if (seriesCaches[i].getIntervalSeconds() == aggregateSeconds &&
+            seriesCaches[i].getSeriesCount() == seriesCount) {
+            target = i;
+            break;
+        }
+    }
+
+    if (target < 0) {
+        // 無ければ最も長く使われていないキャッシュを再利用する
+        target = 0;
+        for (int i = 1; i < MAX_SERIES_CACHES; i++) {
+            if (cacheLastUsed[i] < cacheLastUsed[target]) {
+                target = i;
+            }
+        }
 
-    if (!client || !isConnected()) {
-        Serial.println("InfluxDB not connected");
+        // 表示範囲の2倍を保持できる容量（先頭側の追加取得に備える）
+        size_t capacity = (size_t)hours * 3600 * 2 / aggregateSeconds + 64;
+        if (!seriesCaches[target].begin(capacity, aggregateSeconds, seriesCount)) {
+            return nullptr;
+        }
+    }
+
+    cacheLastUsed[target] = millis();
+    return &seriesCaches[target];
+}
+
+uint32_t InfluxDBManager::getStoreSeriesId(int index) const {
+    String measurement, field;
+    getDataSource(index, measurement, field);
+    return SeriesStore::seriesId(measurement + "/" + field);
+}
+
+bool InfluxDBManager::loadFromStore(SeriesCacheSet *cache, int hours, int aggregateSeconds) {
+    if (!store || !store->isReady()) {
         return false;
     }
 
-    String measurement = MEASUREMENT_NAME;
-    if (config) {
-        measurement = config->getDataSourceConfig().measurement;
+    // 全系列が保存されている場合のみ使う（一部の系列だけを取得し直すことはしない）
+    int seriesCount = cache->getSeriesCount();
+    int32_t oldest = 0;
+    int32_t newest = 0;
+    for (int i = 0; i < seriesCount; i++) {
+        int32_t seriesOldest, seriesNewest;
+        if (!store->getRange(getStoreSeriesId(i), aggregateSeconds, seriesOldest, seriesNewest)) {
+            return false;
+        }
+        if (i == 0 || seriesOldest > oldest) {
+            oldest = seriesOldest;
+        }
+        if (i == 0 || seriesNewest > newest) {
+            newest = seriesNewest;
+        }
     }
 
-    // ステップ1: 最新の1件を取得
-    String latestQuery = "from(bucket: \"";
-    latestQuery += INFLUXDB_BUCKET;
-    latestQuery += "\")";
-    latestQuery += " |> range(start: -30d)";
-    latestQuery += " |> filter(fn: (r) => r[\"_measurement\"] == \"";
-    latestQuery += measurement;
-    latestQuery += "\")";
-    latestQuery += " |> filter(fn: (r) => r[\"_field\"] == \"";
-    latestQuery += FIELD_NAME_CUMULATIVE_ENERGY_KWH;
-    latestQuery += "\")";
-    latestQuery += " |> last()";
+    // 保存済みの最新の点を基準に表示範囲分を読み込む
+    int32_t windowStart = newest - hours * 3600;
+    SeriesSet series(seriesCount);
+    size_t loaded = 0;
+    for (int i = 0; i < seriesCount; i++) {
+        loaded += store->read(getStoreSeriesId(i), aggregateSeconds, windowStart, newest, series[i]);
+    }
+    if (loaded == 0) {
+        return false;
+    }
+    cache->append(series);
 
-    Serial.println("Executing latest value query: " + latestQuery);
+    // 保存済みの区間は取得済みとして扱い、不足分は通常の先頭/末尾の取得で補う
+    cache->setCoveredFrom(oldest < windowStart ? windowStart : oldest - aggregateSeconds);
+    LOG_I("Loaded %u points every %ds from microSD", (unsigned)loaded, aggregateSeconds);
+    return true;
+}
 
-    FluxQueryResult latestResult = client->query(latestQuery);
+void InfluxDBManager::saveToStore(SeriesCacheSet *cache) {
+    if (!store || !store->isReady()) {
+        return;
+    }
 
-    if (latestResult.getError() != "") {
-        Serial.printf("Latest query error: %s\n", latestResult.getError().c_str());
-        latestResult.close();
+    int interval = cache->getIntervalSeconds();
+    int32_t newest = cache->getNewestTime();
+    std::vector<DataPoint> points;
+    size_t saved = 0;
+    for (int i = 0; i < cache->getSeriesCount(); i++) {
+        const SeriesCache &series = cache->getSeries(i);
+        if (series.isEmpty()) {
+            continue;
+        }
+
+        uint32_t id = getStoreSeriesId(i);
+        int32_t from = series.getOldestTime();
+        int32_t storedOldest, storedNewest;
+        if (store->getRange(id, interval, storedOldest, storedNewest)) {
+            from = storedNewest + 1;
+        }
+
+        // 最新の時刻は集計途中のウィンドウなので保存しない
+        series.copyRange(from, newest - 1, points);
+        if (!points.empty()) {
+            saved += store->append(id, interval, points);
+        }
+    }
+    if (saved > 0) {
+        LOG_D("Saved %u points every %ds to microSD", (unsigned)saved, interval);
+    }
+}
+
+uint32_t InfluxDBManager::getRollupStoreId(int index) const {
+    // 同じ集計間隔のキャッシュの保存データとは別のファイルにする
+    String measurement, field;
+    getDataSource(index, measurement, field);
+    return SeriesStore::seriesId(measurement + "/" + field + "/rollup");
+}
+
+bool InfluxDBManager::loadRollupFromStore(int32_t notBefore) {
+    if (!store || !store->isReady()) {
         return false;
     }
 
-    float latestValue = 0.0f;
-    String latestTime = "";
-    bool hasLatest = false;
+    // 全系列の粗いレベルが保存されている場合のみ使い、最も古い末尾を含む日の始めまでを戻す
+    int seriesCount = rollup.getSeriesCount();
+    int32_t restoreTo = 0;
+    int32_t oldest[RollupPyramid::LEVEL_COUNT] = {0};
+    for (int level = 1; level < RollupPyramid::LEVEL_COUNT; level++) {
+        int seconds = RollupPyramid::getLevelSeconds(level);
+        for (int i = 0; i < seriesCount; i++) {
+            int32_t seriesOldest, seriesNewest;
+            if (!store->getRange(getRollupStoreId(i), seconds, seriesOldest, seriesNewest)) {
+                return false;
+            }
+            if (i == 0 || seriesOldest > oldest[level]) {
+                oldest[level] = seriesOldest;
+            }
+            if (restoreTo == 0 || seriesNewest < restoreTo) {
+                restoreTo = seriesNewest;
+            }
+        }
+    }
+    restoreTo = alignDown(restoreTo, 86400);
+    if (restoreTo < notBefore) {
+        return false;
+    }
 
-    if (latestResult.next()) {
-        FluxValue valueFlux = latestResult.getValueByName("_value");
-        FluxValue timeFlux = latestResult.getValueByName("_time");
-        
-        if (!valueFlux.isNull() && !timeFlux.isNull()) {
-            latestValue = valueFlux.getDouble();
-            FluxDateTime time = timeFlux.getDateTime();
-            latestTime = time.format("%Y-%m-%dT%H:%M:%SZ");
-            hasLatest = true;
-            Serial.println("Latest value: " + String(latestValue) + " at " + latestTime);
+    // 粗いレベルから順に戻す（レベルごとに範囲が異なるので細かいレベルからは集計しない）
+    // 件数は保存していないので、1分値から集計した場合と同じ重みにする
+    RollupBucketSet buckets(seriesCount);
+    std::vector<DataPoint> points;
+    size_t loaded = 0;
+    for (int level = RollupPyramid::LEVEL_COUNT - 1; level >= 1; level--) {
+        int seconds = RollupPyramid::getLevelSeconds(level);
+        uint32_t count = seconds / RollupPyramid::getLevelSeconds(0);
+        for (int i = 0; i < seriesCount; i++) {
+            store->read(getRollupStoreId(i), seconds, oldest[level], restoreTo, points);
+            buckets[i].clear();
+            buckets[i].reserve(points.size());
+            for (const auto &point : points) {
+                RollupBucket bucket = {point.time - seconds, point.value * count, point.min,
+                                       point.max, count};
+                buckets[i].push_back(bucket);
+            }
+            loaded += points.size();
         }
+        rollup.prepend(level, oldest[level] - seconds, buckets);
+    }
+    if (loaded == 0) {
+        rollup.clear();
+        return false;
+    }
+
+    rollup.restore(restoreTo);
+    LOG_I("Loaded %u rollup buckets from microSD", (unsigned)loaded);
+    return true;
+}
+
+void InfluxDBManager::saveRollupToStore() {
+    if (!store || !store->isReady() || rollup.isEmpty()) {
+        return;
+    }
+
+    // 1分値は保持期間が短いので保存せず、集計途中の最新のバケットも保存しない
+    int32_t newest = rollup.getNewestTime();
+    std::vector<DataPoint> points;
+    size_t saved = 0;
+    for (int level = 1; level < RollupPyramid::LEVEL_COUNT; level++) {
+        int seconds = RollupPyramid::getLevelSeconds(level);
+        int32_t coveredFrom = rollup.getCoveredFrom(level);
+        if (coveredFrom == 0) {
+            continue;
+        }
+        for (int i = 0; i < rollup.getSeriesCount(); i++) {
+            uint32_t id = getRollupStoreId(i);
+            int32_t storedOldest, storedNewest;
+            bool stored = store->getRange(id, seconds, storedOldest, storedNewest);
+            // 保存済みの区間とつながらない場合は、先頭側の取得が届くまで待つ
+            if (stored && coveredFrom > storedNewest) {
+                continue;
+            }
+
+            // 末尾: 保存済みより新しい確定したバケット
+            rollup.copyRange(level, i, stored ? storedNewest + 1 : coveredFrom,
+                             newest - seconds - 1, points);
+            if (!points.empty()) {
+                saved += store->append(id, seconds, points);
+            }
+            // 先頭: 過去分の取得で保存済みより古い範囲まで埋まった分
+            if (stored && coveredFrom < storedOldest - seconds) {
+                rollup.copyRange(level, i, coveredFrom, storedOldest - 1, points);
+                if (!points.empty()) {
+                    saved += store->prepend(id, seconds, points);
+                }
+            }
+        }
+    }
+    if (saved > 0) {
+        LOG_D("Saved %u rollup buckets to microSD", (unsigned)saved);
+    }
+}
+
+int32_t InfluxDBManager::getRollupSpan(int hours) const {
+    // 最も粗いレベルで保持できる期間より前はさかのぼらない
+    int32_t span = hours * 3600;
+    int32_t retention = RollupPyramid::getRetentionSeconds(RollupPyramid::LEVEL_COUNT - 1);
+    return span < retention ? span : retention;
+}
+
+bool InfluxDBManager::hasPendingBackfill(int hours) const {
+    if (hours < ROLLUP_MIN_HOURS || !lastRefreshOk || rollup.getSyncedTime() == 0) {
+        return false;
+    }
+    time_t now = time(nullptr);
+    int level = RollupPyramid::selectLevel(getTargetSeconds(hours), hours);
+    return now >= CLOCK_VALID_EPOCH && rollup.getCoveredFrom(level) > now - getRollupSpan(hours);
+}
+
+SeriesSet InfluxDBManager::getStoredData(int hours) {
+    SeriesSet series;
+
+    // 長い時間範囲はロールアップの保存データから戻す（古すぎる場合は次の更新で作り直す）
+    if (hours >= ROLLUP_MIN_HOURS) {
+        if (rollup.begin(getSeriesCount()) &&
+            (rollup.getSyncedTime() != 0 || loadRollupFromStore(0))) {
+            int32_t newest = rollup.getNewestTime();
+            int level = RollupPyramid::selectLevel(getTargetSeconds(hours), hours);
+            rollup.copyRange(level, newest - hours * 3600, newest, series);
+        }
+        return series;
+    }
+
+    int intervalSeconds = getAggregateSeconds(hours);
+    SeriesCacheSet *cache = selectCache(hours, intervalSeconds);
+    if (cache && (!cache->isEmpty() || loadFromStore(cache, hours, intervalSeconds))) {
+        int32_t newest = cache->getNewestTime();
+        cache->copyRange(newest - hours * 3600, newest, series);
+    }
+    return series;
+}
+
+float InfluxDBManager::getLatestValue() {
+    SeriesSet series = getData();
+    if (!series.empty() && !series[0].empty()) {
+        return series[0].back().value; // 主系列の最後のデータポイントを返す
+    }
+    return 0.0;
+}
+
+// 単一の値を取得するクエリの行ハンドラに渡す出力先
+struct EdgeValueContext {
+    int timeColumn;
+    int valueColumn;
+    bool found;
+    int32_t time;
+    float value;
+};
+
+static void storeEdgeValue(void *context, const FluxCsvParser &parser) {
+    EdgeValueContext *ctx = static_cast<EdgeValueContext *>(context);
+    if (parser.getTime(ctx->timeColumn, ctx->time) && parser.getFloat(ctx->valueColumn, ctx->value)) {
+        ctx->found = true;
     }
+}
+
+// エポック秒から年*100+月（UTC）を求める
+static int monthKeyOf(int32_t time) {
+    time_t t = time;
+    struct tm tmValue;
+    gmtime_r(&t, &tmValue);
+    return (tmValue.tm_year + 1900) * 100 + tmValue.tm_mon + 1;
+}
+
+bool InfluxDBManager::fetchCumulativeEnergy(const char *rangeStart, const char *rangeStop,
+                                            const char *selector, float &value, int32_t &time) {
+    EdgeValueContext context;
+    context.found = false;
+    csvParser.begin();
+    context.timeColumn = csvParser.addColumn("_time");
+    context.valueColumn = csvParser.addColumn("_value");
 
-    latestResult.close();
+    FluxBatch batch;
+    FluxParams params = {"edge", rangeStart, rangeStop, selector, 0};
+    batch.add(cumulativeTemplate, params, storeEdgeValue, &context);
+    batch.attach(csvParser);
 
-    if (!hasLatest) {
-        Serial.println("No latest cumulative energy data found");
+    if (!runBatch(batch, csvParser) || !context.found) {
         return false;
     }
 
-    // ステップ2: 月初の日付を計算 (latestTimeから)
-    // latestTimeの形式: "2025-10-26T12:34:56Z"
-    String yearStr = latestTime.substring(0, 4);
-    String monthStr = latestTime.substring(5, 7);
-    String monthStartTime = yearStr + "-" + monthStr + "-01T00:00:00Z";
-
-    Serial.println("Month start time: " + monthStartTime);
-
-    // ステップ3: 月初のcumulative_energy_kwhを取得（月初のデータが無い場合は今月の最古データを取得）
-    // 今月の最後の日を計算
-    int month = monthStr.toInt();
-    int year = yearStr.toInt();
-    int nextMonth = month + 1;
-    int nextYear = year;
-    if (nextMonth > 12) {
-        nextMonth = 1;
-        nextYear++;
-    }
-    String monthEndTime = String(nextYear) + "-" + (nextMonth < 10 ? "0" : "") + String(nextMonth) + "-01T00:00:00Z";
-
-    String monthStartQuery = "from(bucket: \"";
-    monthStartQuery += INFLUXDB_BUCKET;
-    monthStartQuery += "\")";
-    monthStartQuery += " |> range(start: " + monthStartTime + ", stop: " + monthEndTime + ")";
-    monthStartQuery += " |> filter(fn: (r) => r[\"_measurement\"] == \"";
-    monthStartQuery += measurement;
-    monthStartQuery += "\")";
-    monthStartQuery += " |> filter(fn: (r) => r[\"_field\"] == \"";
-    monthStartQuery += FIELD_NAME_CUMULATIVE_ENERGY_KWH;
-    monthStartQuery += "\")";
-    monthStartQuery += " |> first()";
-
-    Serial.println("Executing month start query: " + monthStartQuery);
-
-    FluxQueryResult monthStartResult = client->query(monthStartQuery);
-
-    if (monthStartResult.getError() != "") {
-        Serial.printf("Month start query error: %s\n", monthStartResult.getError().c_str());
-        monthStartResult.close();
+    value = context.value;
+    time = context.time;
+    return true;
+}
+
+SeriesSet InfluxDBManager::getData(int hours) {
+    SeriesSet series;
+    runRefresh(hours, &series, nullptr);
+    return series;
+}
+
+bool InfluxDBManager::getMonthlyEnergyUsage(float &monthlyUsage) {
+    return runRefresh(0, nullptr, &monthlyUsage);
+}
+
+bool InfluxDBManager::refresh(int hours, SeriesSet &series, float &monthlyUsage) {
+    return runRefresh(hours, &series, &monthlyUsage);
+}
+
+bool InfluxDBManager::runRefresh(int hours, SeriesSet *series, float *monthlyUsage) {
+    if (series) {
+        series->clear();
+    }
+    if (monthlyUsage) {
+        *monthlyUsage = 0.0f;
+    }
+
+    lastRefreshOk = false;
+    if (!isConnected()) {
+        LOG_W_EVERY(10000, "InfluxDB not connected");
         return false;
     }
+    ScopedTimer timer(METRIC_REFRESH);
+
+    int updateIntervalMinutes = DATA_INTERVAL_MINUTES;
+    if (config) {
+        updateIntervalMinutes = config->getSystemConfig().updateIntervalMinutes;
+    }
+    unsigned long updateIntervalMillis = (unsigned long)updateIntervalMinutes * 60 * 1000;
+    time_t now = time(nullptr);
+    bool clockValid = now >= CLOCK_VALID_EPOCH;
+
+    // 更新に必要な取得を1つのスクリプトにまとめ、結果はyield名で振り分ける
+    FluxBatch batch;
+    csvParser.begin();
+    int timeColumn = csvParser.addColumn("_time");
+
+    // --- 系列: キャッシュに足りない範囲（全体、または末尾/先頭の差分）を決める ---
+    SeriesCacheSet *cache = nullptr;
+    int intervalSeconds = 0;
+    // 雛形に差し込む範囲（build()まで保持する）
+    char fullStart[16], tailStart[16], headStart[16], headStop[16];
+    SeriesSet fullPoints, tailPoints, headPoints;
+    RollupBucketSet headBuckets;
+    SeriesRowContext fullContext, tailContext, headContext;
+    bool fetchFull = false;
+    bool fetchTail = false;
+    bool fetchHead = false;
+    int32_t tailFrom = 0;
+    int32_t headFrom = 0;
+    bool useRollup = false;
+    int32_t rollupFrom = 0;
+    int rollupLevel = 0;
+
+    if (series) {
+        // hoursパラメータが指定されていない場合はデフォルト値を使用
+        if (hours <= 0) {
+            hours = DATA_HOURS;
+            if (config) {
+                hours = config->getSystemConfig().dataHours;
+            }
+        }
 
-    float monthStartValue = 0.0f;
-    bool hasMonthStart = false;
+        // 表示範囲と描画幅から集計間隔を決める
+        intervalSeconds = getAggregateSeconds(hours);
 
-    if (monthStartResult.next()) {
-        FluxValue valueFlux = monthStartResult.getValueByName("_value");
-        
-        if (!valueFlux.isNull()) {
-            monthStartValue = valueFlux.getDouble();
-            hasMonthStart = true;
-            Serial.println("Month start value: " + String(monthStartValue));
+        // 長い時間範囲は時計が合っていればロールアップから表示する（使えない場合は通常のキャッシュ）
+        useRollup = hours >= ROLLUP_MIN_HOURS && clockValid && rollup.begin(getSeriesCount());
+        if (useRollup) {
+            // 途切れていた期間が1分値の保持期間より長い場合は差分ではなく作り直す
+            int32_t minuteRetention = RollupPyramid::getRetentionSeconds(0);
+            if (rollup.getSyncedTime() != 0 && rollup.getSyncedTime() < now - minuteRetention) {
+                rollup.clear();
+            }
+            // 未取得の場合はmicroSDの保存データから始め、以降の1分値のみを取得する
+            if (rollup.getSyncedTime() == 0) {
+                loadRollupFromStore((int32_t)now - minuteRetention);
+            }
+
+            rollupLevel = RollupPyramid::selectLevel(getTargetSeconds(hours), hours);
+            if (rollup.getSyncedTime() == 0) {
+                // 1分値は保持期間（2日）に収まる前日の0時から取得し、
+                // それより前は表示するレベルのバケットを日単位の区間で続けて取得する
+                fetchFull = true;
+                rollupFrom = alignDown(now, 86400) - 86400;
+            } else {
+                if (!rollup.isFresh(updateIntervalMillis)) {
+                    fetchTail = true;
+                    tailFrom = alignDown(rollup.getSyncedTime(), RollupPyramid::getLevelSeconds(0));
+                }
+                int32_t spanStart = (int32_t)now - getRollupSpan(hours);
+                int32_t headTo = rollup.getCoveredFrom(rollupLevel);
+                if (headTo > spanStart) {
+                    fetchHead = true;
+                    int levelSeconds = RollupPyramid::getLevelSeconds(rollupLevel);
+                    headFrom = headTo - ROLLUP_BACKFILL_ROWS * levelSeconds;
+                    if (headFrom < alignDown(spanStart, 86400)) {
+                        headFrom = alignDown(spanStart, 86400);
+                    }
+                }
+            }
+        } else {
+            cache = selectCache(hours, intervalSeconds);
+        }
+
+        // 未取得の場合はmicroSDの保存データから始め、以降の差分のみを取得する
+        if (cache && cache->isEmpty()) {
+            loadFromStore(cache, hours, intervalSeconds);
+        }
+        // 保存データが表示範囲より古い場合は差分ではなく表示範囲全体を取得し直す
+        if (cache && !cache->isEmpty() && clockValid &&
+            cache->getNewestTime() < now - hours * 3600) {
+            cache->clear();
         }
+
+        if (useRollup) {
+            // ロールアップの取得範囲は上で決めている
+        } else if (!cache || cache->isEmpty()) {
+            fetchFull = true;
+        } else {
+            // 末尾: 更新間隔が経過していれば最後のウィンドウ以降のみ取得
+            int32_t windowEnd = cache->getNewestTime();
+            if (!cache->isFresh(updateIntervalMillis)) {
+                fetchTail = true;
+                tailFrom = alignDown(windowEnd - 1, intervalSeconds);
+                if (clockValid && now > windowEnd) {
+                    windowEnd = (int32_t)now;
+                }
+            }
+
+            // 先頭: 末尾の取得後の表示範囲がキャッシュより古い場合は不足分のみ取得
+            int32_t windowStart = windowEnd - hours * 3600;
+            if (windowStart < cache->getCoveredFrom()) {
+                fetchHead = true;
+                headFrom = alignDown(windowStart, intervalSeconds);
+            }
+        }
+
+        if (fetchFull || fetchTail || fetchHead) {
+            addSeriesColumns(fullContext, timeColumn);
+            tailContext = fullContext;
+            headContext = fullContext;
+            fullContext.series = &fullPoints;
+            tailContext.series = &tailPoints;
+            headContext.series = &headPoints;
+            fullPoints.resize(fullContext.seriesCount);
+            tailPoints.resize(fullContext.seriesCount);
+            headPoints.resize(fullContext.seriesCount);
+            headBuckets.resize(fullContext.seriesCount);
+        }
+        // ロールアップの末尾は最も細かい1分値を取得する
+        int queryInterval = useRollup ? RollupPyramid::getLevelSeconds(0) : intervalSeconds;
+        if (fetchFull) {
+            // 表示範囲分を先に確保し、解析中の再確保を避ける
+            int32_t span = useRollup ? (int32_t)now - rollupFrom : hours * 3600;
+            for (auto &points : fullPoints) {
+                points.reserve((size_t)span / queryInterval + 2);
+            }
+            if (useRollup) {
+                snprintf(fullStart, sizeof(fullStart), "%ld", (long)rollupFrom);
+            } else {
+                snprintf(fullStart, sizeof(fullStart), "-%dh", hours);
+            }
+            FluxParams params = {"series", fullStart, "now()", nullptr, queryInterval};
+            batch.add(seriesTemplate, params, appendSeriesRow, &fullContext);
+        }
+        if (fetchTail) {
+            snprintf(tailStart, sizeof(tailStart), "%ld", (long)tailFrom);
+            FluxParams params = {"tail", tailStart, "now()", nullptr, queryInterval};
+            batch.add(seriesTemplate, params, appendSeriesRow, &tailContext);
+        }
+        if (fetchHead && useRollup) {
+            // 1分値の保持期間より前なので、表示するレベルの間隔で平均/最小/最大/件数を集計する
+            headContext.buckets = &headBuckets;
+            headContext.bucketSeconds = RollupPyramid::getLevelSeconds(rollupLevel);
+            snprintf(headStart, sizeof(headStart), "%ld", (long)headFrom);
+            snprintf(headStop, sizeof(headStop), "%ld", (long)rollup.getCoveredFrom(rollupLevel));
+            FluxParams params = {"head", headStart, headStop, nullptr, headContext.bucketSeconds};
+            batch.add(bucketTemplate, params, appendBucketRow, &headContext);
+        } else if (fetchHead) {
+            snprintf(headStart, sizeof(headStart), "%ld", (long)headFrom);
+            snprintf(headStop, sizeof(headStop), "%ld", (long)cache->getCoveredFrom());
+            FluxParams params = {"head", headStart, headStop, nullptr, queryInterval};
+            batch.add(seriesTemplate, params, appendSeriesRow, &headContext);
+        }
+    }
+
+    // --- 月間使用量: 最新の積算値は更新間隔ごと、月初の値は月が変わった時のみ取得 ---
+    EdgeValueContext latestContext;
+    EdgeValueContext monthStartContext;
+    bool fetchLatest = false;
+    bool fetchMonthStart = false;
+
+    if (monthlyUsage) {
+        fetchLatest = latestCumulativeMillis == 0 ||
+                      millis() - latestCumulativeMillis >= updateIntervalMillis;
+        fetchMonthStart = monthStartKey == 0 || (clockValid && monthKeyOf(now) != monthStartKey);
+
+        if (fetchLatest || fetchMonthStart) {
+            latestContext.timeColumn = timeColumn;
+            latestContext.valueColumn = csvParser.addColumn("_value");
+            latestContext.found = false;
+            monthStartContext = latestContext;
+        }
+        if (fetchLatest) {
+            // 通常は直近1時間で足りる（欠測時のみ後で30日分をさかのぼる）
+            FluxParams params = {"latest", "-1h", "now()", "last", 0};
+            batch.add(cumulativeTemplate, params, storeEdgeValue, &latestContext);
+        }
+        if (fetchMonthStart) {
+            // 月初はサーバの時計で求める（月初のデータが無い場合は今月の最古データ）
+            batch.addImport("date");
+            FluxParams params = {"monthStart", "date.truncate(t: now(), unit: 1mo)", "now()",
+                                 "first", 0};
+            batch.add(cumulativeTemplate, params, storeEdgeValue, &monthStartContext);
+        }
+    }
+
+    // --- 1回のリクエストで実行 ---
+    bool fetched = false;
+    lastRefreshOk = batch.isEmpty();
+    if (!batch.isEmpty()) {
+        batch.attach(csvParser);
+        unsigned long startMillis = millis();
+        fetched = runBatch(batch, csvParser);
+        lastRefreshOk = fetched;
+
+        // 行ごとには出力せず、リクエストごとに1行の要約を出す
+        LOG_I("Refresh query with %d parts: %u rows in %lu ms", batch.size(),
+              (unsigned)csvParser.getRowCount(), millis() - startMillis);
     }
 
-    monthStartResult.close();
+    // --- 系列の結果をキャッシュへ反映 ---
+    if (series) {
+        if (useRollup) {
+            // 取得結果をロールアップへ反映し、表示範囲は画素の密度に合うレベルから切り出す
+            if (fetched && fetchFull) {
+                rollup.append(fullPoints);
+                for (int level = 0; level < RollupPyramid::LEVEL_COUNT; level++) {
+                    rollup.setCoveredFrom(level, rollupFrom);
+                }
+                rollup.markSynced(now);
+            }
+            if (fetched && fetchTail) {
+                rollup.append(tailPoints);
+                rollup.markSynced(now);
+            }
+            if (fetched && fetchHead) {
+                rollup.prepend(rollupLevel, headFrom, headBuckets);
+                LOG_D("Rollup level %d backfilled from %ld", rollupLevel, (long)headFrom);
+            }
+            if (fetched) {
+                saveRollupToStore();
+            }
+            if (!rollup.isEmpty()) {
+                int32_t newest = rollup.getNewestTime();
+                rollup.copyRange(rollupLevel, newest - hours * 3600, newest, *series);
+            }
+        } else if (!cache) {
+            // キャッシュが使えない場合は取得結果をそのまま返す
+            series->swap(fullPoints);
+        } else if (fetchFull && fetched) {
+            // 先頭の時刻は範囲の開始で切り詰められた不完全なウィンドウなので捨てる
+            int32_t firstTime = 0;
+            bool hasData = false;
+            for (const auto &points : fullPoints) {
+                if (!points.empty() && (!hasData || points.front().time < firstTime)) {
+                    firstTime = points.front().time;
+                    hasData = true;
+                }
+            }
+            if (hasData) {
+                for (auto &points : fullPoints) {
+                    if (!points.empty() && points.front().time == firstTime) {
+                        points.erase(points.begin());
+                    }
+                }
+                cache->setCoveredFrom(firstTime);
+                cache->append(fullPoints);
+                cache->markSynced();
+            }
+        } else if (fetched) {
+            if (fetchTail) {
+                cache->truncateAfter(tailFrom);
+                cache->append(tailPoints);
+                cache->markSynced();
+                LOG_D("Cache tail updated: %u points", (unsigned)tailPoints[0].size());
+            }
+            if (fetchHead) {
+                cache->setCoveredFrom(headFrom);
+                cache->prepend(headPoints);
+                LOG_D("Cache head updated: %u points", (unsigned)headPoints[0].size());
+            }
+        }
+
+        // キャッシュから表示範囲を切り出し、確定したウィンドウをmicroSDに追記する
+        if (cache && !cache->isEmpty()) {
+            int32_t newest = cache->getNewestTime();
+            cache->copyRange(newest - hours * 3600, newest, *series);
+            saveToStore(cache);
+        }
+
+        if (!series->empty()) {
+            LOG_I("Series %dh every %ds: %u points in %u series", hours, intervalSeconds,
+                  (unsigned)(*series)[0].size(), (unsigned)series->size());
+        }
+    }
 
-    if (!hasMonthStart) {
-        Serial.println("No data found for current month");
+    if (!monthlyUsage) {
         return false;
     }
 
-    // ステップ4: 差分を計算
-    monthlyUsage = latestValue - monthStartValue;
-    if (monthlyUsage < 0) {
-        monthlyUsage = 0;
+    // --- 月間使用量の結果を反映 ---
+    if (fetchLatest) {
+        float value;
+        int32_t time;
+        if (fetched && latestContext.found) {
+            value = latestContext.value;
+            time = latestContext.time;
+        } else if (!fetchCumulativeEnergy("-30d", "now()", "last", value, time)) {
+            // 取得できなかった場合は前回の値を使い続ける
+            if (latestCumulativeMillis == 0) {
+                LOG_W("No latest cumulative energy data found");
+                return false;
+            }
+            time = 0;
+        }
+        if (time != 0) {
+            latestCumulative = value;
+            latestCumulativeTime = time;
+            latestCumulativeMillis = millis();
+            LOG_D("Latest cumulative energy: %.3f at %ld", value, (long)time);
+        }
+    }
+    if (fetchMonthStart && fetched && monthStartContext.found) {
+        monthStartKey = monthKeyOf(monthStartContext.time);
+        monthStartValue = monthStartContext.value;
+        LOG_I("Month start value for %d: %.3f", monthStartKey, monthStartValue);
+    }
+
+    // 最新値と月初の値の月が異なる場合（時計の同期前に月が変わった場合など）は個別に取得する
+    int latestKey = monthKeyOf(latestCumulativeTime);
+    if (latestKey != monthStartKey) {
+        int year = latestKey / 100;
+        int month = latestKey % 100;
+        int nextMonth = month + 1;
+        int nextYear = year;
+        if (nextMonth > 12) {
+            nextMonth = 1;
+            nextYear++;
+        }
+
+        char monthStartTime[32];
+        char monthEndTime[32];
+        snprintf(monthStartTime, sizeof(monthStartTime), "%04d-%02d-01T00:00:00Z", year, month);
+        snprintf(monthEndTime, sizeof(monthEndTime), "%04d-%02d-01T00:00:00Z", nextYear, nextMonth);
+
+        float value;
+        int32_t time;
+        if (!fetchCumulativeEnergy(monthStartTime, monthEndTime, "first", value, time)) {
+            LOG_W("No data found for current month");
+            return false;
+        }
+
+        monthStartKey = latestKey;
+        monthStartValue = value;
+        LOG_I("Month start value for %04d-%02d: %.3f", year, month, value);
+    }
+
+    // 差分を計算
+    *monthlyUsage = latestCumulative - monthStartValue;
+    if (*monthlyUsage < 0) {
+        *monthlyUsage = 0;
     }
 
-    Serial.println("Monthly energy usage: " + String(monthlyUsage) + " kWh");
+    LOG_I("Monthly energy usage: %.1f kWh", *monthlyUsage);
     return true;
 }
 
 bool InfluxDBManager::isConnected() {
-    // Wi-Fi接続状態とInfluxDBクライアントの状態をチェック
-    return WiFi.status() == WL_CONNECTED && client != nullptr;
+    // Wi-Fi接続状態とクエリ先の設定状態をチェック
+    return WiFi.status() == WL_CONNECTED && ready;
 }
\ No newline at end of file
@@ -1,29 +1,102 @@
 #pragma once
 
-#include <InfluxDbClient.h>
-#include <InfluxDbCloud.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
 #include <vector>
+#include "DataPoint.h"
+#include "SeriesCache.h"
+#include "SeriesStore.h"
+#include "RollupPyramid.h"
+#include "FluxCsvParser.h"
+#include "FluxBatch.h"
+#include "FluxTemplate.h"
 
-struct DataPoint {
-    String timestamp;
-    float value;
-};
+#include "../../include/ConfigManager.h"
 
-class ConfigManager; // 前方宣言
+struct SeriesRowContext; // 前方宣言
 
 class InfluxDBManager {
 private:
-    ::InfluxDBClient* client;
     ConfigManager* config;
-    String buildFluxQuery();
+    bool ready;
+    bool lastRefreshOk;
+    // クエリ応答を直接受信するためのトランスポート（keep-aliveでクエリ間で使い回す）
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+    HTTPClient queryHttp;
+    String queryUrl;
+    String queryHost;
+    uint16_t queryPort;
+    bool queryTls;
+    FluxCsvParser csvParser;
+    void parseServerUrl();
+    // 集計間隔ごとのキャッシュ（時間範囲の切り替えごとに解像度が変わるため複数保持）
+    static const int MAX_SERIES_CACHES = 8;
+    SeriesCacheSet seriesCaches[MAX_SERIES_CACHES];
+    unsigned long cacheLastUsed[MAX_SERIES_CACHES];
+    bool streamQuery(const char* query, size_t length, FluxCsvParser& parser);
+    bool runBatch(const FluxBatch& batch, FluxCsvParser& parser);
+
+    // クエリの雛形と列名は設定時に一度だけ組み立て、クエリ本文は固定の領域に書き込む
+    static const size_t QUERY_BUFFER_SIZE = 8192;
+    char* queryBuffer;
+    String authHeader;
+    FluxTemplate seriesTemplate;
+    FluxTemplate bucketTemplate;
+    FluxTemplate cumulativeTemplate;
+    String seriesColumnNames[MAX_DATA_SOURCES][4];
+    void compileTemplates();
+    void addSeriesColumns(SeriesRowContext& context, int timeColumn);
+    SeriesCacheSet* selectCache(int hours, int aggregateSeconds);
+    void getDataSource(int index, String& measurement, String& field) const;
+    int getSeriesCount() const;
+    // microSDの保存データ（未設定/未挿入の場合は使わない）
+    SeriesStore* store;
+    uint32_t getStoreSeriesId(int index) const;
+    bool loadFromStore(SeriesCacheSet* cache, int hours, int aggregateSeconds);
+    void saveToStore(SeriesCacheSet* cache);
+    // 長い時間範囲用のロールアップ（直近は1分値から集計し、それより前は粗いレベルを直接取得する）
+    RollupPyramid rollup;
+    uint32_t getRollupStoreId(int index) const;
+    bool loadRollupFromStore(int32_t notBefore);
+    void saveRollupToStore();
+    long getTargetSeconds(int hours) const;
+    int32_t getRollupSpan(int hours) const;
+
+    // 月間使用量の計算用キャッシュ
+    int monthStartKey;  // 年*100+月（0は未取得）
+    float monthStartValue;
+    float latestCumulative;
+    int32_t latestCumulativeTime;
+    unsigned long latestCumulativeMillis;
+    bool fetchCumulativeEnergy(const char* rangeStart, const char* rangeStop,
+                               const char* selector, float& value, int32_t& time);
+
+    // 系列と月間使用量のうち指定されたものを1回のリクエストで取得する
+    // 戻り値は月間使用量を計算できたかどうか
+    bool runRefresh(int hours, SeriesSet* series, float* monthlyUsage);
     
 public:
     InfluxDBManager();
     ~InfluxDBManager();
+    // データソースの構成を変更した場合は呼び直す（クエリの雛形を組み立て直し、キャッシュを空にする）
+    // 取得タスクの実行中は呼ばない（DataFetcher::tryLock()が成功した間に呼ぶ）
     void setConfig(ConfigManager* configManager);
+    void setSeriesStore(SeriesStore* seriesStore);
+    // クエリ先を設定する（通信はせず、サーバの疎通は最初のクエリで確認する）
     bool connect();
-    std::vector<DataPoint> getData(int hours = -1);
+    // 設定されたデータソースの順に系列ごとの点列を返す
+    SeriesSet getData(int hours = -1);
+    // ネットワークを使わずにmicroSDの保存データのみを返す（起動直後の表示用）
+    SeriesSet getStoredData(int hours);
+    int getAggregateSeconds(int hours) const;
     float getLatestValue();
     bool getMonthlyEnergyUsage(float &monthlyUsage);
+    // 1回の更新に必要な系列と月間使用量をまとめて取得する（戻り値は月間使用量の有無）
+    bool refresh(int hours, SeriesSet& series, float& monthlyUsage);
     bool isConnected();
+    // 直前の更新でクエリが成功したか（失敗時は早めに再試行するために使う）
+    bool lastRefreshSucceeded() const { return lastRefreshOk; }
+    // ロールアップの過去分の取得が表示範囲に届いていないか（取得タスクが続けて更新する）
+    bool hasPendingBackfill(int hours) const;
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "MetricsServer.h"
+#include <string.h>
+#include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
+#include "../common/Metrics.h"
+
+// 応答の本文（Metrics::format()の出力）
+static char responseBody[2048];
+
+MetricsServer::MetricsServer()
+    : config(nullptr), server(nullptr), active(false), clientMillis(0), requestLength(0),
+      requestLineDone(false), lineEmpty(true) {}
+
+MetricsServer::~MetricsServer() { end(); }
+
+void MetricsServer::setConfig(ConfigManager *configManager) { config = configManager; }
+
+bool MetricsServer::begin() {
+    if (server) {
+        return true;
+    }
+    if (!config || !config->getSystemConfig().enableMetricsServer) {
+        return false;
+    }
+
+    int port = config->getSystemConfig().metricsPort;
+    server = new WiFiServer(port);
+    server->begin();
+    LOG_I("Metrics available at http://%s:%d/metrics", WiFi.localIP().toString().c_str(), port);
+    return true;
+}
+
+void MetricsServer::end() {
+    if (active) {
+        client.stop();
+        active = false;
+    }
+    if (server) {
+        server->end();
+        delete server;
+        server = nullptr;
+    }
+}
+
+void MetricsServer::poll() {
+    if (!server) {
+        return;
+    }
+
+    if (!active) {
+        client = server->accept();
+        if (!client) {
+            return;
+        }
+        active = true;
+        clientMillis = millis();
+        requestLength = 0;
+        requestLineDone = false;
+        lineEmpty = true;
+    }
+
+    // 要求行だけを覚え、ヘッダは空行まで読み飛ばす
+    while (active && client.available() > 0) {
+        char c = (char)client.read();
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            if (lineEmpty && requestLineDone) {
+                respond();
+                return;
+            }
+            requestLineDone = true;
+            lineEmpty = true;
+            continue;
+        }
+        lineEmpty = false;
+        if (!requestLineDone && requestLength < sizeof(requestLine) - 1) {
+            requestLine[requestLength++] = c;
+        }
+    }
+
+    if (active && (!client.connected() || millis() - clientMillis > CLIENT_TIMEOUT_MS)) {
+        client.stop();
+        active = false;
+    }
+}
+
+void MetricsServer::respond() {
+    requestLine[requestLength] = '\0';
+
+    if (strncmp(requestLine, "GET /metrics ", 13) == 0 || strncmp(requestLine, "GET / ", 6) == 0) {
+        size_t length = Metrics::format(responseBody, sizeof(responseBody));
+        client.printf("HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\n"
+                      "Content-Length: %u\r\nConnection: close\r\n\r\n",
+                      (unsigned)length);
+        client.write((const uint8_t *)responseBody, length);
+    } else {
+        client.print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+
+    client.stop();
+    active = false;
+}
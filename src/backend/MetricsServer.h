@@ -0,0 +1,35 @@
+#pragma once
+
+#include <WiFi.h>
+
+class ConfigManager; // 前方宣言
+
+// LAN内からMetricsの内容をテキストで取得できるようにするHTTPサーバ（GET /metrics）
+// loop()から呼ぶpoll()は待たずに戻り、1接続ずつ応答する
+class MetricsServer {
+private:
+    static const unsigned long CLIENT_TIMEOUT_MS = 2000;
+
+    ConfigManager* config;
+    WiFiServer* server;
+    WiFiClient client;
+    bool active;
+    unsigned long clientMillis;
+    char requestLine[64];
+    size_t requestLength;
+    bool requestLineDone;
+    bool lineEmpty;
+
+    void respond();
+
+public:
+    MetricsServer();
+    ~MetricsServer();
+    void setConfig(ConfigManager* configManager);
+
+    // Wi-Fiの接続後に呼ぶ（設定で無効な場合は何もしない）
+    bool begin();
+    // 設定の変更でポートや有効/無効が変わった場合に止める（begin()で再開する）
+    void end();
+    void poll();
+};
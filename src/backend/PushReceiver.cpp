@@ -0,0 +1,265 @@
+#include "PushReceiver.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <env.h>
+#include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
+#include "../common/TokenAuth.h"
+
+// これより前の時刻はNTP未同期とみなす（2020-01-01）
+static const time_t CLOCK_VALID_EPOCH = 1577836800;
+
+PushReceiver::PushReceiver()
+    : config(nullptr), server(nullptr), state(STATE_IDLE), clientMillis(0), acceptWrite(false),
+      authorized(false), precisionDivisor(1000000000L), bodyLength(0), bodyReceived(0),
+      lineLength(0), lineOverflow(false) {}
+
+PushReceiver::~PushReceiver() { end(); }
+
+void PushReceiver::setConfig(ConfigManager *configManager) { config = configManager; }
+
+bool PushReceiver::begin() {
+    if (server) {
+        return true;
+    }
+    if (!config || !config->getSystemConfig().enablePushIngest) {
+        return false;
+    }
+
+    int port = config->getSystemConfig().pushPort;
+    server = new WiFiServer(port);
+    server->begin();
+    LOG_I("Push receiver listening on port %d", port);
+    return true;
+}
+
+void PushReceiver::end() {
+    if (client) {
+        client.stop();
+    }
+    state = STATE_IDLE;
+    if (server) {
+        server->end();
+        delete server;
+        server = nullptr;
+    }
+}
+
+void PushReceiver::poll(std::vector<LivePoint> &out) {
+    if (!server) {
+        return;
+    }
+
+    if (state == STATE_IDLE) {
+        client = server->accept();
+        if (!client) {
+            return;
+        }
+        state = STATE_REQUEST_LINE;
+        clientMillis = millis();
+        acceptWrite = false;
+        authorized = false;
+        precisionDivisor = 1000000000L;
+        bodyLength = 0;
+        bodyReceived = 0;
+        lineLength = 0;
+        lineOverflow = false;
+    }
+
+    // 届いている分だけ読み、残りは次のpoll()で続きから読む
+    uint8_t buffer[128];
+    while (state != STATE_IDLE) {
+        int available = client.available();
+        if (available <= 0) {
+            break;
+        }
+        int n = client.read(buffer, available < (int)sizeof(buffer) ? available : sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+
+        for (int i = 0; i < n && state != STATE_IDLE; i++) {
+            char c = (char)buffer[i];
+            if (state == STATE_BODY) {
+                bodyReceived++;
+            }
+
+            if (c == '\n') {
+                handleLine(out);
+            } else if (c != '\r') {
+                if (lineLength < LINE_SIZE - 1) {
+                    line[lineLength++] = c;
+                } else {
+                    lineOverflow = true;
+                }
+            }
+
+            // 本文の最後の行は改行で終わらない場合がある
+            if (state == STATE_BODY && bodyReceived >= bodyLength) {
+                if (lineLength > 0) {
+                    handleLine(out);
+                }
+                respond(204, "No Content");
+            }
+        }
+    }
+
+    if (state != STATE_IDLE && (!client.connected() || millis() - clientMillis > CLIENT_TIMEOUT_MS)) {
+        LOG_W("Push request timed out");
+        client.stop();
+        state = STATE_IDLE;
+    }
+}
+
+void PushReceiver::handleLine(std::vector<LivePoint> &out) {
+    line[lineLength] = '\0';
+    bool overflow = lineOverflow;
+    lineLength = 0;
+    lineOverflow = false;
+
+    switch (state) {
+        case STATE_REQUEST_LINE:
+            parseRequestLine();
+            state = STATE_HEADERS;
+            break;
+
+        case STATE_HEADERS:
+            if (line[0] != '\0') {
+                if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                    bodyLength = strtoul(line + 15, nullptr, 10);
+                } else if (strncasecmp(line, "Authorization:", 14) == 0) {
+                    authorized = !overflow && TokenAuth::check(line + 14);
+                }
+                break;
+            }
+            // ヘッダの終わり
+            if (!acceptWrite) {
+                respond(404, "Not Found");
+            } else if (!authorized) {
+                LOG_W_EVERY(10000, "Push request rejected: missing or wrong token");
+                respond(401, "Unauthorized");
+            } else if (bodyLength > MAX_BODY_SIZE) {
+                respond(413, "Payload Too Large");
+            } else if (bodyLength == 0) {
+                respond(204, "No Content");
+            } else {
+                state = STATE_BODY;
+            }
+            break;
+
+        case STATE_BODY:
+            // 1行に収まらない点とコメント行は読み飛ばす
+            if (!overflow && line[0] != '\0' && line[0] != '#') {
+                parsePoint(line, out);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void PushReceiver::parseRequestLine() {
+    // 例: POST /api/v2/write?org=home&bucket=hems&precision=s HTTP/1.1
+    acceptWrite = strncmp(line, "POST /api/v2/write", 18) == 0 || strncmp(line, "POST /write", 11) == 0;
+
+    const char *precision = strstr(line, "precision=");
+    if (!precision) {
+        return;
+    }
+    precision += 10;
+    if (strncmp(precision, "ms", 2) == 0) {
+        precisionDivisor = 1000L;
+    } else if (strncmp(precision, "us", 2) == 0) {
+        precisionDivisor = 1000000L;
+    } else if (strncmp(precision, "ns", 2) == 0) {
+        precisionDivisor = 1000000000L;
+    } else if (precision[0] == 's') {
+        precisionDivisor = 1;
+    }
+}
+
+void PushReceiver::parsePoint(char *text, std::vector<LivePoint> &out) {
+    // measurement[,tag=value...] field=value[,field=value...] [timestamp]
+    // （エスケープされた空白/カンマを含む名前と文字列フィールドには対応しない）
+    char *fields = strchr(text, ' ');
+    if (!fields) {
+        return;
+    }
+    *fields++ = '\0';
+    char *stamp = strchr(fields, ' ');
+    if (stamp) {
+        *stamp++ = '\0';
+    }
+    char *tags = strchr(text, ',');
+    if (tags) {
+        *tags = '\0';  // タグは使わない
+    }
+
+    int32_t pointTime;
+    if (stamp && *stamp) {
+        pointTime = (int32_t)(strtoll(stamp, nullptr, 10) / precisionDivisor);
+    } else {
+        // タイムスタンプが無い場合は受信時刻（時計が未同期なら配置できないので捨てる）
+        time_t now = time(nullptr);
+        if (now < CLOCK_VALID_EPOCH) {
+            return;
+        }
+        pointTime = (int32_t)now;
+    }
+
+    char *save = nullptr;
+    for (char *field = strtok_r(fields, ",", &save); field; field = strtok_r(nullptr, ",", &save)) {
+        char *equals = strchr(field, '=');
+        if (!equals) {
+            continue;
+        }
+        *equals = '\0';
+
+        int index = findSeries(text, field);
+        if (index < 0) {
+            continue;
+        }
+
+        // 整数（末尾のi/u）も数値として読む。文字列/真偽値は読めないので飛ばす
+        char *end = nullptr;
+        float value = strtof(equals + 1, &end);
+        if (end == equals + 1) {
+            continue;
+        }
+
+        LivePoint live;
+        live.seriesIndex = index;
+        live.point.time = pointTime;
+        live.point.value = value;
+        live.point.min = value;
+        live.point.max = value;
+        out.push_back(live);
+    }
+}
+
+int PushReceiver::findSeries(const char *measurement, const char *field) const {
+    if (!config) {
+        return strcmp(measurement, MEASUREMENT_NAME) == 0 &&
+                       strcmp(field, FIELD_NAME_INSTANT_POWER_W) == 0
+                   ? 0
+                   : -1;
+    }
+
+    const auto &dataSources = config->getDataSources();
+    for (size_t i = 0; i < dataSources.size(); i++) {
+        if (dataSources[i].measurement == measurement && dataSources[i].field == field) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void PushReceiver::respond(int status, const char *reason) {
+    client.printf("HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status,
+                  reason);
+    client.stop();
+    state = STATE_IDLE;
+}
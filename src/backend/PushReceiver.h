@@ -0,0 +1,59 @@
+#pragma once
+
+#include <WiFi.h>
+#include <vector>
+#include "DataPoint.h"
+
+class ConfigManager; // 前方宣言
+
+// InfluxDBの書き込みAPI（/api/v2/write, /write）と同じ形式のラインプロトコルを受け付ける
+// 受信した点のうち設定のデータソースに一致するものを取り出す（InfluxDBへの転送はしない）
+// 書き込みにはInfluxDBと同じ「Authorization: Token <トークン>」が必要（トークンはINFLUXDB_TOKEN）
+// loop()から呼ぶpoll()は待たずに戻り、1接続ずつ少しずつ読み進める
+class PushReceiver {
+private:
+    static const size_t LINE_SIZE = 512;
+    static const size_t MAX_BODY_SIZE = 16384;
+    static const unsigned long CLIENT_TIMEOUT_MS = 2000;
+
+    enum State {
+        STATE_IDLE,
+        STATE_REQUEST_LINE,
+        STATE_HEADERS,
+        STATE_BODY,
+    };
+
+    ConfigManager* config;
+    WiFiServer* server;
+    WiFiClient client;
+    State state;
+    unsigned long clientMillis;
+    bool acceptWrite;     // 書き込みのパスか
+    bool authorized;      // Authorizationヘッダのトークンが一致したか
+    long precisionDivisor;  // タイムスタンプ→秒
+    size_t bodyLength;
+    size_t bodyReceived;
+    char line[LINE_SIZE];
+    size_t lineLength;
+    bool lineOverflow;
+
+    void handleLine(std::vector<LivePoint>& out);
+    void parseRequestLine();
+    void parsePoint(char* text, std::vector<LivePoint>& out);
+    int findSeries(const char* measurement, const char* field) const;
+    void respond(int status, const char* reason);
+
+public:
+    PushReceiver();
+    ~PushReceiver();
+    void setConfig(ConfigManager* configManager);
+
+    // Wi-Fiの接続後に呼ぶ（設定で無効な場合は何もしない）
+    bool begin();
+    // 設定の変更でポートや有効/無効が変わった場合に止める（begin()で再開する）
+    void end();
+    bool isRunning() const { return server != nullptr; }
+
+    // 受信済みのデータを処理し、取り出した点をoutへ追加する（outは呼び出し側で使い回す）
+    void poll(std::vector<LivePoint>& out);
+};
@@ -0,0 +1,316 @@
+#include "RollupPyramid.h"
+#include <esp_heap_caps.h>
+#include "../common/Logger.h"
+
+// レベルごとの集計間隔（秒）と保持するバケット数
+// 1分は粗いレベルの末尾を集計し直すための作業用で、表示には15分以上を使う
+static const int LEVEL_SECONDS[RollupPyramid::LEVEL_COUNT] = {60, 900, 3600, 86400};
+static const size_t LEVEL_CAPACITY[RollupPyramid::LEVEL_COUNT] = {
+    2 * 1440,  // 2日
+    100 * 96,  // 100日
+    400 * 24,  // 400日
+    5 * 366,   // 5年
+};
+
+static int32_t alignDown(int32_t time, int seconds) { return (time / seconds) * seconds; }
+
+// 子のバケットを親のバケットへ合算する
+static void mergeBucket(RollupBucket &target, const RollupBucket &child) {
+    if (target.count == 0) {
+        target.min = child.min;
+        target.max = child.max;
+    } else {
+        if (child.min < target.min)
+            target.min = child.min;
+        if (child.max > target.max)
+            target.max = child.max;
+    }
+    target.sum += child.sum;
+    target.count += child.count;
+}
+
+// 昇順のバケット列を1つ粗い間隔にまとめる
+static void aggregateBuckets(const std::vector<RollupBucket> &finer, int seconds,
+                             std::vector<RollupBucket> &out) {
+    out.clear();
+    for (const auto &bucket : finer) {
+        int32_t start = alignDown(bucket.time, seconds);
+        if (out.empty() || out.back().time != start) {
+            RollupBucket merged = {start, 0, 0, 0, 0};
+            out.push_back(merged);
+        }
+        mergeBucket(out.back(), bucket);
+    }
+}
+
+RollupLevel::RollupLevel() : buffer(nullptr), capacity(0), head(0), count(0) {}
+
+RollupLevel::~RollupLevel() {
+    if (buffer) {
+        heap_caps_free(buffer);
+        buffer = nullptr;
+    }
+}
+
+bool RollupLevel::begin(size_t bucketCapacity) {
+    if (buffer && capacity == bucketCapacity) {
+        clear();
+        return true;
+    }
+
+    if (buffer) {
+        heap_caps_free(buffer);
+        buffer = nullptr;
+    }
+
+    // 大きなバッファはPSRAMに確保し、無い場合は内部RAMにフォールバック
+    size_t bytes = bucketCapacity * sizeof(RollupBucket);
+    buffer = (RollupBucket *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buffer) {
+        buffer = (RollupBucket *)heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    if (!buffer) {
+        capacity = 0;
+        LOG_E("RollupLevel: buffer allocation failed (%u buckets)", (unsigned)bucketCapacity);
+        return false;
+    }
+
+    capacity = bucketCapacity;
+    clear();
+    return true;
+}
+
+void RollupLevel::clear() {
+    head = 0;
+    count = 0;
+}
+
+size_t RollupLevel::lowerBound(int32_t time) const {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (at(mid).time < time) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void RollupLevel::put(const RollupBucket &bucket) {
+    if (capacity == 0)
+        return;
+
+    if (count > 0) {
+        if (bucket.time < back().time)
+            return;
+        if (bucket.time == back().time) {
+            buffer[(head + count - 1) % capacity] = bucket;
+            return;
+        }
+    }
+
+    if (count == capacity) {
+        // 最古のバケットを破棄
+        head = (head + 1) % capacity;
+        count--;
+    }
+    buffer[(head + count) % capacity] = bucket;
+    count++;
+}
+
+void RollupLevel::prepend(const std::vector<RollupBucket> &buckets) {
+    if (capacity == 0 || buckets.empty())
+        return;
+
+    // 既存の最古より古いバケットのみを対象にする
+    size_t end = buckets.size();
+    if (count > 0) {
+        int32_t oldest = at(0).time;
+        while (end > 0 && buckets[end - 1].time >= oldest) {
+            end--;
+        }
+    }
+
+    // 入りきらない古いバケットは破棄
+    size_t space = capacity - count;
+    size_t begin = end > space ? end - space : 0;
+
+    for (size_t i = end; i > begin; i--) {
+        head = (head + capacity - 1) % capacity;
+        buffer[head] = buckets[i - 1];
+        count++;
+    }
+}
+
+RollupPyramid::RollupPyramid()
+    : seriesCount(0), newestTime(0), syncedTime(0), lastSyncMillis(0) {
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        coveredFrom[level] = 0;
+    }
+}
+
+bool RollupPyramid::begin(int count) {
+    if (count < 1 || count > MAX_DATA_SOURCES) {
+        return false;
+    }
+    if (count == seriesCount) {
+        return true;
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            if (!levels[i][level].begin(LEVEL_CAPACITY[level])) {
+                seriesCount = 0;
+                return false;
+            }
+        }
+    }
+    seriesCount = count;
+    clear();
+    return true;
+}
+
+void RollupPyramid::clear() {
+    for (int i = 0; i < seriesCount; i++) {
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            levels[i][level].clear();
+        }
+    }
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        coveredFrom[level] = 0;
+    }
+    newestTime = 0;
+    syncedTime = 0;
+    lastSyncMillis = 0;
+}
+
+bool RollupPyramid::isEmpty() const {
+    for (int i = 0; i < seriesCount; i++) {
+        if (!levels[i][LEVEL_COUNT - 1].isEmpty())
+            return false;
+    }
+    return true;
+}
+
+void RollupPyramid::addMinute(int index, const DataPoint &point) {
+    RollupLevel *series = levels[index];
+
+    // 点の時刻はウィンドウの終端（最後の点は集計途中で現在時刻）なので開始時刻に直す
+    int32_t start = alignDown(point.time - 1, LEVEL_SECONDS[0]);
+    if (!series[0].isEmpty() && start < series[0].back().time)
+        return;
+
+    RollupBucket minute = {start, point.value, point.min, point.max, 1};
+    series[0].put(minute);
+    if (point.time > newestTime)
+        newestTime = point.time;
+
+    // 粗いレベルは、この点を含むバケットだけを1つ細かいレベルの末尾から集計し直す
+    for (int level = 1; level < LEVEL_COUNT; level++) {
+        const RollupLevel &finer = series[level - 1];
+        RollupBucket merged = {alignDown(start, LEVEL_SECONDS[level]), 0, 0, 0, 0};
+        for (size_t i = finer.size(); i > 0 && finer.at(i - 1).time >= merged.time; i--) {
+            mergeBucket(merged, finer.at(i - 1));
+        }
+        series[level].put(merged);
+    }
+}
+
+void RollupPyramid::append(const SeriesSet &minutePoints) {
+    for (int i = 0; i < seriesCount && i < (int)minutePoints.size(); i++) {
+        for (const auto &point : minutePoints[i]) {
+            addMinute(i, point);
+        }
+    }
+}
+
+void RollupPyramid::prepend(int level, int32_t from, const RollupBucketSet &buckets) {
+    // 取得済みの範囲がこのレベルと同じ粗いレベルにも集計して追加する
+    int last = level;
+    while (last + 1 < LEVEL_COUNT && coveredFrom[last + 1] == coveredFrom[level]) {
+        last++;
+    }
+
+    std::vector<RollupBucket> finer;
+    std::vector<RollupBucket> coarser;
+    for (int i = 0; i < seriesCount && i < (int)buckets.size(); i++) {
+        finer = buckets[i];
+        // 区間は日単位なので、既存のバケットと合算が必要な境界は無い
+        for (int target = level; target <= last; target++) {
+            levels[i][target].prepend(finer);
+            if (target < last) {
+                aggregateBuckets(finer, LEVEL_SECONDS[target + 1], coarser);
+                finer.swap(coarser);
+            }
+        }
+    }
+
+    for (int target = level; target <= last; target++) {
+        coveredFrom[target] = from;
+    }
+}
+
+void RollupPyramid::copyRange(int level, int32_t start, int32_t stop, SeriesSet &out) const {
+    out.clear();
+    out.resize(seriesCount);
+    for (int i = 0; i < seriesCount; i++) {
+        copyRange(level, i, start, stop, out[i]);
+    }
+}
+
+void RollupPyramid::copyRange(int level, int index, int32_t start, int32_t stop,
+                              std::vector<DataPoint> &out) const {
+    out.clear();
+
+    // 時刻はキャッシュと同じくウィンドウの終端とする（集計途中の最新バケットは最新の時刻）
+    int seconds = LEVEL_SECONDS[level];
+    const RollupLevel &buckets = levels[index][level];
+    size_t first = buckets.lowerBound(start - seconds);
+    for (size_t j = first; j < buckets.size() && buckets.at(j).time <= stop; j++) {
+        const RollupBucket &bucket = buckets.at(j);
+        int32_t end = bucket.time + seconds;
+        if (end > newestTime)
+            end = newestTime;
+        if (end < start || bucket.count == 0)
+            continue;
+        DataPoint point = {end, bucket.sum / bucket.count, bucket.min, bucket.max};
+        out.push_back(point);
+    }
+}
+
+bool RollupPyramid::isFresh(unsigned long maxAgeMillis) const {
+    if (lastSyncMillis == 0)
+        return false;
+    return millis() - lastSyncMillis < maxAgeMillis;
+}
+
+void RollupPyramid::markSynced(int32_t time) {
+    syncedTime = time;
+    lastSyncMillis = millis();
+}
+
+void RollupPyramid::restore(int32_t time) {
+    newestTime = time;
+    coveredFrom[0] = time;
+    syncedTime = time;
+    lastSyncMillis = 0;
+}
+
+int RollupPyramid::getLevelSeconds(int level) { return LEVEL_SECONDS[level]; }
+
+int32_t RollupPyramid::getRetentionSeconds(int level) {
+    return (int32_t)LEVEL_CAPACITY[level] * LEVEL_SECONDS[level];
+}
+
+int RollupPyramid::selectLevel(long targetSeconds, int hours) {
+    int32_t span = hours * 3600;
+    int level = LEVEL_COUNT - 1;
+    while (level > 0 && LEVEL_SECONDS[level] > targetSeconds &&
+           getRetentionSeconds(level - 1) >= span) {
+        level--;
+    }
+    return level;
+}
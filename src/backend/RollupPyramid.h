@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include "DataPoint.h"
+#include "../../include/ConfigManager.h"
+
+// 集計バケット（開始時刻と合計/最小/最大/件数）。平均は合計/件数で求める
+struct RollupBucket {
+    int32_t time;
+    float sum;
+    float min;
+    float max;
+    uint32_t count;
+};
+
+// 系列ごとのバケット列（並びは設定のデータソース順）
+typedef std::vector<std::vector<RollupBucket>> RollupBucketSet;
+
+// 1つのレベルのバケットを時刻昇順に保持するリングバッファ（PSRAMに確保）
+class RollupLevel {
+private:
+    RollupBucket* buffer;
+    size_t capacity;
+    size_t head;  // 最古のバケットの位置
+    size_t count;
+
+public:
+    RollupLevel();
+    ~RollupLevel();
+
+    bool begin(size_t bucketCapacity);
+    void clear();
+
+    bool isEmpty() const { return count == 0; }
+    size_t size() const { return count; }
+    const RollupBucket& at(size_t i) const { return buffer[(head + i) % capacity]; }
+    const RollupBucket& back() const { return at(count - 1); }
+    size_t lowerBound(int32_t time) const;
+
+    // 末尾と同じ時刻なら置き換え、新しければ追加（満杯の場合は最古を破棄）
+    void put(const RollupBucket& bucket);
+    // 最古より古いバケットを先頭に追加（bucketsは昇順、入りきらない古い分は破棄）
+    void prepend(const std::vector<RollupBucket>& buckets);
+};
+
+// 1分/15分/1時間/1日のバケットを系列ごとに保持するロールアップ
+// 末尾は1分の点を取得して粗いレベルを手元で集計し、1分の保持期間より前は
+// 粗いレベルのバケットをそのまま取得して先頭に追加する
+// 時刻軸は全系列で共通とし、取得済みの範囲はレベルごとに持つ
+class RollupPyramid {
+public:
+    static const int LEVEL_COUNT = 4;
+
+private:
+    RollupLevel levels[MAX_DATA_SOURCES][LEVEL_COUNT];
+    int seriesCount;
+    int32_t newestTime;  // 最新の1分値の時刻（集計ウィンドウの終端）
+    int32_t coveredFrom[LEVEL_COUNT];  // 取得済みの範囲の開始時刻（データが無い区間も含む）
+    int32_t syncedTime;  // 最後に末尾を取得した時刻（0は未取得）
+    unsigned long lastSyncMillis;
+
+    void addMinute(int index, const DataPoint& point);
+
+public:
+    RollupPyramid();
+
+    // 初回のみ確保する（系列数が変わった場合は空にする）
+    bool begin(int count);
+    void clear();
+
+    bool isEmpty() const;
+    int getSeriesCount() const { return seriesCount; }
+    int32_t getNewestTime() const { return newestTime; }
+    // 0は未取得
+    int32_t getCoveredFrom(int level) const { return coveredFrom[level]; }
+    void setCoveredFrom(int level, int32_t time) { coveredFrom[level] = time; }
+
+    // 1分間隔の点（時刻は集計ウィンドウの終端）を末尾に追加し、粗いレベルへ反映する
+    void append(const SeriesSet& minutePoints);
+    // levelのバケット（[from, 取得済みの範囲の開始)の日単位の区間）を先頭に追加する
+    // 取得済みの範囲が同じ粗いレベルにも集計して追加し、それらの範囲の開始をfromにする
+    void prepend(int level, int32_t from, const RollupBucketSet& buckets);
+    // 指定レベルの[start, stop]の範囲を集計済みの点として切り出す
+    void copyRange(int level, int32_t start, int32_t stop, SeriesSet& out) const;
+    void copyRange(int level, int index, int32_t start, int32_t stop,
+                   std::vector<DataPoint>& out) const;
+
+    // 末尾の同期状態（末尾は最後に取得した時刻を含む1分から取り直す）
+    bool isFresh(unsigned long maxAgeMillis) const;
+    int32_t getSyncedTime() const { return syncedTime; }
+    void markSynced(int32_t time);
+    // 保存データから粗いレベルを戻した場合の終端（次の更新でこの時刻以降の1分値を取得する）
+    void restore(int32_t time);
+
+    static int getLevelSeconds(int level);
+    // レベルごとに保持できる期間（秒）
+    static int32_t getRetentionSeconds(int level);
+    // 目標の集計間隔以下で最も粗いレベル（保持期間がhoursに足りない場合はより粗いレベル）
+    static int selectLevel(long targetSeconds, int hours);
+};
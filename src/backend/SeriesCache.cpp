@@ -0,0 +1,237 @@
+#include "SeriesCache.h"
+#include <esp_heap_caps.h>
+#include "../common/Logger.h"
+
+SeriesCache::SeriesCache()
+    : buffer(nullptr), capacity(0), head(0), count(0), intervalSeconds(0), coveredFrom(0),
+      lastSyncMillis(0) {}
+
+SeriesCache::~SeriesCache() {
+    if (buffer) {
+        heap_caps_free(buffer);
+        buffer = nullptr;
+    }
+}
+
+bool SeriesCache::begin(size_t pointCapacity, int interval) {
+    if (buffer && capacity == pointCapacity) {
+        intervalSeconds = interval;
+        clear();
+        return true;
+    }
+
+    if (buffer) {
+        heap_caps_free(buffer);
+        buffer = nullptr;
+    }
+
+    // 大きなバッファはPSRAMに確保し、無い場合は内部RAMにフォールバック
+    size_t bytes = pointCapacity * sizeof(DataPoint);
+    buffer = (DataPoint*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buffer) {
+        buffer = (DataPoint*)heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    if (!buffer) {
+        capacity = 0;
+        LOG_E("SeriesCache: buffer allocation failed (%u points)", (unsigned)pointCapacity);
+        return false;
+    }
+
+    capacity = pointCapacity;
+    intervalSeconds = interval;
+    clear();
+    return true;
+}
+
+void SeriesCache::clear() {
+    head = 0;
+    count = 0;
+    coveredFrom = 0;
+    lastSyncMillis = 0;
+}
+
+int32_t SeriesCache::getOldestTime() const { return count > 0 ? at(0).time : 0; }
+
+int32_t SeriesCache::getNewestTime() const { return count > 0 ? at(count - 1).time : 0; }
+
+void SeriesCache::setCoveredFrom(int32_t time) { coveredFrom = time; }
+
+void SeriesCache::append(const DataPoint &point) {
+    if (capacity == 0)
+        return;
+
+    // 時刻が既存の末尾以前の点は無視（順序を保つ）
+    if (count > 0 && point.time <= getNewestTime())
+        return;
+
+    if (count == capacity) {
+        // 最古の点を破棄
+        head = (head + 1) % capacity;
+        count--;
+        coveredFrom = at(0).time - intervalSeconds;
+    }
+
+    buffer[(head + count) % capacity] = point;
+    count++;
+}
+
+void SeriesCache::prepend(const std::vector<DataPoint> &points) {
+    if (capacity == 0 || points.empty())
+        return;
+
+    // 既存の最古より古い点のみを対象にする
+    size_t end = points.size();
+    if (count > 0) {
+        int32_t oldest = getOldestTime();
+        while (end > 0 && points[end - 1].time >= oldest) {
+            end--;
+        }
+    }
+
+    // 入りきらない古い点は破棄
+    size_t space = capacity - count;
+    size_t begin = end > space ? end - space : 0;
+
+    for (size_t i = end; i > begin; i--) {
+        head = (head + capacity - 1) % capacity;
+        buffer[head] = points[i - 1];
+        count++;
+    }
+}
+
+void SeriesCache::truncateAfter(int32_t time) {
+    while (count > 0 && at(count - 1).time > time) {
+        count--;
+    }
+}
+
+size_t SeriesCache::lowerBound(int32_t time) const {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (at(mid).time < time) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void SeriesCache::copyRange(int32_t start, int32_t stop, std::vector<DataPoint> &out) const {
+    out.clear();
+
+    size_t first = lowerBound(start);
+    size_t last = first;
+    while (last < count && at(last).time <= stop) {
+        last++;
+    }
+
+    out.reserve(last - first);
+    for (size_t i = first; i < last; i++) {
+        out.push_back(at(i));
+    }
+}
+
+bool SeriesCache::isFresh(unsigned long maxAgeMillis) const {
+    if (lastSyncMillis == 0 || count == 0)
+        return false;
+    return millis() - lastSyncMillis < maxAgeMillis;
+}
+
+SeriesCacheSet::SeriesCacheSet() : seriesCount(0) {}
+
+bool SeriesCacheSet::begin(size_t pointCapacity, int interval, int count) {
+    if (count < 1 || count > MAX_DATA_SOURCES) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!series[i].begin(pointCapacity, interval)) {
+            seriesCount = 0;
+            return false;
+        }
+    }
+    seriesCount = count;
+    return true;
+}
+
+void SeriesCacheSet::clear() {
+    for (int i = 0; i < seriesCount; i++) {
+        series[i].clear();
+    }
+}
+
+bool SeriesCacheSet::isEmpty() const {
+    for (int i = 0; i < seriesCount; i++) {
+        if (!series[i].isEmpty())
+            return false;
+    }
+    return true;
+}
+
+int32_t SeriesCacheSet::getNewestTime() const {
+    int32_t newest = 0;
+    for (int i = 0; i < seriesCount; i++) {
+        if (!series[i].isEmpty() && series[i].getNewestTime() > newest)
+            newest = series[i].getNewestTime();
+    }
+    return newest;
+}
+
+int32_t SeriesCacheSet::getCoveredFrom() const {
+    // 満杯で古い点を捨てた系列があれば、その系列に合わせて範囲を狭める
+    int32_t coveredFrom = series[0].getCoveredFrom();
+    for (int i = 1; i < seriesCount; i++) {
+        if (series[i].getCoveredFrom() > coveredFrom)
+            coveredFrom = series[i].getCoveredFrom();
+    }
+    return coveredFrom;
+}
+
+void SeriesCacheSet::setCoveredFrom(int32_t time) {
+    for (int i = 0; i < seriesCount; i++) {
+        series[i].setCoveredFrom(time);
+    }
+}
+
+void SeriesCacheSet::append(const SeriesSet &points) {
+    for (int i = 0; i < seriesCount && i < (int)points.size(); i++) {
+        for (const auto &point : points[i]) {
+            series[i].append(point);
+        }
+    }
+}
+
+void SeriesCacheSet::prepend(const SeriesSet &points) {
+    for (int i = 0; i < seriesCount && i < (int)points.size(); i++) {
+        series[i].prepend(points[i]);
+    }
+}
+
+void SeriesCacheSet::truncateAfter(int32_t time) {
+    for (int i = 0; i < seriesCount; i++) {
+        series[i].truncateAfter(time);
+    }
+}
+
+void SeriesCacheSet::copyRange(int32_t start, int32_t stop, SeriesSet &out) const {
+    out.resize(seriesCount);
+    for (int i = 0; i < seriesCount; i++) {
+        series[i].copyRange(start, stop, out[i]);
+    }
+}
+
+bool SeriesCacheSet::isFresh(unsigned long maxAgeMillis) const {
+    for (int i = 0; i < seriesCount; i++) {
+        if (series[i].isFresh(maxAgeMillis))
+            return true;
+    }
+    return false;
+}
+
+void SeriesCacheSet::markSynced() {
+    for (int i = 0; i < seriesCount; i++) {
+        series[i].markSynced();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include "DataPoint.h"
+#include "../../include/ConfigManager.h"
+
+// 取得済みの集計データをPSRAM上のリングバッファに保持する時系列キャッシュ
+// 時刻は昇順で保持し、範囲外の先頭/末尾のみを追加取得できるようにする
+class SeriesCache {
+private:
+    DataPoint* buffer;
+    size_t capacity;
+    size_t head;  // 最古の点の位置
+    size_t count;
+    int intervalSeconds;
+    int32_t coveredFrom;  // 取得済みの範囲の開始時刻（データが無い区間も含む）
+    unsigned long lastSyncMillis;
+
+    const DataPoint& at(size_t i) const { return buffer[(head + i) % capacity]; }
+    size_t lowerBound(int32_t time) const;
+
+public:
+    SeriesCache();
+    ~SeriesCache();
+
+    bool begin(size_t pointCapacity, int interval);
+    void clear();
+
+    bool isEmpty() const { return count == 0; }
+    size_t size() const { return count; }
+    int getIntervalSeconds() const { return intervalSeconds; }
+    int32_t getOldestTime() const;
+    int32_t getNewestTime() const;
+    int32_t getCoveredFrom() const { return coveredFrom; }
+    void setCoveredFrom(int32_t time);
+
+    // 末尾に追加（満杯の場合は最古の点を破棄）
+    void append(const DataPoint& point);
+    // 先頭に追加（pointsは昇順、入りきらない古い点は破棄）
+    void prepend(const std::vector<DataPoint>& points);
+    // 指定時刻より新しい点を削除
+    void truncateAfter(int32_t time);
+    // [start, stop] の点をコピー
+    void copyRange(int32_t start, int32_t stop, std::vector<DataPoint>& out) const;
+
+    // 末尾の同期状態
+    bool isFresh(unsigned long maxAgeMillis) const;
+    void markSynced() { lastSyncMillis = millis(); }
+};
+
+// 同じクエリで更新する複数系列のキャッシュ
+// 系列ごとにSeriesCacheを持ち、時刻軸と取得済みの範囲は全系列で共通として扱う
+class SeriesCacheSet {
+private:
+    SeriesCache series[MAX_DATA_SOURCES];
+    int seriesCount;
+
+public:
+    SeriesCacheSet();
+
+    bool begin(size_t pointCapacity, int interval, int count);
+    void clear();
+
+    bool isEmpty() const;
+    int getSeriesCount() const { return seriesCount; }
+    int getIntervalSeconds() const { return series[0].getIntervalSeconds(); }
+    const SeriesCache& getSeries(int index) const { return series[index]; }
+    int32_t getNewestTime() const;
+    int32_t getCoveredFrom() const;
+    void setCoveredFrom(int32_t time);
+
+    // 系列ごとの点列を各系列に追加/削除/切り出し（SeriesCacheと同じ規則）
+    void append(const SeriesSet& points);
+    void prepend(const SeriesSet& points);
+    void truncateAfter(int32_t time);
+    void copyRange(int32_t start, int32_t stop, SeriesSet& out) const;
+
+    bool isFresh(unsigned long maxAgeMillis) const;
+    void markSynced();
+};
@@ -0,0 +1,490 @@
+#include "SeriesStore.h"
+#include <FS.h>
+#include <SD_MMC.h>
+#include <unistd.h>
+#include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
+
+static const char *STORE_DIR = "/hems";
+static const uint32_t STORE_MAGIC = 0x53534D48;  // "HMSS"
+static const uint16_t STORE_VERSION = 1;
+
+// データファイルの先頭に置くヘッダ。以降はDataPointの固定長レコードが時刻順に並ぶ
+struct StoreHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    int32_t intervalSeconds;
+    uint32_t seriesId;
+};
+
+static_assert(sizeof(DataPoint) == 16, "DataPoint record size changed");
+
+// 読み出し時に一度に読むレコード数
+static const size_t READ_CHUNK = 32;
+
+static bool readRecord(File &file, size_t index, DataPoint &point) {
+    if (!file.seek(sizeof(StoreHeader) + index * sizeof(DataPoint))) {
+        return false;
+    }
+    return file.read((uint8_t *)&point, sizeof(point)) == sizeof(point);
+}
+
+SeriesStore::SeriesStore() : mounted(false), maxRecords(DEFAULT_MAX_RECORDS), nextSlot(0) {
+    for (int i = 0; i < MAX_OPEN_SERIES; i++) {
+        series[i].seriesId = 0;
+        series[i].intervalSeconds = 0;
+        series[i].count = 0;
+        series[i].oldestTime = 0;
+        series[i].newestTime = 0;
+    }
+}
+
+bool SeriesStore::begin(const char *mountPoint) {
+    if (mounted) {
+        return true;
+    }
+
+    SD_MMC.setPins(SD_CARD_CLK, SD_CARD_CMD, SD_CARD_D0, SD_CARD_D1, SD_CARD_D2, SD_CARD_D3);
+    if (!SD_MMC.begin(mountPoint, false, false)) {
+        LOG_W("SeriesStore: microSD not available");
+        return false;
+    }
+    if (!SD_MMC.exists(STORE_DIR) && !SD_MMC.mkdir(STORE_DIR)) {
+        LOG_E("SeriesStore: failed to create %s", STORE_DIR);
+        SD_MMC.end();
+        return false;
+    }
+
+    this->mountPoint = mountPoint;
+    mounted = true;
+    LOG_I("SeriesStore: microSD mounted (%u MB)", (unsigned)(SD_MMC.cardSize() / (1024 * 1024)));
+    return true;
+}
+
+uint32_t SeriesStore::seriesId(const String &key) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char *p = key.c_str(); *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+String SeriesStore::basePath(const Series &entry) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%08lx_%d", (unsigned long)entry.seriesId, entry.intervalSeconds);
+    return String(STORE_DIR) + name;
+}
+
+SeriesStore::Series *SeriesStore::open(uint32_t seriesId, int intervalSeconds, bool create) {
+    if (!mounted || intervalSeconds <= 0) {
+        return nullptr;
+    }
+
+    for (int i = 0; i < MAX_OPEN_SERIES; i++) {
+        if (series[i].seriesId == seriesId && series[i].intervalSeconds == intervalSeconds) {
+            return &series[i];
+        }
+    }
+
+    // 空きが無い場合は順番に入れ替える（ファイルは残るので次に開いた時に読み直す）
+    Series *entry = nullptr;
+    for (int i = 0; i < MAX_OPEN_SERIES; i++) {
+        if (series[i].intervalSeconds == 0) {
+            entry = &series[i];
+            break;
+        }
+    }
+    if (!entry) {
+        entry = &series[nextSlot];
+        nextSlot = (nextSlot + 1) % MAX_OPEN_SERIES;
+    }
+
+    entry->seriesId = seriesId;
+    entry->intervalSeconds = intervalSeconds;
+    entry->count = 0;
+    entry->oldestTime = 0;
+    entry->newestTime = 0;
+    entry->index.clear();
+    if (!load(*entry, create)) {
+        entry->intervalSeconds = 0;
+        return nullptr;
+    }
+    return entry;
+}
+
+bool SeriesStore::load(Series &entry, bool create) {
+    String path = basePath(entry) + ".bin";
+    if (!SD_MMC.exists(path)) {
+        // 詰め直しの置き換えの途中で止まった場合は、書き終えている新しいファイルを使う
+        // （索引は古いファイルのものなので作り直させる）
+        String replacement = basePath(entry) + ".tmp";
+        if (!SD_MMC.exists(replacement)) {
+            return create && this->create(entry);
+        }
+        SD_MMC.remove(basePath(entry) + ".idx");
+        if (!SD_MMC.rename(replacement, path)) {
+            return false;
+        }
+    }
+    File file = SD_MMC.open(path, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    StoreHeader header;
+    size_t size = file.size();
+    bool valid = size >= sizeof(header) &&
+                 file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                 header.magic == STORE_MAGIC && header.version == STORE_VERSION &&
+                 header.recordSize == sizeof(DataPoint) && header.seriesId == entry.seriesId &&
+                 header.intervalSeconds == entry.intervalSeconds;
+
+    // 末尾の不完全なレコード（書き込み途中の電源断など）は件数に含めない
+    DataPoint first, last;
+    size_t records = valid ? (size - sizeof(header)) / sizeof(DataPoint) : 0;
+    bool torn = valid && (size - sizeof(header)) % sizeof(DataPoint) != 0;
+    if (valid && records > 0) {
+        valid = readRecord(file, 0, first) && readRecord(file, records - 1, last);
+    }
+    file.close();
+
+    if (!valid) {
+        // 形式が異なるファイルは追記の時に作り直す（読み出しでは触らない）
+        if (!create) {
+            return false;
+        }
+        LOG_W("SeriesStore: discarding %s", path.c_str());
+        return this->create(entry);
+    }
+
+    entry.count = records;
+    if (records > 0) {
+        entry.oldestTime = first.time;
+        entry.newestTime = last.time;
+    }
+
+    if (torn) {
+        // 保存済みのレコードは残し、不完全な末尾のみを切り詰めて索引を作り直す
+        LOG_W("SeriesStore: dropping a torn record at the end of %s (%u records kept)",
+              path.c_str(), (unsigned)records);
+        return truncate(entry) && rebuildIndex(entry);
+    }
+
+    // 索引を読み込み、件数が合わない場合はデータから作り直す
+    size_t expected = (records + INDEX_STRIDE - 1) / INDEX_STRIDE;
+    File indexFile = SD_MMC.open(basePath(entry) + ".idx", FILE_READ);
+    if (indexFile && indexFile.size() == expected * sizeof(int32_t)) {
+        entry.index.resize(expected);
+        size_t bytes = expected * sizeof(int32_t);
+        bool loaded = bytes == 0 || indexFile.read((uint8_t *)entry.index.data(), bytes) == bytes;
+        indexFile.close();
+        if (loaded) {
+            return true;
+        }
+    } else if (indexFile) {
+        indexFile.close();
+    }
+    return rebuildIndex(entry);
+}
+
+bool SeriesStore::create(Series &entry) {
+    String path = basePath(entry);
+    SD_MMC.remove(path + ".idx");
+
+    File file = SD_MMC.open(path + ".bin", FILE_WRITE);
+    if (!file) {
+        LOG_E("SeriesStore: failed to create file for %ds", entry.intervalSeconds);
+        return false;
+    }
+
+    StoreHeader header = {STORE_MAGIC, STORE_VERSION, (uint16_t)sizeof(DataPoint),
+                          entry.intervalSeconds, entry.seriesId};
+    bool written = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    file.close();
+
+    entry.count = 0;
+    entry.oldestTime = 0;
+    entry.newestTime = 0;
+    entry.index.clear();
+    return written;
+}
+
+bool SeriesStore::truncate(Series &entry) {
+    // ArduinoのFileには切り詰めの操作が無いので、VFS（FAT）のtruncate()を使う
+    String path = basePath(entry) + ".bin";
+    off_t length = (off_t)(sizeof(StoreHeader) + entry.count * sizeof(DataPoint));
+    if (::truncate((mountPoint + path).c_str(), length) == 0) {
+        return true;
+    }
+
+    // 切り詰められない場合は完全なレコードのみを書き直す
+    LOG_W("SeriesStore: truncate failed for %s, rewriting", path.c_str());
+    return rewrite(entry, 0);
+}
+
+bool SeriesStore::rewrite(Series &entry, size_t first, const DataPoint *prefix,
+                          size_t prefixCount) {
+    // first件目以降を一時ファイルへ書き出してから置き換える（索引は呼び出し側で作り直す）
+    String path = basePath(entry);
+    File source = SD_MMC.open(path + ".bin", FILE_READ);
+    File target = SD_MMC.open(path + ".tmp", FILE_WRITE);
+    bool ok = source && target && source.seek(sizeof(StoreHeader) + first * sizeof(DataPoint));
+
+    StoreHeader header = {STORE_MAGIC, STORE_VERSION, (uint16_t)sizeof(DataPoint),
+                          entry.intervalSeconds, entry.seriesId};
+    ok = ok && target.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+
+    int32_t oldest = 0;
+    if (prefixCount > 0) {
+        size_t bytes = prefixCount * sizeof(DataPoint);
+        ok = ok && target.write((const uint8_t *)prefix, bytes) == bytes;
+        oldest = prefix[0].time;
+    }
+
+    DataPoint chunk[READ_CHUNK];
+    for (size_t position = first; ok && position < entry.count; position += READ_CHUNK) {
+        size_t n = entry.count - position;
+        if (n > READ_CHUNK) {
+            n = READ_CHUNK;
+        }
+        size_t bytes = n * sizeof(DataPoint);
+        ok = source.read((uint8_t *)chunk, bytes) == bytes &&
+             target.write((const uint8_t *)chunk, bytes) == bytes;
+        if (position == first && prefixCount == 0) {
+            oldest = chunk[0].time;
+        }
+    }
+    if (source) {
+        source.close();
+    }
+    if (target) {
+        target.close();
+    }
+
+    // 削除から改名までの間に止まった場合は、次に開いた時に一時ファイルを使う
+    if (!ok || !SD_MMC.remove(path + ".bin") || !SD_MMC.rename(path + ".tmp", path + ".bin")) {
+        LOG_E("SeriesStore: failed to rewrite %s", path.c_str());
+        SD_MMC.remove(path + ".tmp");
+        return false;
+    }
+
+    if (entry.count == first && prefixCount > 0) {
+        entry.newestTime = prefix[prefixCount - 1].time;
+    }
+    entry.count = entry.count - first + prefixCount;
+    entry.oldestTime = entry.count > 0 ? oldest : 0;
+    if (entry.count == 0) {
+        entry.newestTime = 0;
+    }
+    return true;
+}
+
+bool SeriesStore::rebuildIndex(Series &entry) {
+    String path = basePath(entry);
+    File file = SD_MMC.open(path + ".bin", FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    entry.index.clear();
+    entry.index.reserve((entry.count + INDEX_STRIDE - 1) / INDEX_STRIDE);
+    for (size_t i = 0; i < entry.count; i += INDEX_STRIDE) {
+        DataPoint point;
+        if (!readRecord(file, i, point)) {
+            file.close();
+            return false;
+        }
+        entry.index.push_back(point.time);
+    }
+    file.close();
+
+    // 索引ファイルの書き込みに失敗しても、メモリ上の索引で動作は続けられる
+    File indexFile = SD_MMC.open(path + ".idx", FILE_WRITE);
+    if (indexFile) {
+        indexFile.write((const uint8_t *)entry.index.data(), entry.index.size() * sizeof(int32_t));
+        indexFile.close();
+    }
+
+    LOG_I("SeriesStore: rebuilt index for %s (%u records)", path.c_str(), (unsigned)entry.count);
+    return true;
+}
+
+bool SeriesStore::getRange(uint32_t seriesId, int intervalSeconds, int32_t &oldest,
+                           int32_t &newest) {
+    Series *entry = open(seriesId, intervalSeconds, false);
+    if (!entry || entry->count == 0) {
+        return false;
+    }
+    oldest = entry->oldestTime;
+    newest = entry->newestTime;
+    return true;
+}
+
+size_t SeriesStore::read(uint32_t seriesId, int intervalSeconds, int32_t start, int32_t stop,
+                         std::vector<DataPoint> &out) {
+    out.clear();
+
+    Series *entry = open(seriesId, intervalSeconds, false);
+    if (!entry || entry->count == 0 || stop < start || stop < entry->oldestTime ||
+        start > entry->newestTime) {
+        return 0;
+    }
+
+    // 索引を二分探索して開始時刻を含むブロックの先頭から読む
+    size_t lo = 0;
+    size_t hi = entry->index.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (entry->index[mid] <= start) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t position = (lo > 0 ? lo - 1 : 0) * INDEX_STRIDE;
+
+    File file = SD_MMC.open(basePath(*entry) + ".bin", FILE_READ);
+    if (!file || !file.seek(sizeof(StoreHeader) + position * sizeof(DataPoint))) {
+        LOG_E_EVERY(10000, "SeriesStore: failed to read %ds", intervalSeconds);
+        return 0;
+    }
+
+    out.reserve((size_t)(stop - start) / intervalSeconds + 1);
+    DataPoint chunk[READ_CHUNK];
+    bool done = false;
+    while (!done && position < entry->count) {
+        size_t n = entry->count - position;
+        if (n > READ_CHUNK) {
+            n = READ_CHUNK;
+        }
+        size_t bytes = n * sizeof(DataPoint);
+        if (file.read((uint8_t *)chunk, bytes) != bytes) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (chunk[i].time > stop) {
+                done = true;
+                break;
+            }
+            if (chunk[i].time >= start) {
+                out.push_back(chunk[i]);
+            }
+        }
+        position += n;
+    }
+    file.close();
+
+    return out.size();
+}
+
+size_t SeriesStore::append(uint32_t seriesId, int intervalSeconds,
+                           const std::vector<DataPoint> &points) {
+    Series *entry = open(seriesId, intervalSeconds, true);
+    if (!entry) {
+        return 0;
+    }
+
+    // 保存済みの末尾以前の点は飛ばす（時刻順を保つ）
+    size_t begin = 0;
+    if (entry->count > 0) {
+        while (begin < points.size() && points[begin].time <= entry->newestTime) {
+            begin++;
+        }
+    }
+    if (begin == points.size()) {
+        return 0;
+    }
+
+    // 上限を超える分は古い側を捨てる（追記のたびに詰め直さないよう上限の3/4まで減らす）
+    size_t added = points.size() - begin;
+    if (added > maxRecords) {
+        begin = points.size() - maxRecords;
+        added = maxRecords;
+    }
+    if (entry->count + added > maxRecords) {
+        size_t target = maxRecords * 3 / 4;
+        size_t keep = target > added ? target - added : 0;
+        if (keep > entry->count) {
+            keep = entry->count;
+        }
+        size_t dropped = entry->count - keep;
+        if (!rewrite(*entry, dropped) || !rebuildIndex(*entry)) {
+            entry->intervalSeconds = 0;
+            return 0;
+        }
+        LOG_I("SeriesStore: dropped %u old records every %ds", (unsigned)dropped,
+              intervalSeconds);
+    }
+
+    String path = basePath(*entry);
+    File file = SD_MMC.open(path + ".bin", FILE_APPEND);
+    if (!file) {
+        LOG_E_EVERY(10000, "SeriesStore: failed to open %ds for append", intervalSeconds);
+        return 0;
+    }
+
+    size_t bytes = added * sizeof(DataPoint);
+    size_t written = file.write((const uint8_t *)&points[begin], bytes);
+    file.close();
+    if (written != bytes) {
+        // 途中まで書かれたレコードは次に開いた時に検出して切り詰める
+        LOG_E("SeriesStore: write failed for %ds", intervalSeconds);
+        entry->intervalSeconds = 0;
+        return 0;
+    }
+
+    // 新たにブロックの先頭になったレコードの時刻を索引に追記
+    size_t indexed = entry->index.size();
+    for (size_t i = 0; i < added; i++) {
+        if ((entry->count + i) % INDEX_STRIDE == 0) {
+            entry->index.push_back(points[begin + i].time);
+        }
+    }
+    if (entry->index.size() > indexed) {
+        File indexFile = SD_MMC.open(path + ".idx", FILE_APPEND);
+        if (indexFile) {
+            indexFile.write((const uint8_t *)&entry->index[indexed],
+                            (entry->index.size() - indexed) * sizeof(int32_t));
+            indexFile.close();
+        }
+    }
+
+    if (entry->count == 0) {
+        entry->oldestTime = points[begin].time;
+    }
+    entry->count += added;
+    entry->newestTime = points.back().time;
+    return added;
+}
+
+size_t SeriesStore::prepend(uint32_t seriesId, int intervalSeconds,
+                            const std::vector<DataPoint> &points) {
+    Series *entry = open(seriesId, intervalSeconds, true);
+    if (!entry) {
+        return 0;
+    }
+    // 空のファイルへは追記と同じ
+    if (entry->count == 0) {
+        return append(seriesId, intervalSeconds, points);
+    }
+
+    // 保存済みの先頭以降の点は飛ばし、上限に入りきらない古い点は捨てる
+    size_t end = points.size();
+    while (end > 0 && points[end - 1].time >= entry->oldestTime) {
+        end--;
+    }
+    size_t space = entry->count < maxRecords ? maxRecords - entry->count : 0;
+    size_t begin = end > space ? end - space : 0;
+    if (begin == end) {
+        return 0;
+    }
+
+    size_t added = end - begin;
+    if (!rewrite(*entry, 0, &points[begin], added) || !rebuildIndex(*entry)) {
+        entry->intervalSeconds = 0;
+        return 0;
+    }
+    return added;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include "DataPoint.h"
+
+// 集計済みの点をmicroSDに時刻順の固定長レコードとして保存する時系列ストア（主に末尾へ追記する）
+// 系列と集計間隔の組ごとに1ファイルとし、INDEX_STRIDE件ごとの時刻を索引ファイルに持つ
+// ファイルは系列ごとの上限件数を超えたら古い側を捨てて詰め直す
+class SeriesStore {
+public:
+    // 1ファイルあたりの既定の上限件数（16バイト/件で8MB、1分値でおよそ1年分）
+    static const size_t DEFAULT_MAX_RECORDS = 512 * 1024;
+
+private:
+    static const int MAX_OPEN_SERIES = 16;
+    static const size_t INDEX_STRIDE = 64;
+
+    // 系列と集計間隔の組ごとのファイル状態
+    struct Series {
+        uint32_t seriesId;
+        int intervalSeconds;  // 0は未使用
+        size_t count;
+        int32_t oldestTime;
+        int32_t newestTime;
+        std::vector<int32_t> index;  // INDEX_STRIDE件ごとの先頭レコードの時刻
+    };
+
+    bool mounted;
+    String mountPoint;
+    size_t maxRecords;
+    Series series[MAX_OPEN_SERIES];
+    int nextSlot;
+
+    // createがfalseの場合はファイルが無ければnullptrを返す（読み出しでファイルを作らない）
+    Series* open(uint32_t seriesId, int intervalSeconds, bool create);
+    bool load(Series& entry, bool create);
+    bool create(Series& entry);
+    bool truncate(Series& entry);
+    // prefixがある場合は先頭にprefixCount件を書いてから既存のfirst件目以降を続ける
+    bool rewrite(Series& entry, size_t first, const DataPoint* prefix = nullptr,
+                 size_t prefixCount = 0);
+    bool rebuildIndex(Series& entry);
+    String basePath(const Series& entry) const;
+
+public:
+    SeriesStore();
+    // microSDをmountPointにマウントする（ホストのテストでは作業用のディレクトリを渡す）
+    bool begin(const char* mountPoint = "/sdcard");
+    bool isReady() const { return mounted; }
+    // 系列ごとの上限件数（超えたら古い側の1/4を捨てる）
+    void setRecordLimit(size_t records) { maxRecords = records > 4 ? records : 4; }
+    size_t getRecordLimit() const { return maxRecords; }
+
+    // 系列（measurement/field）を表すキーからファイルの識別子を求める
+    static uint32_t seriesId(const String& key);
+
+    // 保存済みの最古/最新の時刻（データが無い場合はfalse）
+    bool getRange(uint32_t seriesId, int intervalSeconds, int32_t& oldest, int32_t& newest);
+    // [start, stop] の点を読み出す
+    size_t read(uint32_t seriesId, int intervalSeconds, int32_t start, int32_t stop,
+                std::vector<DataPoint>& out);
+    // 保存済みの末尾より新しい点のみを追記（pointsは昇順）
+    size_t append(uint32_t seriesId, int intervalSeconds, const std::vector<DataPoint>& points);
+    // 保存済みの先頭より古い点のみを先頭に追加（pointsは昇順、ファイルを書き直す）
+    size_t prepend(uint32_t seriesId, int intervalSeconds, const std::vector<DataPoint>& points);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// 単一プロデューサ/単一コンシューマ用のロックフリーなトリプルバッファ
+// プロデューサは書き込み用スロットを埋めてpublish()し、コンシューマはupdate()で
+// 最新のスロットを受け取る。未読の古い値は新しい値で上書きされる（最新値のみ有効）
+template <typename T>
+class TripleBuffer {
+private:
+    static const uint8_t DIRTY = 0x4;
+    static const uint8_t INDEX_MASK = 0x3;
+
+    T slots[3];
+    std::atomic<uint8_t> middle;  // 受け渡し用スロット番号 + 未読フラグ
+    uint8_t back;                 // プロデューサ専用
+    uint8_t front;                // コンシューマ専用
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    // プロデューサ側
+    T& write() { return slots[back]; }
+    void publish() {
+        uint8_t prev = middle.exchange(back | DIRTY, std::memory_order_acq_rel);
+        back = prev & INDEX_MASK;
+    }
+
+    // コンシューマ側
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & DIRTY)) {
+            return false;
+        }
+        uint8_t prev = middle.exchange(front, std::memory_order_acq_rel);
+        front = prev & INDEX_MASK;
+        return true;
+    }
+    T& read() { return slots[front]; }
+};
@@ -1,44 +1,149 @@
 #include "WifiManager.h"
-#include "../../include/env.h"
+#include <env.h>
+#include "../../include/ConfigManager.h"
+#include "../common/Logger.h"
 
-WifiManager::WifiManager() : isConnected(false) {}
+static const char *NTP_SERVER = "pool.ntp.org";
 
-bool WifiManager::connect() {
-    Serial.println("Connecting to Wi-Fi...");
-    WiFi.setPins(GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_11, GPIO_NUM_10, GPIO_NUM_9, GPIO_NUM_8,
-                 GPIO_NUM_15);
+// 再試行までの待ち時間（失敗のたびに倍にし、上限で頭打ち）
+static const unsigned long BACKOFF_INITIAL_MS = 1000;
+static const unsigned long BACKOFF_MAX_MS = 60000;
+
+WifiManager::WifiManager()
+    : config(nullptr), state(WIFI_IDLE), stateMillis(0), retryAtMillis(0),
+      backoffMillis(BACKOFF_INITIAL_MS),
+      attempts(0), reconnected(false), eventsRegistered(false), gotIp(false), linkLost(false) {}
+
+void WifiManager::setConfig(ConfigManager *configManager) { config = configManager; }
+
+void WifiManager::begin() {
+    if (!eventsRegistered) {
+        WiFi.setPins(GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_11, GPIO_NUM_10, GPIO_NUM_9, GPIO_NUM_8,
+                     GPIO_NUM_15);
+        // 再接続の間隔はここで管理するため、ドライバの自動再接続は使わない
+        WiFi.setAutoReconnect(false);
+        WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { onEvent(event); });
+        eventsRegistered = true;
+    }
+
+    backoffMillis = BACKOFF_INITIAL_MS;
+    attempts = 0;
+    startAttempt();
+}
+
+void WifiManager::onEvent(arduino_event_id_t event) {
+    // イベントタスク上で呼ばれるため、フラグを立てるだけにする
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            gotIp.store(true);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            linkLost.store(true);
+            break;
+        default:
+            break;
+    }
+}
+
+void WifiManager::setState(WifiState next) {
+    state = next;
+    stateMillis = millis();
+}
+
+unsigned long WifiManager::getConnectTimeoutMillis() const {
+    int seconds = 30;
+    if (config) {
+        seconds = config->getSystemConfig().reconnectTimeoutSeconds;
+    }
+    return (unsigned long)seconds * 1000;
+}
+
+void WifiManager::startAttempt() {
+    attempts++;
+    LOG_I("Connecting to Wi-Fi (attempt %d)...", attempts);
+    gotIp.store(false);
+    linkLost.store(false);
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    setState(WIFI_CONNECTING);
+}
 
-    int attempts = 0;
-    const int maxAttempts = 30; // 30 seconds timeout
+void WifiManager::scheduleRetry() {
+    WiFi.disconnect();
 
-    while (WiFi.status() != WL_CONNECTED && attempts < maxAttempts) {
-        delay(1000);
-        Serial.print(".");
-        attempts++;
+    if (config && !config->getSystemConfig().enableWiFiReconnect) {
+        LOG_W("Wi-Fi reconnect disabled");
+        setState(WIFI_IDLE);
+        return;
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        isConnected = true;
-        Serial.println();
-        Serial.println("Wi-Fi connected!");
-        Serial.print("IP address: ");
-        Serial.println(WiFi.localIP());
-        return true;
-    } else {
-        isConnected = false;
-        Serial.println();
-        Serial.println("Wi-Fi connection failed!");
-        return false;
+    // 複数台が同時に再接続しないよう、待ち時間に最大25%のジッタを加える
+    unsigned long delayMillis = backoffMillis + random(backoffMillis / 4 + 1);
+    backoffMillis = backoffMillis * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : backoffMillis * 2;
+    LOG_W("Wi-Fi retry in %lu ms", delayMillis);
+
+    setState(WIFI_BACKOFF);
+    retryAtMillis = stateMillis + delayMillis;
+}
+
+void WifiManager::update() {
+    unsigned long now = millis();
+
+    switch (state) {
+        case WIFI_CONNECTING:
+            if (gotIp.exchange(false)) {
+                LOG_I("Wi-Fi connected! IP address: %s", WiFi.localIP().toString().c_str());
+                linkLost.store(false);
+                backoffMillis = BACKOFF_INITIAL_MS;
+                attempts = 0;
+                reconnected = true;
+                setState(WIFI_CONNECTED);
+
+                // グラフの時間軸を実時刻に合わせるためNTPで時刻を同期（UTC）
+                configTime(0, 0, NTP_SERVER);
+            } else if (now - stateMillis >= getConnectTimeoutMillis()) {
+                LOG_W("Wi-Fi connection timed out");
+                scheduleRetry();
+            } else if (linkLost.exchange(false) && WiFi.status() != WL_CONNECTED) {
+                // 接続中に届く切断通知は認証失敗など（応答が来るまで待たずに再試行へ）
+                LOG_W("Wi-Fi connection failed!");
+                scheduleRetry();
+            }
+            break;
+
+        case WIFI_CONNECTED:
+            if (linkLost.exchange(false)) {
+                LOG_W("Wi-Fi disconnected");
+                scheduleRetry();
+            }
+            break;
+
+        case WIFI_BACKOFF:
+            if ((long)(now - retryAtMillis) >= 0) {
+                startAttempt();
+            }
+            break;
+
+        case WIFI_IDLE:
+        default:
+            break;
     }
 }
 
-bool WifiManager::isWifiConnected() { return WiFi.status() == WL_CONNECTED && isConnected; }
+bool WifiManager::consumeReconnected() {
+    bool result = reconnected;
+    reconnected = false;
+    return result;
+}
+
+bool WifiManager::isWifiConnected() {
+    return state == WIFI_CONNECTED && WiFi.status() == WL_CONNECTED;
+}
 
 void WifiManager::disconnect() {
     WiFi.disconnect();
-    isConnected = false;
-    Serial.println("Wi-Fi disconnected");
+    setState(WIFI_IDLE);
+    LOG_I("Wi-Fi disconnected");
 }
 
 String WifiManager::getLocalIP() {
@@ -53,4 +158,4 @@ int WifiManager::getSignalStrength() {
         return WiFi.RSSI();
     }
     return 0;
-}
\ No newline at end of file
+}
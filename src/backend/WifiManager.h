@@ -1,16 +1,55 @@
 #pragma once
 
 #include <WiFi.h>
+#include <atomic>
 
+class ConfigManager; // 前方宣言
+
+// Wi-Fiの接続状態（loop()から呼ぶupdate()で遷移させる）
+enum WifiState {
+    WIFI_IDLE,        // 未開始、または再接続が無効で切断された
+    WIFI_CONNECTING,  // 接続待ち
+    WIFI_CONNECTED,
+    WIFI_BACKOFF,     // 失敗後の再試行待ち
+};
+
+// WiFi.onEventの通知で状態を進める非ブロッキングの接続管理
+// 失敗/切断時は指数バックオフ（ジッタ付き）で再接続する
 class WifiManager {
 private:
-    bool isConnected;
+    ConfigManager* config;
+    WifiState state;
+    unsigned long stateMillis;  // 現在の状態に入った時刻
+    unsigned long retryAtMillis;
+    unsigned long backoffMillis;
+    int attempts;
+    bool reconnected;
+    bool eventsRegistered;
+
+    // イベントタスクから立てられるフラグ（update()で取り出す）
+    std::atomic<bool> gotIp;
+    std::atomic<bool> linkLost;
+
+    void onEvent(arduino_event_id_t event);
+    void startAttempt();
+    void scheduleRetry();
+    void setState(WifiState next);
+    unsigned long getConnectTimeoutMillis() const;
     
 public:
     WifiManager();
-    bool connect();
+    void setConfig(ConfigManager* configManager);
+
+    // 接続を開始して直ちに戻る
+    void begin();
+    // 状態を進める（loop()から毎回呼ぶ）
+    void update();
+    // 接続（再接続）が完了した直後に1回だけtrueを返す
+    bool consumeReconnected();
+
+    WifiState getState() const { return state; }
     bool isWifiConnected();
     void disconnect();
     String getLocalIP();
     int getSignalStrength();
-};
\ No newline at end of file
+};
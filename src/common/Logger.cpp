@@ -0,0 +1,107 @@
+#include "Logger.h"
+#include <stdarg.h>
+
+static const size_t LOG_BUFFER_SIZE = 4096;
+static const size_t LOG_LINE_SIZE = 192;
+static const uint32_t DRAIN_TASK_STACK = 3072;
+static const uint32_t DRAIN_INTERVAL_MS = 20;
+
+// 書式化済みのログを蓄えるリングバッファ（複数のタスク/コアから書き込まれる）
+static char logBuffer[LOG_BUFFER_SIZE];
+static size_t logHead = 0;  // 書き込み位置
+static size_t logTail = 0;  // 読み出し位置
+static uint32_t droppedLines = 0;
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile bool logEnabled = true;
+static TaskHandle_t drainTask = nullptr;
+
+// バッファの内容をシリアルへ書き出す
+static void drainLoop(void * /*arg*/) {
+    char chunk[128];
+    for (;;) {
+        size_t length = 0;
+        uint32_t dropped;
+
+        portENTER_CRITICAL(&logMux);
+        while (length < sizeof(chunk) && logTail != logHead) {
+            chunk[length++] = logBuffer[logTail];
+            logTail = (logTail + 1) % LOG_BUFFER_SIZE;
+        }
+        dropped = droppedLines;
+        droppedLines = 0;
+        portEXIT_CRITICAL(&logMux);
+
+        if (dropped > 0) {
+            Serial.printf("[log] %u lines dropped\n", (unsigned)dropped);
+        }
+        if (length > 0) {
+            Serial.write((const uint8_t *)chunk, length);
+            continue;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_INTERVAL_MS));
+    }
+}
+
+void Logger::begin(bool enabled) {
+    logEnabled = enabled;
+    if (drainTask) {
+        return;
+    }
+    xTaskCreatePinnedToCore(drainLoop, "LogDrain", DRAIN_TASK_STACK, nullptr, 1, &drainTask,
+                            tskNO_AFFINITY);
+}
+
+void Logger::setEnabled(bool enabled) { logEnabled = enabled; }
+
+bool Logger::isEnabled() { return logEnabled; }
+
+void Logger::log(int level, const char *format, ...) {
+    if (!logEnabled) {
+        return;
+    }
+
+    static const char levelChars[] = "-EWID";
+    char line[LOG_LINE_SIZE];
+    size_t length = snprintf(line, sizeof(line), "[%c %lu] ", levelChars[(level >= 0 && level <= LOG_LEVEL_DEBUG) ? level : 0],
+                             millis());
+
+    // 末尾の改行分を残して書式化（長すぎる行は切り詰める）
+    size_t available = sizeof(line) - length - 1;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(line + length, available, format, args);
+    va_end(args);
+    if (written < 0) {
+        return;
+    }
+    length += (size_t)written < available ? (size_t)written : available - 1;
+    line[length++] = '\n';
+
+    portENTER_CRITICAL(&logMux);
+    size_t space = (logTail + LOG_BUFFER_SIZE - logHead - 1) % LOG_BUFFER_SIZE;
+    if (space < length) {
+        droppedLines++;
+    } else {
+        for (size_t i = 0; i < length; i++) {
+            logBuffer[logHead] = line[i];
+            logHead = (logHead + 1) % LOG_BUFFER_SIZE;
+        }
+    }
+    portEXIT_CRITICAL(&logMux);
+}
+
+bool Logger::allow(LogRateLimit &limit, unsigned long intervalMs, int level) {
+    unsigned long now = millis();
+    if (limit.lastMillis != 0 && now - limit.lastMillis < intervalMs) {
+        limit.suppressed++;
+        return false;
+    }
+
+    if (limit.suppressed > 0) {
+        log(level, "(%u similar messages suppressed)", (unsigned)limit.suppressed);
+        limit.suppressed = 0;
+    }
+    limit.lastMillis = now;
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ログレベル（LOG_LEVEL未満のレベルのログはコンパイル時に除去される）
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 呼び出し箇所ごとの出力間隔の制限状態
+struct LogRateLimit {
+    unsigned long lastMillis;
+    uint32_t suppressed;
+};
+
+// リングバッファに書式化して蓄え、専用タスクからシリアルへ非同期に出力するロガー
+// 呼び出し側はシリアルの送信完了を待たない（バッファが溢れた分は破棄して件数を記録）
+class Logger {
+public:
+    static void begin(bool enabled);
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void log(int level, const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+    static bool allow(LogRateLimit& limit, unsigned long intervalMs, int level);
+};
+
+#define LOG_RATELIMITED_(level, intervalMs, ...)                                                   \
+    do {                                                                                           \
+        static LogRateLimit logLimit_ = {0, 0};                                                    \
+        if (Logger::allow(logLimit_, intervalMs, level)) {                                         \
+            Logger::log(level, __VA_ARGS__);                                                       \
+        }                                                                                          \
+    } while (0)
+
+#define LOG_NOTHING_(...) do {} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) Logger::log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_E_EVERY(intervalMs, ...) LOG_RATELIMITED_(LOG_LEVEL_ERROR, intervalMs, __VA_ARGS__)
+#else
+#define LOG_E(...) LOG_NOTHING_()
+#define LOG_E_EVERY(intervalMs, ...) LOG_NOTHING_()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) Logger::log(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_W_EVERY(intervalMs, ...) LOG_RATELIMITED_(LOG_LEVEL_WARN, intervalMs, __VA_ARGS__)
+#else
+#define LOG_W(...) LOG_NOTHING_()
+#define LOG_W_EVERY(intervalMs, ...) LOG_NOTHING_()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) Logger::log(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_I_EVERY(intervalMs, ...) LOG_RATELIMITED_(LOG_LEVEL_INFO, intervalMs, __VA_ARGS__)
+#else
+#define LOG_I(...) LOG_NOTHING_()
+#define LOG_I_EVERY(intervalMs, ...) LOG_NOTHING_()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) Logger::log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_D_EVERY(intervalMs, ...) LOG_RATELIMITED_(LOG_LEVEL_DEBUG, intervalMs, __VA_ARGS__)
+#else
+#define LOG_D(...) LOG_NOTHING_()
+#define LOG_D_EVERY(intervalMs, ...) LOG_NOTHING_()
+#endif
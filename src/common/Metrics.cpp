@@ -0,0 +1,135 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <stdarg.h>
+#include <stdio.h>
+
+// 項目ごとの直近の記録（リングバッファ）
+struct MetricWindow {
+    uint32_t samples[Metrics::WINDOW_SIZE];
+    uint32_t count;
+    uint32_t last;
+};
+
+static MetricWindow windows[METRIC_COUNT];
+static uint32_t counters[COUNTER_COUNT];
+static int32_t gauges[GAUGE_COUNT];
+static portMUX_TYPE metricsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const METRIC_NAMES[METRIC_COUNT] = {
+    "refresh", "query", "query_rows", "draw", "touch",
+};
+static const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "queries_total", "query_errors_total", "push_points_total",
+};
+static const char *const GAUGE_NAMES[GAUGE_COUNT] = {
+    "heap_free_bytes", "heap_min_free_bytes", "psram_free_bytes", "wifi_rssi_dbm",
+};
+
+void Metrics::record(MetricId id, uint32_t value) {
+    portENTER_CRITICAL(&metricsMux);
+    MetricWindow &window = windows[id];
+    window.samples[window.count % WINDOW_SIZE] = value;
+    window.count++;
+    window.last = value;
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+void Metrics::increment(CounterId id, uint32_t amount) {
+    portENTER_CRITICAL(&metricsMux);
+    counters[id] += amount;
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+void Metrics::setGauge(GaugeId id, int32_t value) {
+    portENTER_CRITICAL(&metricsMux);
+    gauges[id] = value;
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+MetricSummary Metrics::summarize(MetricId id) {
+    uint32_t sorted[WINDOW_SIZE];
+    MetricSummary summary;
+
+    portENTER_CRITICAL(&metricsMux);
+    const MetricWindow &window = windows[id];
+    summary.count = window.count;
+    summary.last = window.last;
+    size_t n = window.count < (uint32_t)WINDOW_SIZE ? window.count : WINDOW_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        sorted[i] = window.samples[i];
+    }
+    portEXIT_CRITICAL(&metricsMux);
+
+    if (n == 0) {
+        summary.p50 = summary.p95 = summary.max = 0;
+        return summary;
+    }
+
+    // 64件なので表示のたびに並べ替えても十分に軽い
+    std::sort(sorted, sorted + n);
+    summary.p50 = sorted[(n - 1) * 50 / 100];
+    summary.p95 = sorted[(n - 1) * 95 / 100];
+    summary.max = sorted[n - 1];
+    return summary;
+}
+
+uint32_t Metrics::getCounter(CounterId id) {
+    portENTER_CRITICAL(&metricsMux);
+    uint32_t value = counters[id];
+    portEXIT_CRITICAL(&metricsMux);
+    return value;
+}
+
+int32_t Metrics::getGauge(GaugeId id) {
+    portENTER_CRITICAL(&metricsMux);
+    int32_t value = gauges[id];
+    portEXIT_CRITICAL(&metricsMux);
+    return value;
+}
+
+const char *Metrics::getName(MetricId id) { return METRIC_NAMES[id]; }
+
+bool Metrics::isDuration(MetricId id) { return id != METRIC_QUERY_ROWS; }
+
+// 書式化してbufferの末尾に追加する（入りきらない分は切り詰める）
+static void appendf(char *buffer, size_t size, size_t &length, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void appendf(char *buffer, size_t size, size_t &length, const char *format, ...) {
+    if (length + 1 >= size) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + length, size - length, format, args);
+    va_end(args);
+    if (written > 0) {
+        length += (size_t)written < size - length ? (size_t)written : size - length - 1;
+    }
+}
+
+size_t Metrics::format(char *buffer, size_t size) {
+    size_t length = 0;
+    if (size > 0) {
+        buffer[0] = '\0';
+    }
+
+    // 時間はミリ秒で出力し、p50/p95/maxは直近WINDOW_SIZE回分
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        MetricId id = (MetricId)i;
+        MetricSummary summary = summarize(id);
+        float scale = isDuration(id) ? 0.001f : 1.0f;
+        appendf(buffer, size, length, "%s%s p50=%.1f p95=%.1f max=%.1f count=%u\n",
+                METRIC_NAMES[i], isDuration(id) ? "_ms" : "", summary.p50 * scale,
+                summary.p95 * scale, summary.max * scale, (unsigned)summary.count);
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        appendf(buffer, size, length, "%s %u\n", COUNTER_NAMES[i],
+                (unsigned)getCounter((CounterId)i));
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        appendf(buffer, size, length, "%s %ld\n", GAUGE_NAMES[i], (long)getGauge((GaugeId)i));
+    }
+    appendf(buffer, size, length, "uptime_ms %lu\n", millis());
+    return length;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+// 計測項目（時間はすべてマイクロ秒で記録する）
+enum MetricId {
+    METRIC_REFRESH = 0,  // 1回の更新（クエリとキャッシュへの反映）
+    METRIC_QUERY,        // クエリの送信から受信完了まで
+    METRIC_QUERY_ROWS,   // 1回のクエリで解析した行数
+    METRIC_DRAW,         // GraphRenderer::draw()
+    METRIC_TOUCH,        // タッチの判定から再描画まで
+    METRIC_COUNT
+};
+
+// 累計回数
+enum CounterId {
+    COUNTER_QUERIES = 0,
+    COUNTER_QUERY_ERRORS,
+    COUNTER_PUSH_POINTS,
+    COUNTER_COUNT
+};
+
+// 現在値（loop()から定期的に更新する）
+enum GaugeId {
+    GAUGE_HEAP_FREE = 0,
+    GAUGE_HEAP_MIN_FREE,
+    GAUGE_PSRAM_FREE,
+    GAUGE_WIFI_RSSI,
+    GAUGE_COUNT
+};
+
+struct MetricSummary {
+    uint32_t count;  // 起動からの記録回数
+    uint32_t last;
+    uint32_t p50;    // 直近WINDOW_SIZE回の分位点と最大
+    uint32_t p95;
+    uint32_t max;
+};
+
+// 計測値を項目ごとに直近WINDOW_SIZE回分だけ固定長の領域に保持する
+// 複数のタスク/コアから記録され、集計は表示時にのみ行う
+class Metrics {
+public:
+    static const int WINDOW_SIZE = 64;
+
+    static void record(MetricId id, uint32_t value);
+    static void increment(CounterId id, uint32_t amount = 1);
+    static void setGauge(GaugeId id, int32_t value);
+
+    static MetricSummary summarize(MetricId id);
+    static uint32_t getCounter(CounterId id);
+    static int32_t getGauge(GaugeId id);
+    static const char* getName(MetricId id);
+    static bool isDuration(MetricId id);
+
+    // テキスト形式で書き出す（書き込んだ長さを返す）
+    static size_t format(char* buffer, size_t size);
+};
+
+// スコープを抜けるまでの時間を記録する
+class ScopedTimer {
+private:
+    MetricId id;
+    unsigned long startMicros;
+
+public:
+    explicit ScopedTimer(MetricId metric) : id(metric), startMicros(micros()) {}
+    ~ScopedTimer() { Metrics::record(id, micros() - startMicros); }
+};
@@ -0,0 +1,36 @@
+#include "TokenAuth.h"
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <env.h>
+
+bool TokenAuth::check(const char *value) {
+    // 「Token <トークン>」の形式のみ受け付ける（前後の空白は無視）
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    if (strncasecmp(value, "Token ", 6) != 0) {
+        return false;
+    }
+    value += 6;
+    while (*value == ' ') {
+        value++;
+    }
+    size_t length = strlen(value);
+    while (length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t')) {
+        length--;
+    }
+
+    // トークンが未設定の場合は受け付けない
+    const char *expected = INFLUXDB_TOKEN;
+    size_t expectedLength = strlen(expected);
+    if (expectedLength == 0 || length != expectedLength) {
+        return false;
+    }
+    // 一致した文字数で応答時間が変わらないよう、全体を比較する
+    uint8_t diff = 0;
+    for (size_t i = 0; i < length; i++) {
+        diff |= (uint8_t)(value[i] ^ expected[i]);
+    }
+    return diff == 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// InfluxDBと同じ「Authorization: Token <トークン>」による認証（トークンはINFLUXDB_TOKEN）
+// ラインプロトコルの受信と設定用サーバで共通に使う
+class TokenAuth {
+public:
+    // ヘッダ名より後の値を渡す（前後の空白は無視、トークンが未設定の場合は常にfalse）
+    static bool check(const char* value);
+};
@@ -0,0 +1,101 @@
+#include "Decimator.h"
+
+void Decimator::decimate(const DataPoint *points, const int16_t *xs, size_t count,
+                         int32_t gapSeconds, std::vector<ColumnSample> &columns) {
+    columns.clear();
+    if (count == 0) {
+        return;
+    }
+
+    ColumnSample column;
+    column.x = xs[0];
+    column.gapBefore = false;
+    column.first = column.last = column.minValue = column.maxValue = points[0].value;
+    column.rangeMin = points[0].min;
+    column.rangeMax = points[0].max;
+
+    for (size_t i = 1; i < count; i++) {
+        const DataPoint &point = points[i];
+        bool gap = gapSeconds > 0 && point.time - points[i - 1].time > gapSeconds;
+
+        // 列が変わったら確定して次の列を開始
+        if (xs[i] != column.x) {
+            columns.push_back(column);
+            column.x = xs[i];
+            column.gapBefore = gap;
+            column.first = column.last = column.minValue = column.maxValue = point.value;
+            column.rangeMin = point.min;
+            column.rangeMax = point.max;
+            continue;
+        }
+
+        column.last = point.value;
+        if (point.value < column.minValue)
+            column.minValue = point.value;
+        if (point.value > column.maxValue)
+            column.maxValue = point.value;
+        if (point.min < column.rangeMin)
+            column.rangeMin = point.min;
+        if (point.max > column.rangeMax)
+            column.rangeMax = point.max;
+    }
+
+    columns.push_back(column);
+}
+
+void Decimator::decimate(const SpanSample *spans, const int16_t *xs, size_t count,
+                         int32_t gapSeconds, std::vector<ColumnSample> &columns) {
+    columns.clear();
+    if (count == 0) {
+        return;
+    }
+
+    ColumnSample column;
+    column.x = xs[0];
+    column.gapBefore = gapSeconds > 0 && spans[0].maxGap > gapSeconds;
+    bool gapAfter = column.gapBefore;
+    column.first = spans[0].first;
+    column.last = spans[0].last;
+    column.minValue = spans[0].minValue;
+    column.maxValue = spans[0].maxValue;
+    column.rangeMin = spans[0].rangeMin;
+    column.rangeMax = spans[0].rangeMax;
+
+    for (size_t i = 1; i < count; i++) {
+        const SpanSample &span = spans[i];
+        // 点の間隔が不均一だと1つの区間が長い欠損をまたぐことがあるので、区間の間に加えて
+        // 区間内の最大の時刻差も判定する（欠損を含む列は前後どちらの線もつながない）
+        bool inner = gapSeconds > 0 && span.maxGap > gapSeconds;
+        bool gap = gapSeconds > 0 && span.startTime - spans[i - 1].endTime > gapSeconds;
+
+        if (xs[i] != column.x) {
+            columns.push_back(column);
+            column.x = xs[i];
+            column.gapBefore = gap || inner || gapAfter;
+            gapAfter = inner;
+            column.first = span.first;
+            column.last = span.last;
+            column.minValue = span.minValue;
+            column.maxValue = span.maxValue;
+            column.rangeMin = span.rangeMin;
+            column.rangeMax = span.rangeMax;
+            continue;
+        }
+
+        if (inner) {
+            column.gapBefore = true;
+            gapAfter = true;
+        }
+        column.last = span.last;
+        if (span.minValue < column.minValue)
+            column.minValue = span.minValue;
+        if (span.maxValue > column.maxValue)
+            column.maxValue = span.maxValue;
+        if (span.rangeMin < column.rangeMin)
+            column.rangeMin = span.rangeMin;
+        if (span.rangeMax > column.rangeMax)
+            column.rangeMax = span.rangeMax;
+    }
+
+    columns.push_back(column);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "../backend/DataPoint.h"
+
+// 1ピクセル列に集約した値（M4: 列内の最初/最小/最大/最後）
+struct ColumnSample {
+    int16_t x;
+    bool gapBefore;  // 前の列との間でデータが途切れている
+    float first;
+    float last;
+    float minValue;  // 平均値の列内最小/最大（データ線の縦方向の広がり）
+    float maxValue;
+    float rangeMin;  // 集計ウィンドウの最小/最大の列内最小/最大（背景の帯）
+    float rangeMax;
+};
+
+// 連続した点の区間をM4で集約したもの（解像度ピラミッドの1要素）
+// M4は結合的なので、区間同士をさらに集約しても元の点から集約した結果と変わらない
+struct SpanSample {
+    int32_t startTime;  // 区間の最初/最後の点の時刻
+    int32_t endTime;
+    int32_t maxGap;     // 区間内で隣り合う点の時刻差の最大（点の間隔が不均一な場合の欠損の判定用）
+    float first;
+    float last;
+    float minValue;
+    float maxValue;
+    float rangeMin;
+    float rangeMax;
+};
+
+// 描画前にデータ点をピクセル列ごとに集約する
+// 同じ列に入る点は線分として重なるだけなので、M4で集約すれば見た目を変えずに
+// 描画回数をグラフ幅程度に抑えられる
+class Decimator {
+public:
+    // points と xs（各点の画面X座標、昇順）を1回の走査で列ごとに集約する
+    // 隣接する点の時刻差が gapSeconds を超える位置は gapBefore で示す（0なら判定しない）
+    static void decimate(const DataPoint* points, const int16_t* xs, size_t count,
+                         int32_t gapSeconds, std::vector<ColumnSample>& columns);
+    // 集約済みの区間から同様に集約する（xsは各区間の開始時刻の画面X座標）
+    // 区間内に gapSeconds を超える欠損がある場合は、その列の前後で線を切る
+    static void decimate(const SpanSample* spans, const int16_t* xs, size_t count,
+                         int32_t gapSeconds, std::vector<ColumnSample>& columns);
+};
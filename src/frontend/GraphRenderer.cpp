@@ -1,8 +1,27 @@
 #include "GraphRenderer.h"
-#include "../../include/env.h"
+#include <env.h>
 #include "../../include/ConfigManager.h"
-
-GraphRenderer::GraphRenderer() : config(nullptr) {
+#include "../common/Logger.h"
+#include "../common/Metrics.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// これより前の時刻はNTP未同期とみなす（2020-01-01）
+static const time_t MIN_VALID_EPOCH = 1577836800;
+
+// ズームの範囲（最も拡大した時の集計間隔あたりのピクセル数の目安と、表示できる最長の期間）
+static const int32_t MIN_VIEW_INTERVALS = 8;
+static const int32_t MAX_VIEW_SECONDS = 365 * 24 * 3600;
+
+GraphRenderer::GraphRenderer()
+    : windowStart(0), windowEnd(0), xScaleQ16(0), aggregateSeconds(0), viewSpan(24 * 3600),
+      viewOffset(0), fetchHours(24), pinchDistance(0), config(nullptr), loading(false), dirtyFlags(DIRTY_CHROME), dirtyTimeButtons(0),
+      dirtyScaleButtons(0), latestValue(0), hasLatestValue(false), monthlyUsage(0),
+      hasMonthlyUsage(false), plotCanvas(&M5.Display), gridLayer(&M5.Display),
+      canvasReady(false), gridLayerValid(false), metricsOverlay(false), inspectX(-1),
+      inspectDrawnX(-1), tooltipDrawnX(0), tooltipDrawnY(0), tooltip(&M5.Display) {
     // デフォルトのグラフエリアを設定（1280x720の横レイアウト想定）
     setGraphArea(100, 120, 1080, 400);
     minValue = 0;
@@ -11,16 +30,17 @@ GraphRenderer::GraphRenderer() : config(nullptr) {
     // デフォルトのスケール設定
     currentTimeRange = TIME_1D;
     currentYScale = SCALE_AUTO;
+    resetViewport();
     
-    // 時間範囲ボタンの初期化
-    int btnWidth = 70;
+    // 時間範囲ボタンの初期化（右端の読み込み中の表示と重ならない幅にする）
+    int btnWidth = 60;
     int btnHeight = 35;
     int startX = 300;
     int startY = 20;
-    int spacing = 10;
+    int spacing = 6;
     
-    const char* timeLabels[] = {"3h", "6h", "12h", "1d", "3d", "7d", "1m"};
-    for (int i = 0; i < 7; i++) {
+    const char* timeLabels[] = {"3h", "6h", "12h", "1d", "3d", "7d", "1m", "3m", "1y"};
+    for (int i = 0; i < 9; i++) {
         Button btn;
         btn.x = startX + i * (btnWidth + spacing);
         btn.y = startY;
@@ -51,6 +71,12 @@ void GraphRenderer::setConfig(ConfigManager *configManager) {
         setGraphArea(graphConfig.graphX, graphConfig.graphY, graphConfig.graphWidth,
                      graphConfig.graphHeight);
     }
+
+    // 実行中の変更にも対応するため、画面全体と集約結果を作り直す
+    inspectX = -1;
+    inspectDrawnX = -1;
+    updateMapping();
+    invalidate();
 }
 
 void GraphRenderer::setGraphArea(int x, int y, int width, int height) {
@@ -58,15 +84,186 @@ void GraphRenderer::setGraphArea(int x, int y, int width, int height) {
     graphY = y;
     graphWidth = width;
     graphHeight = height;
+
+    // 描画領域が変わったのでオフスクリーンバッファを作り直す
+    if (canvasReady) {
+        plotCanvas.deleteSprite();
+        gridLayer.deleteSprite();
+        canvasReady = false;
+    }
+    gridLayerValid = false;
+    dirtyFlags |= DIRTY_PLOT;
+}
+
+bool GraphRenderer::ensurePlotCanvas() {
+    if (canvasReady)
+        return true;
+
+    // グラフ領域（軸ラベルを含む）と同じ大きさのバッファをPSRAMに確保
+    int height = graphHeight + PLOT_MARGIN_BOTTOM + PLOT_MARGIN_TOP;
+    plotCanvas.setPsram(true);
+    plotCanvas.setColorDepth(16);
+    gridLayer.setPsram(true);
+    gridLayer.setColorDepth(16);
+    if (!plotCanvas.createSprite(DISPLAY_WIDTH, height) ||
+        !gridLayer.createSprite(DISPLAY_WIDTH, height)) {
+        LOG_W("Plot canvas allocation failed, drawing directly to the display");
+        plotCanvas.deleteSprite();
+        gridLayer.deleteSprite();
+        return false;
+    }
+
+    canvasReady = true;
+    gridLayerValid = false;
+    return true;
+}
+
+void GraphRenderer::setData(const SeriesSet &data, int intervalSeconds) {
+    // 受信済みで取得結果より新しい点は残す（InfluxDBに届いた後の取得で置き換わる）
+    SeriesSet merged = data;
+    for (size_t s = 0; s < merged.size() && s < series.size(); s++) {
+        int32_t newest = merged[s].empty() ? windowStart : merged[s].back().time;
+        for (const auto &point : series[s]) {
+            if (point.time > newest && point.time >= windowStart) {
+                merged[s].push_back(point);
+            }
+        }
+    }
+    series.swap(merged);
+    aggregateSeconds = intervalSeconds;
+
+    // 拡大/縮小のたびに全点を走査しないよう、系列ごとにピラミッドを作っておく
+    pyramids.resize(series.size());
+    for (size_t s = 0; s < series.size(); s++) {
+        pyramids[s].build(series[s]);
+    }
+    updateMapping();
+    dirtyFlags |= DIRTY_PLOT;
+}
+
+void GraphRenderer::clearData() {
+    series.clear();
+    pyramids.clear();
+    seriesColumns.clear();
+    inspectX = -1;
+    hasLatestValue = false;
+    calculateScale();
+    dirtyFlags |= DIRTY_PLOT;
+}
+
+bool GraphRenderer::appendLivePoints(const std::vector<LivePoint> &points) {
+    bool added = false;
+    for (const auto &live : points) {
+        if (live.seriesIndex < 0 || live.seriesIndex >= MAX_DATA_SOURCES) {
+            continue;
+        }
+        if (series.size() <= (size_t)live.seriesIndex) {
+            series.resize(live.seriesIndex + 1);
+        }
+
+        // 時刻順を保つため、末尾より古い点は捨てる
+        std::vector<DataPoint> &points = series[live.seriesIndex];
+        if (!points.empty() && live.point.time <= points.back().time) {
+            continue;
+        }
+        points.push_back(live.point);
+        added = true;
+    }
+
+    if (added) {
+        pyramids.resize(series.size());
+        for (size_t s = 0; s < series.size(); s++) {
+            pyramids[s].extend(series[s]);
+        }
+        updateMapping();
+        dirtyFlags |= DIRTY_PLOT;
+    }
+    return added;
+}
+
+bool GraphRenderer::getNewestPoint(size_t seriesIndex, DataPoint &point) const {
+    if (seriesIndex >= series.size() || series[seriesIndex].empty()) {
+        return false;
+    }
+    point = series[seriesIndex].back();
+    return true;
 }
 
-void GraphRenderer::setData(const std::vector<DataPoint> &data) {
-    dataPoints = data;
+void GraphRenderer::updateMapping() {
+    // 表示範囲は現在時刻からviewOffsetだけ戻った位置を終端とする長さviewSpanの区間
+    windowEnd = currentTime() - viewOffset;
+    windowStart = windowEnd - viewSpan;
+    xScaleQ16 = (int32_t)(((int64_t)graphWidth << 16) / viewSpan);
+
+    // 集計間隔のN倍を超える欠損は線をつながない
+    int gapIntervals = 3;
+    if (config) {
+        gapIntervals = config->getGraphConfig().gapIntervals;
+    }
+    int32_t gapSeconds = gapIntervals > 0 ? aggregateSeconds * gapIntervals : 0;
+
+    // 全系列を同じ時刻→X座標の対応で、系列ごとにピクセル列へ集約しておく
+    seriesColumns.resize(series.size());
+    for (size_t s = 0; s < series.size(); s++) {
+        decimateSeries(s, gapSeconds);
+    }
+
+    // 自動スケールは表示範囲の値から決めるので、範囲が変わるたびに決め直す
     calculateScale();
 }
 
+void GraphRenderer::decimateSeries(size_t index, int32_t gapSeconds) {
+    const std::vector<DataPoint> &points = series[index];
+
+    // 表示範囲内の点を二分探索で求める（時刻昇順）
+    auto first = std::lower_bound(
+        points.begin(), points.end(), windowStart,
+        [](const DataPoint &point, int32_t time) { return point.time < time; });
+    auto last = std::upper_bound(
+        first, points.end(), windowEnd,
+        [](int32_t time, const DataPoint &point) { return time < point.time; });
+    size_t offset = first - points.begin();
+    size_t count = last - first;
+
+    // 1列あたり2要素以下になる最も細かいレベルを選ぶ（範囲の点数によらず処理量はグラフ幅程度）
+    int level = 0;
+    size_t budget = (size_t)graphWidth * 2;
+    int levelCount = index < pyramids.size() ? pyramids[index].getLevelCount() : 1;
+    while (level + 1 < levelCount && (count >> level) > budget) {
+        level++;
+    }
+
+    if (level == 0) {
+        // 各点のX座標を一度だけ計算する
+        pointX.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            pointX[i] = mapTimeToX(points[offset + i].time);
+        }
+        Decimator::decimate(points.data() + offset, pointX.data(), count, gapSeconds,
+                            seriesColumns[index]);
+        return;
+    }
+
+    const std::vector<SpanSample> &spans = pyramids[index].getLevel(level);
+    auto spanFirst = std::lower_bound(
+        spans.begin(), spans.end(), windowStart,
+        [](const SpanSample &span, int32_t time) { return span.endTime < time; });
+    auto spanLast = std::upper_bound(
+        spanFirst, spans.end(), windowEnd,
+        [](int32_t time, const SpanSample &span) { return time < span.startTime; });
+    size_t spanOffset = spanFirst - spans.begin();
+    size_t spanCount = spanLast - spanFirst;
+
+    pointX.resize(spanCount);
+    for (size_t i = 0; i < spanCount; i++) {
+        pointX[i] = mapTimeToX(spans[spanOffset + i].startTime);
+    }
+    Decimator::decimate(spans.data() + spanOffset, pointX.data(), spanCount, gapSeconds,
+                        seriesColumns[index]);
+}
+
 void GraphRenderer::calculateScale() {
-    if (dataPoints.empty()) {
+    if (!hasData()) {
         minValue = 0;
         maxValue = 100;
         return;
@@ -75,12 +272,20 @@ void GraphRenderer::calculateScale() {
     minValue = 0;
 
     // Y軸スケールの設定を適用
-    if (currentYScale == SCALE_AUTO) {
+    if (currentYScale == SCALE_AUTO && config && !config->getDataSources()[0].autoScale) {
+        // 設定で範囲が固定されている場合（温度・湿度のプリセットなど）
+        minValue = config->getDataSources()[0].minRange;
+        maxValue = config->getDataSources()[0].maxRange;
+    } else if (currentYScale == SCALE_AUTO) {
         // 自動スケーリング
-        maxValue = dataPoints[0].value;
-        for (const auto &point : dataPoints) {
-            if (point.value > maxValue)
-                maxValue = point.value;
+        // ピークが切れないよう全系列の集計ウィンドウの最大値で判定する
+        // 表示範囲の列（updateMapping()でピラミッドから集約済み）を見るので、点数によらずグラフ幅程度
+        maxValue = 0;
+        for (const auto &columns : seriesColumns) {
+            for (const auto &column : columns) {
+                if (column.rangeMax > maxValue)
+                    maxValue = column.rangeMax;
+            }
         }
         maxValue = ((int)(maxValue / 500) + 1) * 500;
     } else {
@@ -96,16 +301,89 @@ int GraphRenderer::mapValueToY(float value) {
     return graphY + graphHeight - (int)(ratio * graphHeight);
 }
 
-int GraphRenderer::mapTimeToX(int index) {
-    if (dataPoints.size() <= 1)
+int GraphRenderer::mapTimeToX(int32_t time) const {
+    if (time <= windowStart)
         return graphX;
+    if (time >= windowEnd)
+        return graphX + graphWidth;
 
-    return graphX + (index * graphWidth) / (dataPoints.size() - 1);
+    return graphX + (int)(((int64_t)(time - windowStart) * xScaleQ16) >> 16);
 }
 
-void GraphRenderer::clear() { M5.Display.fillScreen(TFT_BLACK); }
+int32_t GraphRenderer::mapXToTime(int x) const {
+    return windowStart + (int32_t)((int64_t)(x - graphX) * viewSpan / graphWidth);
+}
+
+int32_t GraphRenderer::currentTime() const {
+    // NTPで同期済みなら現在時刻、未同期なら最新の点の時刻を終端とする
+    time_t now = time(nullptr);
+    if (now >= MIN_VALID_EPOCH) {
+        return (int32_t)now;
+    }
+
+    int32_t newest = 0;
+    for (const auto &points : series) {
+        if (!points.empty() && points.back().time > newest)
+            newest = points.back().time;
+    }
+    return newest;
+}
+
+bool GraphRenderer::hasData() const {
+    for (const auto &points : series) {
+        if (!points.empty())
+            return true;
+    }
+    return false;
+}
+
+uint32_t GraphRenderer::getSeriesColor(size_t index) const {
+    if (config && index < config->getDataSources().size()) {
+        return config->getDataSources()[index].color;
+    }
+    return TFT_YELLOW;
+}
+
+void GraphRenderer::clear() {
+    M5.Display.fillScreen(TFT_BLACK);
+    invalidate();
+}
+
+void GraphRenderer::invalidate() { dirtyFlags |= DIRTY_CHROME; }
 
 void GraphRenderer::draw() {
+    ScopedTimer timer(METRIC_DRAW);
+    M5.Display.startWrite();
+
+    // 固定部分は初回（またはinvalidate後）のみ描画
+    if (dirtyFlags & DIRTY_CHROME) {
+        drawChrome();
+    }
+
+    if (dirtyFlags & DIRTY_PLOT) {
+        drawPlot();
+    }
+
+    // 選択状態が変わったボタンのみ描画
+    for (size_t i = 0; i < timeButtons.size(); i++) {
+        if (dirtyTimeButtons & (1u << i)) {
+            drawButton(timeButtons[i], i == (size_t)currentTimeRange, TFT_BLUE);
+        }
+    }
+    for (size_t i = 0; i < yScaleButtons.size(); i++) {
+        if (dirtyScaleButtons & (1u << i)) {
+            drawButton(yScaleButtons[i], i == (size_t)currentYScale, TFT_GREEN);
+        }
+    }
+
+    M5.Display.endWrite();
+
+    dirtyFlags = 0;
+    dirtyTimeButtons = 0;
+    dirtyScaleButtons = 0;
+}
+
+void GraphRenderer::drawChrome() {
     // 背景をクリア
     M5.Display.fillRect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, TFT_BLACK);
 
@@ -119,45 +397,102 @@ void GraphRenderer::draw() {
     M5.Display.setFont(&fonts::lgfxJapanMinchoP_16);
     M5.Display.drawString(title, 10, 10);
 
-    drawAxes();
-    drawGrid();
-    drawLabels();
+    // 画面全体を消したので他の領域もすべて描き直す
+    dirtyFlags |= DIRTY_PLOT;
+    dirtyTimeButtons = (1u << timeButtons.size()) - 1;
+    dirtyScaleButtons = (1u << yScaleButtons.size()) - 1;
+    drawLoadingIndicator();
+    paintLatestValue();
+    paintMonthlyEnergyUsage();
+    drawMetricsOverlay();
+}
+
+void GraphRenderer::drawPlot() {
+    int originY = graphY - PLOT_MARGIN_TOP;
+
+    if (!ensurePlotCanvas()) {
+        // バッファが無い場合はグラフ領域だけを消して直接描き直す
+        M5.Display.fillRect(0, originY, DISPLAY_WIDTH,
+                            graphHeight + PLOT_MARGIN_TOP + PLOT_MARGIN_BOTTOM, TFT_BLACK);
+        drawAxes(M5.Display, 0);
+        drawGrid(M5.Display, 0);
+        drawPlotContents(M5.Display, 0);
+        inspectDrawnX = -1;
+        paintInspect();
+        return;
+    }
 
-    if (!dataPoints.empty()) {
-        drawDataLine();
+    // 軸とグリッドは背景レイヤーとして一度だけ描画しておく
+    if (!gridLayerValid) {
+        gridLayer.fillSprite(TFT_BLACK);
+        drawAxes(gridLayer, originY);
+        drawGrid(gridLayer, originY);
+        gridLayerValid = true;
     }
-    
-    // ボタンを描画
-    drawButtons();
+
+    // 背景レイヤーをコピーしてからラベルとデータ線を重ね、1回の転送でパネルへ送る
+    memcpy(plotCanvas.getBuffer(), gridLayer.getBuffer(), plotCanvas.bufferLength());
+    plotCanvas.setTextSize(M5.Display.getTextSizeX(), M5.Display.getTextSizeY());
+    drawPlotContents(plotCanvas, originY);
+    plotCanvas.pushSprite(&M5.Display, 0, originY);
+
+    // 十字線はバッファには描かず、転送後のパネルに重ねる
+    inspectDrawnX = -1;
+    paintInspect();
 }
 
-void GraphRenderer::drawAxes() {
+void GraphRenderer::drawPlotContents(LovyanGFX &gfx, int originY) {
+    drawLabels(gfx, originY);
+
+    if (hasData()) {
+        // 主系列（先頭）が最前面になるよう後ろの系列から描く
+        for (size_t i = series.size(); i > 0; i--) {
+            if (series[i - 1].size() >= 2) {
+                drawDataLine(gfx, originY, seriesColumns[i - 1], getSeriesColor(i - 1));
+            }
+        }
+        drawLegend(gfx, originY);
+    } else {
+        gfx.setTextColor(TFT_RED);
+        gfx.setFont(&fonts::lgfxJapanGothicP_24);
+        gfx.drawString("No Data Available", graphX + 20, graphY - originY + 20);
+        gfx.setTextColor(TFT_WHITE);
+        gfx.drawString("Check InfluxDB connection", graphX + 20, graphY - originY + 60);
+    }
+}
+
+void GraphRenderer::drawAxes(LovyanGFX &gfx, int originY) {
+    int top = graphY - originY;
+
     // X軸
-    M5.Display.drawLine(graphX, graphY + graphHeight, graphX + graphWidth, graphY + graphHeight,
-                        TFT_WHITE);
+    gfx.drawLine(graphX, top + graphHeight, graphX + graphWidth, top + graphHeight, TFT_WHITE);
 
     // Y軸
-    M5.Display.drawLine(graphX, graphY, graphX, graphY + graphHeight, TFT_WHITE);
+    gfx.drawLine(graphX, top, graphX, top + graphHeight, TFT_WHITE);
 }
 
-void GraphRenderer::drawGrid() {
-    M5.Display.setTextColor(TFT_DARKGREY);
+void GraphRenderer::drawGrid(LovyanGFX &gfx, int originY) {
+    int top = graphY - originY;
+
+    gfx.setTextColor(TFT_DARKGREY);
 
     // 横のグリッド線（Y軸方向）
     for (int i = 1; i < 5; i++) {
-        int y = graphY + (i * graphHeight) / 5;
-        M5.Display.drawLine(graphX, y, graphX + graphWidth, y, TFT_DARKGREY);
+        int y = top + (i * graphHeight) / 5;
+        gfx.drawLine(graphX, y, graphX + graphWidth, y, TFT_DARKGREY);
     }
 
     // 縦のグリッド線（X軸方向）
     for (int i = 1; i < 8; i++) {
         int x = graphX + (i * graphWidth) / 8;
-        M5.Display.drawLine(x, graphY, x, graphY + graphHeight, TFT_DARKGREY);
+        gfx.drawLine(x, top, x, top + graphHeight, TFT_DARKGREY);
     }
 }
 
-void GraphRenderer::drawLabels() {
-    M5.Display.setTextColor(TFT_WHITE);
+void GraphRenderer::drawLabels(LovyanGFX &gfx, int originY) {
+    int top = graphY - originY;
+
+    gfx.setTextColor(TFT_WHITE);
 
     String yLabel = Y_AXIS_LABEL;
     String xLabel = X_AXIS_LABEL;
@@ -169,64 +504,104 @@ void GraphRenderer::drawLabels() {
     }
 
     // Y軸ラベル（縦書き風に配置）
-    M5.Display.setFont(&fonts::lgfxJapanGothicP_12);
-    M5.Display.drawString(yLabel, 10, graphY + graphHeight / 2);
+    gfx.setFont(&fonts::lgfxJapanGothicP_12);
+    gfx.drawString(yLabel, 10, top + graphHeight / 2);
 
     // Y軸の値
     for (int i = 0; i <= 5; i++) {
-        int y = graphY + graphHeight - (i * graphHeight) / 5;
+        int y = top + graphHeight - (i * graphHeight) / 5;
         float value = minValue + (i * (maxValue - minValue)) / 5;
-        M5.Display.setFont(&fonts::lgfxJapanGothicP_12);
-        M5.Display.drawString(String(int(value)), graphX - 80, y - 10);
+        gfx.setFont(&fonts::lgfxJapanGothicP_12);
+        gfx.drawString(String(int(value)), graphX - 80, y - 10);
     }
 
     // X軸ラベル
-    M5.Display.drawString(xLabel, graphX + graphWidth / 2 - 30, graphY + graphHeight + 40);
+    gfx.drawString(xLabel, graphX + graphWidth / 2 - 30, top + graphHeight + 40);
 
-    // X軸の時間ラベル（-3h, -6hなどで表示）
-    if (!dataPoints.empty()) {
-        int hours = getTimeRangeHours();
+    // X軸の時間ラベル（現在時刻からの差を-3h, -2dなどで表示）
+    if (hasData()) {
+        int32_t now = currentTime();
+        bool inDays = viewSpan >= 3 * 24 * 3600;
         // 8分割でラベルを表示
         for (int i = 0; i <= 8; i++) {
             int x = graphX + (i * graphWidth) / 8;
-            int hourLabel = -hours + (hours * i) / 8;
+            int32_t offset = windowStart + (int32_t)((int64_t)viewSpan * i / 8) - now;
             String label;
-            if (i == 8) {
+            if (offset >= 0) {
                 label = "Now";
-            } else if (hours >= 24) {
-                int days = hours / 24;
-                int dayLabel = -days + (days * i) / 8;
-                label = String(dayLabel) + "d";
             } else {
-                label = String(hourLabel) + "h";
+                float value = inDays ? offset / 86400.0f : offset / 3600.0f;
+                // 整数になる場合は小数点以下を省く
+                label = value == (int)value ? String((int)value) : String(value, 1);
+                label += inDays ? "d" : "h";
             }
-            M5.Display.setFont(&fonts::lgfxJapanGothicP_12);
-            M5.Display.drawString(label, x - 15, graphY + graphHeight + 30);
+            gfx.setFont(&fonts::lgfxJapanGothicP_12);
+            gfx.drawString(label, x - 15, top + graphHeight + 30);
         }
     }
 }
 
-void GraphRenderer::drawDataLine() {
-    if (dataPoints.size() < 2)
-        return;
-
-    uint32_t lineColor = TFT_YELLOW;
-    if (config) {
-        lineColor = config->getDataSourceConfig().color;
+void GraphRenderer::drawDataLine(LovyanGFX &gfx, int originY,
+                                 const std::vector<ColumnSample> &columns, uint32_t lineColor) {
+    // 集計ウィンドウ内の最小〜最大を暗い色の縦線で描画（平均で消えるピークを残す）
+    uint32_t rangeColor = (lineColor >> 1) & 0x7BEF;
+    for (const auto &column : columns) {
+        int yMin = mapValueToY(column.rangeMin);
+        int yMax = mapValueToY(column.rangeMax);
+        if (yMin != yMax) {
+            gfx.drawFastVLine(column.x, yMax - originY, yMin - yMax + 1, rangeColor);
+        }
     }
 
-    for (size_t i = 1; i < dataPoints.size(); i++) {
-        int x1 = mapTimeToX(i - 1);
-        int y1 = mapValueToY(dataPoints[i - 1].value);
-        int x2 = mapTimeToX(i);
-        int y2 = mapValueToY(dataPoints[i].value);
+    // 列間は前の列の最後と次の列の最初を結び、列内は最小〜最大の縦線で描く
+    for (size_t i = 0; i < columns.size(); i++) {
+        const ColumnSample &column = columns[i];
+        if (i > 0 && !column.gapBefore) {
+            const ColumnSample &prev = columns[i - 1];
+            gfx.drawLine(prev.x, mapValueToY(prev.last) - originY, column.x,
+                         mapValueToY(column.first) - originY, lineColor);
+        }
 
-        M5.Display.drawLine(x1, y1, x2, y2, lineColor);
+        int yMin = mapValueToY(column.minValue);
+        int yMax = mapValueToY(column.maxValue);
+        if (yMin != yMax) {
+            gfx.drawFastVLine(column.x, yMax - originY, yMin - yMax + 1, lineColor);
+        }
+    }
+}
+
+void GraphRenderer::drawLegend(LovyanGFX &gfx, int originY) {
+    // 系列が1つの場合はタイトルで分かるので凡例は出さない
+    if (series.size() < 2 || !config || !config->getGraphConfig().showLegend)
+        return;
 
+    const auto &dataSources = config->getDataSources();
+    int x = graphX + graphWidth - 220;
+    int y = graphY - originY + 8;
+    int rowHeight = 18;
+    size_t count = std::min(series.size(), dataSources.size());
+
+    gfx.fillRect(x - 6, y - 4, 220, count * rowHeight + 6, TFT_BLACK);
+    gfx.setFont(&fonts::lgfxJapanGothicP_12);
+    gfx.setTextColor(TFT_WHITE);
+    for (size_t i = 0; i < count; i++) {
+        int rowY = y + i * rowHeight;
+        gfx.fillRect(x, rowY + 5, 20, 4, dataSources[i].color);
+        gfx.drawString(dataSources[i].displayName, x + 28, rowY);
     }
 }
 
 void GraphRenderer::drawLatestValue(float value) {
+    latestValue = value;
+    hasLatestValue = true;
+    paintLatestValue();
+}
+
+void GraphRenderer::paintLatestValue() {
+    if (!hasLatestValue)
+        return;
+
+    float value = latestValue;
     M5.Display.fillRect(100, 600, 400, 120, TFT_BLACK);
 
     M5.Display.setTextColor(TFT_WHITE);
@@ -238,6 +613,14 @@ void GraphRenderer::drawLatestValue(float value) {
 }
 
 void GraphRenderer::drawMonthlyEnergyUsage(float usage, bool hasData) {
+    monthlyUsage = usage;
+    hasMonthlyUsage = hasData;
+    paintMonthlyEnergyUsage();
+}
+
+void GraphRenderer::paintMonthlyEnergyUsage() {
+    float usage = monthlyUsage;
+    bool hasData = hasMonthlyUsage;
     M5.Display.fillRect(700, 600, 400, 120, TFT_BLACK);
 
     M5.Display.setTextColor(TFT_WHITE);
@@ -253,53 +636,254 @@ void GraphRenderer::drawMonthlyEnergyUsage(float usage, bool hasData) {
     }
 }
 
-void GraphRenderer::drawButtons() {
+void GraphRenderer::setLoading(bool isLoading) {
+    if (loading == isLoading)
+        return;
+
+    loading = isLoading;
+    drawLoadingIndicator();
+}
+
+void GraphRenderer::drawLoadingIndicator() {
+    // ボタンの右側に取得中の表示を出す
+    M5.Display.fillRect(900, 20, 200, 35, TFT_BLACK);
+    if (!loading)
+        return;
+
+    M5.Display.setTextColor(TFT_CYAN);
+    M5.Display.setFont(&fonts::lgfxJapanGothicP_16);
+    M5.Display.drawString("Loading...", 910, 28);
+}
+
+void GraphRenderer::drawButton(const Button &btn, bool selected, uint32_t selectedColor) {
     M5.Display.setFont(&fonts::lgfxJapanGothicP_12);
-    
-    // 時間範囲ボタンを描画
-    for (size_t i = 0; i < timeButtons.size(); i++) {
-        const Button& btn = timeButtons[i];
-        bool isSelected = (i == (size_t)currentTimeRange);
-        
-        // ボタンの背景
-        uint32_t bgColor = isSelected ? TFT_BLUE : TFT_DARKGREY;
-        M5.Display.fillRect(btn.x, btn.y, btn.width, btn.height, bgColor);
-        M5.Display.drawRect(btn.x, btn.y, btn.width, btn.height, TFT_WHITE);
-        
-        // ボタンのラベル
-        M5.Display.setTextColor(TFT_WHITE);
-        int textX = btn.x + (btn.width - M5.Display.textWidth(btn.label)) / 2;
-        int textY = btn.y + (btn.height - M5.Display.fontHeight()) / 2;
-        M5.Display.drawString(btn.label, textX, textY);
+
+    // ボタンの背景
+    uint32_t bgColor = selected ? selectedColor : TFT_DARKGREY;
+    M5.Display.fillRect(btn.x, btn.y, btn.width, btn.height, bgColor);
+    M5.Display.drawRect(btn.x, btn.y, btn.width, btn.height, TFT_WHITE);
+
+    // ボタンのラベル
+    M5.Display.setTextColor(TFT_WHITE);
+    int textX = btn.x + (btn.width - M5.Display.textWidth(btn.label)) / 2;
+    int textY = btn.y + (btn.height - M5.Display.fontHeight()) / 2;
+    M5.Display.drawString(btn.label, textX, textY);
+}
+
+void GraphRenderer::setMetricsOverlay(bool visible) {
+    if (metricsOverlay == visible)
+        return;
+
+    metricsOverlay = visible;
+    M5.Display.fillRect(OVERLAY_X, OVERLAY_Y, OVERLAY_WIDTH, OVERLAY_HEIGHT, TFT_BLACK);
+    drawMetricsOverlay();
+}
+
+void GraphRenderer::drawMetricsOverlay() {
+    if (!metricsOverlay)
+        return;
+
+    // 右上の空き領域に、直近の計測値（p50/p95）と空きメモリなどを表示
+    char line[48];
+    int y = OVERLAY_Y;
+    M5.Display.fillRect(OVERLAY_X, OVERLAY_Y, OVERLAY_WIDTH, OVERLAY_HEIGHT, TFT_BLACK);
+    M5.Display.setFont(&fonts::lgfxJapanGothicP_12);
+    M5.Display.setTextColor(TFT_GREENYELLOW);
+
+    const MetricId durations[] = {METRIC_REFRESH, METRIC_QUERY, METRIC_DRAW, METRIC_TOUCH};
+    for (MetricId id : durations) {
+        MetricSummary summary = Metrics::summarize(id);
+        snprintf(line, sizeof(line), "%s %.0f/%.0f ms", Metrics::getName(id),
+                 summary.p50 / 1000.0f, summary.p95 / 1000.0f);
+        M5.Display.drawString(line, OVERLAY_X, y);
+        y += 15;
     }
-    
-    // Y軸スケールボタンを描画
-    for (size_t i = 0; i < yScaleButtons.size(); i++) {
-        const Button& btn = yScaleButtons[i];
-        bool isSelected = (i == (size_t)currentYScale);
-        
-        // ボタンの背景
-        uint32_t bgColor = isSelected ? TFT_GREEN : TFT_DARKGREY;
-        M5.Display.fillRect(btn.x, btn.y, btn.width, btn.height, bgColor);
-        M5.Display.drawRect(btn.x, btn.y, btn.width, btn.height, TFT_WHITE);
-        
-        // ボタンのラベル
-        M5.Display.setTextColor(TFT_WHITE);
-        int textX = btn.x + (btn.width - M5.Display.textWidth(btn.label)) / 2;
-        int textY = btn.y + (btn.height - M5.Display.fontHeight()) / 2;
-        M5.Display.drawString(btn.label, textX, textY);
-    }
-}
-
-bool GraphRenderer::handleTouch(int x, int y) {
+
+    snprintf(line, sizeof(line), "rows %u", (unsigned)Metrics::summarize(METRIC_QUERY_ROWS).last);
+    M5.Display.drawString(line, OVERLAY_X, y);
+    y += 15;
+    snprintf(line, sizeof(line), "heap %ldk psram %ldk",
+             (long)Metrics::getGauge(GAUGE_HEAP_FREE) / 1024,
+             (long)Metrics::getGauge(GAUGE_PSRAM_FREE) / 1024);
+    M5.Display.drawString(line, OVERLAY_X, y);
+    y += 15;
+    snprintf(line, sizeof(line), "RSSI %ld dBm", (long)Metrics::getGauge(GAUGE_WIFI_RSSI));
+    M5.Display.drawString(line, OVERLAY_X, y);
+}
+
+bool GraphRenderer::findNearest(size_t index, int32_t time, DataPoint &point) const {
+    const std::vector<DataPoint> &points = series[index];
+    if (points.empty())
+        return false;
+
+    // 時刻の昇順に並んでいるので二分探索し、前後の点のうち近い方を選ぶ
+    auto it = std::lower_bound(
+        points.begin(), points.end(), time,
+        [](const DataPoint &p, int32_t t) { return p.time < t; });
+    if (it == points.end() || (it != points.begin() && time - (it - 1)->time < it->time - time)) {
+        --it;
+    }
+    if (it->time < windowStart || it->time > windowEnd)
+        return false;
+
+    point = *it;
+    return true;
+}
+
+bool GraphRenderer::inspectAt(int x) {
+    if (x < graphX)
+        x = graphX;
+    if (x > graphX + graphWidth)
+        x = graphX + graphWidth;
+
+    // 表示中の系列のうち、最初の系列の最も近い点に合わせる
+    DataPoint point;
+    bool found = false;
+    for (size_t i = 0; i < series.size() && !found; i++) {
+        found = findNearest(i, mapXToTime(x), point);
+    }
+    if (!found)
+        return false;
+
+    int snapped = mapTimeToX(point.time);
+    if (snapped == inspectX && inspectDrawnX == snapped)
+        return false;
+
+    inspectX = snapped;
+    M5.Display.startWrite();
+    restoreInspect();
+    paintInspect();
+    M5.Display.endWrite();
+    return true;
+}
+
+void GraphRenderer::hideInspect() {
+    if (inspectX < 0)
+        return;
+
+    inspectX = -1;
+    M5.Display.startWrite();
+    restoreInspect();
+    M5.Display.endWrite();
+}
+
+void GraphRenderer::restoreInspect() {
+    if (inspectDrawnX < 0)
+        return;
+
+    if (!canvasReady) {
+        // バッファが無い場合はグラフ全体を描き直す（十字線も描き直される）
+        drawPlot();
+        return;
+    }
+
+    // 十字線とマーカーの列、ツールチップの範囲だけをバッファから転送し直す
+    int originY = graphY - PLOT_MARGIN_TOP;
+    M5.Display.setClipRect(inspectDrawnX - MARKER_RADIUS, graphY - MARKER_RADIUS,
+                           MARKER_RADIUS * 2 + 1, graphHeight + MARKER_RADIUS * 2 + 1);
+    plotCanvas.pushSprite(&M5.Display, 0, originY);
+    M5.Display.setClipRect(tooltipDrawnX, tooltipDrawnY, tooltip.width(), tooltip.height());
+    plotCanvas.pushSprite(&M5.Display, 0, originY);
+    M5.Display.clearClipRect();
+    inspectDrawnX = -1;
+}
+
+void GraphRenderer::paintInspect() {
+    if (inspectX < 0 || !hasData())
+        return;
+
+    // 系列の数に合わせてツールチップのバッファを確保（内部RAMの小さなスプライト）
+    int rows = (int)series.size() + 1;
+    int height = rows * TOOLTIP_ROW_HEIGHT + 6;
+    if (tooltip.height() != height) {
+        tooltip.deleteSprite();
+        if (!tooltip.createSprite(TOOLTIP_WIDTH, height)) {
+            LOG_W("Failed to create tooltip sprite");
+            return;
+        }
+    }
+    tooltip.fillSprite(TFT_BLACK);
+    tooltip.drawRect(0, 0, TOOLTIP_WIDTH, height, TFT_LIGHTGREY);
+    tooltip.setFont(&fonts::lgfxJapanGothicP_12);
+
+    int32_t time = mapXToTime(inspectX);
+    M5.Display.drawFastVLine(inspectX, graphY, graphHeight, TFT_LIGHTGREY);
+
+    // 見出しは最初に見つかった点の時刻（表示は端末の時刻設定に従う）
+    bool hasTime = false;
+    int y = 4 + TOOLTIP_ROW_HEIGHT;
+    for (size_t i = 0; i < series.size(); i++) {
+        DataPoint point;
+        if (!findNearest(i, time, point))
+            continue;
+
+        if (!hasTime) {
+            time_t t = point.time;
+            struct tm tmValue;
+            localtime_r(&t, &tmValue);
+            char header[24];
+            strftime(header, sizeof(header), "%m/%d %H:%M", &tmValue);
+            tooltip.setTextColor(TFT_WHITE);
+            tooltip.drawString(header, 6, 4);
+            hasTime = true;
+        }
+
+        uint32_t color = getSeriesColor(i);
+        M5.Display.fillCircle(inspectX, mapValueToY(point.value), MARKER_RADIUS, color);
+
+        String label = String(point.value, 1);
+        if (config && i < config->getDataSources().size()) {
+            const auto &source = config->getDataSources()[i];
+            label = source.displayName + " " + label + source.unit;
+        }
+        tooltip.fillRect(6, y + 5, 10, 4, color);
+        tooltip.setTextColor(TFT_WHITE);
+        tooltip.drawString(label, 22, y);
+        y += TOOLTIP_ROW_HEIGHT;
+    }
+
+    // 十字線の右側（入りきらない場合は左側）のグラフ上端に置く
+    int tooltipX = inspectX + 12;
+    if (tooltipX + TOOLTIP_WIDTH > graphX + graphWidth) {
+        tooltipX = inspectX - 12 - TOOLTIP_WIDTH;
+    }
+    tooltipDrawnX = tooltipX;
+    tooltipDrawnY = graphY + 4;
+    tooltip.pushSprite(&M5.Display, tooltipDrawnX, tooltipDrawnY);
+    inspectDrawnX = inspectX;
+}
+
+TouchAction GraphRenderer::handleTouch(int x, int y) {
+    // タイトルのタップで計測値の表示を切り替える
+    if (x < TITLE_TOUCH_WIDTH && y < TITLE_TOUCH_HEIGHT) {
+        setMetricsOverlay(!metricsOverlay);
+        return TOUCH_OVERLAY;
+    }
+
     // 時間範囲ボタンのチェック
     for (size_t i = 0; i < timeButtons.size(); i++) {
         const Button& btn = timeButtons[i];
         if (x >= btn.x && x <= btn.x + btn.width &&
             y >= btn.y && y <= btn.y + btn.height) {
+            if (i == (size_t)currentTimeRange) {
+                // 選択中のボタンはパン/ズームを元に戻す
+                if (viewSpan == getTimeRangeHours() * 3600 && viewOffset == 0) {
+                    return TOUCH_NONE;
+                }
+                resetViewport();
+                updateMapping();
+                dirtyFlags |= DIRTY_PLOT;
+                return TOUCH_VIEWPORT;
+            }
+            // 選択が外れたボタンと新しく選択されたボタン、時間ラベルのみ再描画
+            dirtyTimeButtons |= (1u << currentTimeRange) | (1u << i);
+            dirtyFlags |= DIRTY_PLOT;
             currentTimeRange = (TimeRange)i;
-            Serial.println("Time range changed to: " + btn.label);
-            return true;
+            resetViewport();
+            // 取得が終わるまでは手元のデータを新しい表示範囲で描画しておく
+            updateMapping();
+            LOG_I("Time range changed to: %s", btn.label.c_str());
+            return TOUCH_TIME_RANGE;
         }
     }
     
@@ -308,15 +892,99 @@ bool GraphRenderer::handleTouch(int x, int y) {
         const Button& btn = yScaleButtons[i];
         if (x >= btn.x && x <= btn.x + btn.width &&
             y >= btn.y && y <= btn.y + btn.height) {
+            if (i == (size_t)currentYScale) {
+                return TOUCH_NONE;
+            }
+            dirtyScaleButtons |= (1u << currentYScale) | (1u << i);
+            dirtyFlags |= DIRTY_PLOT;
             currentYScale = (YAxisScale)i;
-            Serial.println("Y scale changed to: " + btn.label);
-            return true;
+            calculateScale();
+            LOG_I("Y scale changed to: %s", btn.label.c_str());
+            return TOUCH_Y_SCALE;
         }
     }
     
-    return false;
+    return TOUCH_NONE;
+}
+
+void GraphRenderer::resetViewport() {
+    // 十字線は描き直したグラフには重ねない
+    inspectX = -1;
+    viewSpan = getTimeRangeHours() * 3600;
+    viewOffset = 0;
+    fetchHours = getTimeRangeHours();
+    pinchDistance = 0;
+}
+
+void GraphRenderer::setViewport(int32_t span, int32_t offset) {
+    int32_t minSpan = aggregateSeconds * MIN_VIEW_INTERVALS;
+    if (minSpan < 600)
+        minSpan = 600;
+    if (span < minSpan)
+        span = minSpan;
+    if (span > MAX_VIEW_SECONDS)
+        span = MAX_VIEW_SECONDS;
+    // 未来側へは動かさない
+    if (offset < 0)
+        offset = 0;
+    if (offset > MAX_VIEW_SECONDS - span)
+        offset = MAX_VIEW_SECONDS - span;
+
+    viewSpan = span;
+    viewOffset = offset;
+    inspectX = -1;
+    updateMapping();
+    dirtyFlags |= DIRTY_PLOT;
+
+    // 保持している範囲の端に近づいたら、表示範囲1つ分だけ先まで取得する
+    int32_t heldFrom = currentTime() - fetchHours * 3600;
+    if (windowStart - viewSpan / 2 < heldFrom) {
+        int32_t needed = currentTime() - (windowStart - viewSpan);
+        fetchHours = (needed + 3599) / 3600;
+    }
+}
+
+bool GraphRenderer::isInPlotArea(int x, int y) const {
+    return x >= graphX && x <= graphX + graphWidth && y >= graphY && y <= graphY + graphHeight;
+}
+
+TouchAction GraphRenderer::handleDrag(int deltaX) {
+    if (deltaX == 0)
+        return TOUCH_NONE;
+
+    // 右へのドラッグで過去へ移動（指に合わせて表示がずれる）
+    int32_t shift = (int32_t)((int64_t)deltaX * viewSpan / graphWidth);
+    setViewport(viewSpan, viewOffset + shift);
+    return TOUCH_VIEWPORT;
 }
 
+TouchAction GraphRenderer::handlePinch(int x0, int y0, int x1, int y1) {
+    int dx = x1 - x0;
+    int dy = y1 - y0;
+    int distance = (int)sqrtf((float)(dx * dx + dy * dy));
+    if (distance < 20)
+        return TOUCH_NONE;
+
+    if (pinchDistance == 0) {
+        pinchDistance = distance;
+        return TOUCH_NONE;
+    }
+
+    // 2点の中点の時刻を固定したまま、指の間隔の変化に合わせて拡大/縮小
+    int centerX = (x0 + x1) / 2;
+    int32_t anchor = mapXToTime(centerX);
+    int32_t span = (int32_t)((int64_t)viewSpan * pinchDistance / distance);
+    pinchDistance = distance;
+    if (span == viewSpan)
+        return TOUCH_NONE;
+
+    int32_t end = anchor + (int32_t)((int64_t)(graphX + graphWidth - centerX) * span / graphWidth);
+    setViewport(span, currentTime() - end);
+    return TOUCH_VIEWPORT;
+}
+
+int GraphRenderer::getFetchHours() const { return fetchHours; }
+
 int GraphRenderer::getTimeRangeHours() const {
     switch (currentTimeRange) {
         case TIME_3H: return 3;
@@ -326,6 +994,8 @@ int GraphRenderer::getTimeRangeHours() const {
         case TIME_3D: return 72;
         case TIME_7D: return 168;
         case TIME_1M: return 720;  // 30日
+        case TIME_3M: return 2160;  // 90日
+        case TIME_1Y: return 8760;  // 365日
         default: return 24;
     }
 }
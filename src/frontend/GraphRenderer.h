@@ -3,6 +3,8 @@
 #include <M5Unified.h>
 #include <vector>
 #include "../backend/InfluxDBManager.h"
+#include "Decimator.h"
+#include "SeriesPyramid.h"
 
 class ConfigManager; // 前方宣言
 
@@ -14,7 +16,9 @@ enum TimeRange {
     TIME_1D,
     TIME_3D,
     TIME_7D,
-    TIME_1M
+    TIME_1M,
+    TIME_3M,
+    TIME_1Y
 };
 
 // Y軸スケールの選択肢
@@ -28,16 +32,81 @@ enum YAxisScale {
     SCALE_4000
 };
 
+// タッチ操作の結果
+enum TouchAction {
+    TOUCH_NONE = 0,
+    TOUCH_TIME_RANGE,  // 時間範囲が変わった（データの再取得が必要）
+    TOUCH_Y_SCALE,     // Y軸スケールが変わった（手元のデータで再描画）
+    TOUCH_OVERLAY,     // 計測値の表示が切り替わった
+    TOUCH_VIEWPORT     // パン/ズームで表示範囲が変わった（手元のデータで再描画）
+};
+
 class GraphRenderer {
 private:
+    // 再描画が必要な領域
+    enum DirtyFlag : uint8_t {
+        DIRTY_CHROME = 0x01,  // 画面全体（タイトルなどの固定部分を含む）
+        DIRTY_PLOT = 0x02,    // グラフ領域（軸・グリッド・ラベル・データ線）
+    };
+
+    // グラフ領域の上下に含めるラベル用の余白
+    static const int PLOT_MARGIN_TOP = 10;
+    static const int PLOT_MARGIN_BOTTOM = 65;
+
+    // 計測値の表示領域（ボタンの右側）と、表示を切り替えるタイトルのタップ領域
+    static const int OVERLAY_X = 1110;
+    static const int OVERLAY_Y = 5;
+    static const int OVERLAY_WIDTH = 170;
+    static const int OVERLAY_HEIGHT = 110;
+    static const int TITLE_TOUCH_WIDTH = 280;
+    static const int TITLE_TOUCH_HEIGHT = 60;
+
     int graphX, graphY, graphWidth, graphHeight;
     float minValue, maxValue;
-    std::vector<DataPoint> dataPoints;
+    // 表示範囲（エポック秒）と、時刻→X座標の固定小数点(Q16)係数
+    int32_t windowStart, windowEnd;
+    int32_t xScaleQ16;
+    int aggregateSeconds;
+    // パン/ズームの状態: 表示する長さと、現在時刻から表示範囲の終端までの戻り量（秒）
+    int32_t viewSpan;
+    int32_t viewOffset;
+    int fetchHours;     // 保持しているデータの範囲（現在時刻からさかのぼる時間）
+    int pinchDistance;  // ピンチ中の2点間の距離（0はピンチしていない）
+    SeriesSet series;                     // 設定のデータソース順の系列（時刻軸は共通）
+    std::vector<SeriesPyramid> pyramids;  // 系列ごとの解像度ピラミッド
+    std::vector<int16_t> pointX;          // 各点の画面X座標（集約時の作業領域）
+    std::vector<std::vector<ColumnSample>> seriesColumns;  // 系列ごと・ピクセル列ごとの描画用データ
     ConfigManager* config;
     
     // スケール設定
     TimeRange currentTimeRange;
     YAxisScale currentYScale;
+    bool loading;
+
+    // 描画状態
+    uint8_t dirtyFlags;
+    uint32_t dirtyTimeButtons;   // 再描画するボタンのビットマスク
+    uint32_t dirtyScaleButtons;
+    float latestValue;
+    bool hasLatestValue;
+    float monthlyUsage;
+    bool hasMonthlyUsage;
+
+    // グラフ領域のオフスクリーンバッファ（PSRAM）と、軸・グリッドを描いた背景レイヤー
+    LGFX_Sprite plotCanvas;
+    LGFX_Sprite gridLayer;
+    bool canvasReady;
+    bool gridLayerValid;
+    bool metricsOverlay;
+
+    // タップ/長押しで表示する十字線と値のツールチップ（グラフは描き直さず上に重ねる）
+    static const int TOOLTIP_WIDTH = 200;
+    static const int TOOLTIP_ROW_HEIGHT = 18;
+    static const int MARKER_RADIUS = 4;
+    int inspectX;       // 十字線の位置（-1は非表示）
+    int inspectDrawnX;  // パネルに描いてある十字線の位置（-1は無し）
+    int tooltipDrawnX, tooltipDrawnY;
+    LGFX_Sprite tooltip;
     
     // ボタン領域
     struct Button {
@@ -47,29 +116,72 @@ private:
     std::vector<Button> timeButtons;
     std::vector<Button> yScaleButtons;
     
-    void drawAxes();
-    void drawGrid();
-    void drawLabels();
-    void drawDataLine();
+    void drawAxes(LovyanGFX& gfx, int originY);
+    void drawGrid(LovyanGFX& gfx, int originY);
+    void drawLabels(LovyanGFX& gfx, int originY);
+    void drawDataLine(LovyanGFX& gfx, int originY, const std::vector<ColumnSample>& columns,
+                      uint32_t lineColor);
+    void drawLegend(LovyanGFX& gfx, int originY);
+    void drawPlotContents(LovyanGFX& gfx, int originY);
+    bool ensurePlotCanvas();
     void calculateScale();
-    void drawButtons();
+    void drawButton(const Button& btn, bool selected, uint32_t selectedColor);
+    void drawLoadingIndicator();
+    void drawChrome();
+    void drawPlot();
+    void paintLatestValue();
+    void paintMonthlyEnergyUsage();
     int mapValueToY(float value);
-    int mapTimeToX(int index);
+    void updateMapping();
+    int mapTimeToX(int32_t time) const;
+    int32_t mapXToTime(int x) const;
+    void setViewport(int32_t span, int32_t offset);
+    void resetViewport();
+    void decimateSeries(size_t index, int32_t gapSeconds);
+    bool findNearest(size_t index, int32_t time, DataPoint& point) const;
+    void paintInspect();
+    void restoreInspect();
+    int32_t currentTime() const;
+    bool hasData() const;
+    uint32_t getSeriesColor(size_t index) const;
     
 public:
     GraphRenderer();
     void setConfig(ConfigManager* configManager);
     void setGraphArea(int x, int y, int width, int height);
-    void setData(const std::vector<DataPoint>& data);
+    void setData(const SeriesSet& data, int intervalSeconds);
+    // データソースの変更時に表示中の系列を捨てる（次の取得結果で描き直す）
+    void clearData();
+    // 受信した点を系列の末尾に追加する（追加した場合はtrue、描画はdraw()で行う）
+    bool appendLivePoints(const std::vector<LivePoint>& points);
+    bool getNewestPoint(size_t seriesIndex, DataPoint& point) const;
     void draw();
     void drawLatestValue(float value);
     void drawMonthlyEnergyUsage(float usage, bool hasData);
+    void setLoading(bool isLoading);
+    // 計測値（Metrics）の表示。表示中はdrawMetricsOverlay()で定期的に更新する
+    void setMetricsOverlay(bool visible);
+    bool isMetricsOverlayVisible() const { return metricsOverlay; }
+    void drawMetricsOverlay();
     void clear();
+    void invalidate();
     
     // タッチ操作
-    bool handleTouch(int x, int y);
+    TouchAction handleTouch(int x, int y);
     TimeRange getCurrentTimeRange() const { return currentTimeRange; }
     YAxisScale getCurrentYScale() const { return currentYScale; }
     int getTimeRangeHours() const;
+
+    // パン/ズーム（グラフ領域上のドラッグとピンチ）
+    bool isInPlotArea(int x, int y) const;
+    TouchAction handleDrag(int deltaX);
+    // 十字線をxに最も近い点へ移動して値を表示（移動した場合はtrue）
+    bool inspectAt(int x);
+    void hideInspect();
+    bool isInspecting() const { return inspectX >= 0; }
+    TouchAction handlePinch(int x0, int y0, int x1, int y1);
+    void endPinch() { pinchDistance = 0; }
+    // 表示範囲とパン方向の先読みに必要な取得範囲（時間）
+    int getFetchHours() const;
     float getYScaleMax() const;
 };
\ No newline at end of file
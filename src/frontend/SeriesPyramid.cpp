@@ -0,0 +1,95 @@
+#include "SeriesPyramid.h"
+
+// 2つの区間を1つに集約する
+static SpanSample mergeSpans(const SpanSample &a, const SpanSample &b) {
+    SpanSample merged;
+    merged.startTime = a.startTime;
+    merged.endTime = b.endTime;
+    int32_t between = b.startTime - a.endTime;
+    merged.maxGap = a.maxGap > b.maxGap ? a.maxGap : b.maxGap;
+    if (between > merged.maxGap)
+        merged.maxGap = between;
+    merged.first = a.first;
+    merged.last = b.last;
+    merged.minValue = a.minValue < b.minValue ? a.minValue : b.minValue;
+    merged.maxValue = a.maxValue > b.maxValue ? a.maxValue : b.maxValue;
+    merged.rangeMin = a.rangeMin < b.rangeMin ? a.rangeMin : b.rangeMin;
+    merged.rangeMax = a.rangeMax > b.rangeMax ? a.rangeMax : b.rangeMax;
+    return merged;
+}
+
+static SpanSample toSpan(const DataPoint &point) {
+    SpanSample span;
+    span.startTime = span.endTime = point.time;
+    span.maxGap = 0;
+    span.first = span.last = span.minValue = span.maxValue = point.value;
+    span.rangeMin = point.min;
+    span.rangeMax = point.max;
+    return span;
+}
+
+SeriesPyramid::SeriesPyramid() : sourceCount(0) {}
+
+void SeriesPyramid::build(const std::vector<DataPoint> &points) {
+    levels.clear();
+    sourceCount = 0;
+    rebuildFrom(points, 0);
+}
+
+void SeriesPyramid::extend(const std::vector<DataPoint> &points) {
+    if (points.size() < sourceCount) {
+        build(points);
+        return;
+    }
+    // 直前の末尾の要素は端数を含んでいた可能性があるので、その要素から作り直す
+    rebuildFrom(points, sourceCount);
+}
+
+void SeriesPyramid::rebuildFrom(const std::vector<DataPoint> &points, size_t start) {
+    sourceCount = points.size();
+
+    // レベル1: 元の点を2つずつ集約（startを含む要素から）
+    size_t first = start / 2;
+    size_t size = (points.size() + 1) / 2;
+    if (size < MIN_LEVEL_SIZE) {
+        levels.clear();
+        return;
+    }
+    if (levels.empty()) {
+        // 新しく作るレベルは先頭から埋める
+        levels.resize(1);
+        first = 0;
+    }
+    std::vector<SpanSample> &level1 = levels[0];
+    level1.resize(size);
+    for (size_t i = first; i < size; i++) {
+        SpanSample span = toSpan(points[i * 2]);
+        if (i * 2 + 1 < points.size()) {
+            span = mergeSpans(span, toSpan(points[i * 2 + 1]));
+        }
+        level1[i] = span;
+    }
+
+    // 上位のレベル: 下のレベルの2要素ずつを集約
+    size_t level = 1;
+    for (;;) {
+        size = (levels[level - 1].size() + 1) / 2;
+        if (size < MIN_LEVEL_SIZE) {
+            break;
+        }
+        first /= 2;
+        if (levels.size() <= level) {
+            levels.resize(level + 1);
+            first = 0;
+        }
+        std::vector<SpanSample> &current = levels[level];
+        const std::vector<SpanSample> &source = levels[level - 1];
+        current.resize(size);
+        for (size_t i = first; i < size; i++) {
+            current[i] = i * 2 + 1 < source.size() ? mergeSpans(source[i * 2], source[i * 2 + 1])
+                                                   : source[i * 2];
+        }
+        level++;
+    }
+    levels.resize(level);
+}
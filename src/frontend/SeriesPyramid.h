@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Decimator.h"
+
+// 系列の解像度ピラミッド
+// レベルk（1以上）の1要素は元の点の2^k個分をM4で集約した区間で、
+// 拡大率に応じたレベルを選べば表示範囲の点数によらずグラフ幅程度の要素数で描画できる
+class SeriesPyramid {
+private:
+    // これより要素数が少ないレベルは作らない（元の点を直接集約しても十分に軽い）
+    static const size_t MIN_LEVEL_SIZE = 64;
+
+    std::vector<std::vector<SpanSample>> levels;  // levels[0]がレベル1
+    size_t sourceCount;
+
+    void rebuildFrom(const std::vector<DataPoint>& points, size_t start);
+
+public:
+    SeriesPyramid();
+
+    // 全体を作り直す
+    void build(const std::vector<DataPoint>& points);
+    // 末尾に点が追加された後に呼ぶ（追加分を含む末尾の要素のみ作り直す）
+    void extend(const std::vector<DataPoint>& points);
+
+    // 1要素が元の点の2^level個を表すレベルの要素（level >= 1）
+    int getLevelCount() const { return (int)levels.size() + 1; }
+    const std::vector<SpanSample>& getLevel(int level) const { return levels[level - 1]; }
+};
@@ -1,63 +1,170 @@
 #include <M5Unified.h>
 #include "backend/WifiManager.h"
 #include "backend/InfluxDBManager.h"
+#include "backend/DataFetcher.h"
+#include "backend/SeriesStore.h"
+#include "backend/PushReceiver.h"
+#include "backend/MetricsServer.h"
+#include "backend/ConfigServer.h"
 #include "frontend/GraphRenderer.h"
-#include "../include/env.h"
+#include <env.h>
 #include "../include/ConfigManager.h"
+#include "common/Logger.h"
+#include "common/Metrics.h"
 
 // グローバル変数
 WifiManager wifiManager;
 InfluxDBManager influxManager;
+DataFetcher dataFetcher;
+SeriesStore seriesStore;
+PushReceiver pushReceiver;
+MetricsServer metricsServer;
+ConfigServer configServer;
 GraphRenderer graphRenderer;
 ConfigManager configManager;
 
 unsigned long lastDataUpdate = 0;
 unsigned long dataUpdateInterval;
 
-void updateData() {
-    Serial.println("Updating data from InfluxDB...");
+// 取得に失敗した場合は更新間隔を待たずにこの間隔で再試行する
+static const unsigned long FETCH_RETRY_MS = 10000;
 
-    // 現在の時間範囲を取得
-    int hours = graphRenderer.getTimeRangeHours();
-    
-    // データ取得
-    std::vector<DataPoint> data = influxManager.getData(hours);
+// 起動の各段階の時刻（起動からの経過ms）を記録する（初回描画・実データ表示までの計測用）
+bool bootWifiConnected = false;
+bool bootLiveData = false;
 
-    if (!data.empty()) {
-        // グラフ描画
-        graphRenderer.setData(data);
-        graphRenderer.draw();
+// 最後に取得を要求した時間数（パンで保持範囲を超えた時の追加取得の判定用）
+int requestedHours = 0;
+uint32_t lastRequestId = 0;
+// データソースを変更した時点の要求ID（これ以前の要求の結果は古い系列なので捨てる）
+uint32_t sourcesRequestId = 0;
+
+void markBootPhase(const char *phase) { LOG_I("Boot: %s at %lu ms", phase, millis()); }
+
+// バックグラウンドの取得タスクにデータ更新を要求
+void requestData() {
+    LOG_D("Requesting data from InfluxDB...");
+
+    // 表示中の範囲（パンした先の先読み分を含む）を取得
+    int hours = graphRenderer.getFetchHours();
+    lastRequestId = dataFetcher.request(hours);
+    requestedHours = hours;
+    graphRenderer.setLoading(true);
+
+    lastDataUpdate = millis();
+}
+
+// 取得タスクから受け取った結果を描画
+void applyFetchResult(FetchResult &result) {
+    // 取得中に時間範囲やデータソースが切り替わった場合は次の結果を待つ
+    if (result.hours != graphRenderer.getFetchHours() || result.requestId < sourcesRequestId) {
+        return;
+    }
 
-        // 最新値表示
-        float latestValue = data.back().value;
+    // 失敗した場合は手元のデータを表示したまま、早めに取得し直す
+    if (!result.ok && dataUpdateInterval > FETCH_RETRY_MS) {
+        LOG_W("Fetch failed, retrying in %lu ms", FETCH_RETRY_MS);
+        lastDataUpdate = millis() - dataUpdateInterval + FETCH_RETRY_MS;
+    }
+    if (result.ok && !bootLiveData) {
+        bootLiveData = true;
+        markBootPhase("live data");
+    }
+
+    // グラフ描画（データが無い場合はグラフ領域にメッセージを表示）
+    graphRenderer.setData(result.series, result.aggregateSeconds);
+    graphRenderer.draw();
+
+    // 最新値などは主系列（設定の先頭のデータソース）で表示
+    if (!result.series.empty() && !result.series[0].empty()) {
+        const std::vector<DataPoint> &primary = result.series[0];
+
+        // 最新値表示（受信済みの点の方が新しい場合はそちらを表示）
+        float latestValue = primary.back().value;
+        DataPoint newest;
+        if (graphRenderer.getNewestPoint(0, newest)) {
+            latestValue = newest.value;
+        }
         graphRenderer.drawLatestValue(latestValue);
 
         // 月間使用量表示
-        float monthlyUsage = 0.0f;
-        bool hasMonthlyUsage = influxManager.getMonthlyEnergyUsage(monthlyUsage);
-        graphRenderer.drawMonthlyEnergyUsage(monthlyUsage, hasMonthlyUsage);
+        graphRenderer.drawMonthlyEnergyUsage(result.monthlyUsage, result.hasMonthlyUsage);
 
-        Serial.println("Data updated successfully. Points: " + String(data.size()));
-        Serial.println("Latest value: " + String(latestValue));
+        LOG_I("Data updated successfully. Points: %u, latest value: %.1f",
+              (unsigned)primary.size(), latestValue);
     } else {
-        Serial.println("No data received from InfluxDB");
+        LOG_W("No data received from InfluxDB");
+        graphRenderer.drawMonthlyEnergyUsage(0.0f, false);
+    }
+}
 
-        // エラーメッセージを表示
-        M5.Display.fillScreen(TFT_BLACK);
-        M5.Display.setTextColor(TFT_RED);
-        M5.Display.setTextSize(2);
-        M5.Display.drawString("No Data Available", 100, 100);
-        M5.Display.setTextColor(TFT_WHITE);
-        M5.Display.drawString("Check InfluxDB connection", 100, 130);
+// HTTPで受け取った設定を検証して反映し、NVSへ保存する（変更された範囲のみ作り直す）
+ConfigServer::ApplyResult applyConfig(const char *json, String &error) {
+    uint32_t changes = 0;
 
-        graphRenderer.drawMonthlyEnergyUsage(0.0f, false);
+    // 取得タスクが設定とキャッシュを参照しているので、書き換える間は取得を止める
+    // 取得の実行中はloop()を止めないよう待たずに戻り、設定用サーバが次のpoll()で呼び直す
+    if (!dataFetcher.tryLock()) {
+        return ConfigServer::APPLY_BUSY;
     }
+    bool updated = configManager.updateFromJson(json, changes, error);
+    if (updated && (changes & CONFIG_CHANGE_SOURCES)) {
+        influxManager.setConfig(&configManager);
+    }
+    if (updated && (changes & CONFIG_CHANGE_SERVICES)) {
+        bool storeEnabled = configManager.getSystemConfig().enableLocalStore;
+        if (storeEnabled && (seriesStore.isReady() || seriesStore.begin())) {
+            influxManager.setSeriesStore(&seriesStore);
+        } else {
+            influxManager.setSeriesStore(nullptr);
+        }
+    }
+    dataFetcher.unlock();
 
-    lastDataUpdate = millis();
+    if (!updated) {
+        return ConfigServer::APPLY_REJECTED;
+    }
+    configManager.save();
+    LOG_I("Configuration updated (changes: 0x%02x)", (unsigned)changes);
+    if (changes == 0) {
+        return ConfigServer::APPLY_OK;
+    }
+
+    if (changes & CONFIG_CHANGE_SERVICES) {
+        const SystemConfig &systemConfig = configManager.getSystemConfig();
+        Logger::setEnabled(systemConfig.enableSerial);
+        graphRenderer.setMetricsOverlay(systemConfig.showMetricsOverlay);
+        // ポートや有効/無効が変わっている場合があるので作り直す（設定用サーバは応答後に自身で行う）
+        pushReceiver.end();
+        metricsServer.end();
+        if (wifiManager.isWifiConnected()) {
+            pushReceiver.begin();
+            metricsServer.begin();
+        }
+    }
+    if (changes & CONFIG_CHANGE_INTERVAL) {
+        dataUpdateInterval = 60UL * 1000UL * configManager.getSystemConfig().updateIntervalMinutes;
+    }
+
+    if (changes & CONFIG_CHANGE_SOURCES) {
+        graphRenderer.clearData();
+        sourcesRequestId = lastRequestId + 1;
+    }
+    if (changes & (CONFIG_CHANGE_SOURCES | CONFIG_CHANGE_APPEARANCE | CONFIG_CHANGE_LAYOUT)) {
+        graphRenderer.setConfig(&configManager);
+        graphRenderer.draw();
+    }
+
+    // 系列や集計間隔（点の密度）が変わった場合は取得し直す
+    if ((changes & (CONFIG_CHANGE_SOURCES | CONFIG_CHANGE_LAYOUT)) && wifiManager.isWifiConnected()) {
+        requestData();
+    }
+    return ConfigServer::APPLY_OK;
 }
 
 void setup() {
     Serial.begin(115200);
+    Logger::begin(configManager.getSystemConfig().enableSerial);
 
     // M5Stackの初期化
     auto cfg = M5.config();
@@ -66,47 +173,80 @@ void setup() {
     // 横レイアウトに設定
     M5.Display.setRotation(1);
 
-    Serial.println("M5Stack Tab5 HEMS Monitor Starting...");
+    LOG_I("M5Stack Tab5 HEMS Monitor Starting...");
+    markBootPhase("display ready");
 
     // 設定の初期化とプリセット読み込み
     // 必要に応じて以下のプリセットを選択してください：
+    // 重ねて表示する系列は1回のクエリでまとめて取得される（最大MAX_DATA_SOURCES系列）
+    // configManager.addDataSource(MEASUREMENT_NAME, "solar_power_w", "W", "Solar", TFT_GREEN);
+
+    // HTTPで変更して保存した設定があれば、上のプリセットより優先する
+    if (configManager.load()) {
+        Logger::setEnabled(configManager.getSystemConfig().enableSerial);
+    }
 
     // データ更新間隔を設定から取得
-    dataUpdateInterval = configManager.getSystemConfig().updateIntervalMinutes * 60 * 1000;
+    dataUpdateInterval = 60UL * 1000UL * configManager.getSystemConfig().updateIntervalMinutes;
 
     // 各コンポーネントに設定を適用
     influxManager.setConfig(&configManager);
     graphRenderer.setConfig(&configManager);
+    wifiManager.setConfig(&configManager);
+    pushReceiver.setConfig(&configManager);
+    metricsServer.setConfig(&configManager);
+    configServer.setConfig(&configManager);
+    configServer.setHandler(applyConfig);
+    graphRenderer.setMetricsOverlay(configManager.getSystemConfig().showMetricsOverlay);
+    influxManager.connect();
 
-    // Wi-Fi接続
-    if (wifiManager.connect()) {
-        Serial.println("Wi-Fi connected successfully");
-    } else {
-        Serial.println("Wi-Fi connection failed");
-        M5.Display.setTextColor(TFT_RED);
-        M5.Display.setTextSize(2);
-        M5.Display.drawString("Wi-Fi Connection Failed", 100, 100);
-        return;
+    // Wi-Fiの接続はバックグラウンドで進め、その間に保存データの読み込みと描画を行う
+    wifiManager.begin();
+
+    // microSDに保存済みのデータがあれば、ネットワークへの接続を待たずに表示する
+    bool hasStoredData = false;
+    if (configManager.getSystemConfig().enableLocalStore && seriesStore.begin()) {
+        influxManager.setSeriesStore(&seriesStore);
+
+        int hours = graphRenderer.getTimeRangeHours();
+        SeriesSet stored = influxManager.getStoredData(hours);
+        if (!stored.empty() && !stored[0].empty()) {
+            graphRenderer.setData(stored, influxManager.getAggregateSeconds(hours));
+            graphRenderer.draw();
+            graphRenderer.drawLatestValue(stored[0].back().value);
+            graphRenderer.setLoading(true);
+            hasStoredData = true;
+            markBootPhase("first pixel (stored data)");
+        }
     }
 
-    // InfluxDB接続
-    if (influxManager.connect()) {
-        Serial.println("InfluxDB connected successfully");
-    } else {
-        Serial.println("InfluxDB connection failed");
-        M5.Display.setTextColor(TFT_RED);
+    // 初期画面表示（保存データを表示中の場合はそのまま差分の取得を待つ）
+    if (!hasStoredData) {
+        M5.Display.setTextColor(TFT_WHITE);
         M5.Display.setTextSize(2);
-        M5.Display.drawString("InfluxDB Connection Failed", 100, 130);
-        return;
+        M5.Display.drawString("Loading data...", 100, 50);
+        markBootPhase("first pixel");
     }
 
-    // 初期画面表示
-    M5.Display.setTextColor(TFT_WHITE);
-    M5.Display.setTextSize(2);
-    M5.Display.drawString("Loading data...", 100, 50);
+    // 取得タスクを起動しておき、初回データはWi-Fiの接続後にloop()から要求する
+    dataFetcher.begin(&influxManager);
+    markBootPhase("setup done");
+}
 
-    // 初回データ取得
-    updateData();
+// Wi-Fiの接続（再接続）直後に呼ばれる
+void onWifiConnected() {
+    if (!bootWifiConnected) {
+        bootWifiConnected = true;
+        markBootPhase("wifi connected");
+    }
+
+    // 有効な場合は書き込みの受信を開始（最新値は受信した点で即座に更新する）
+    pushReceiver.begin();
+    metricsServer.begin();
+    configServer.begin();
+
+    // 切断中に取得できなかった分をまとめて取得（初回はInfluxDBの疎通確認を兼ねる）
+    requestData();
 }
 
 void loop() {
@@ -115,29 +255,114 @@ void loop() {
     // タッチ操作の処理
     auto touch = M5.Touch.getDetail();
     if (touch.wasPressed()) {
+        ScopedTimer timer(METRIC_TOUCH);
         int x = touch.x;
         int y = touch.y;
-        Serial.printf("Touch detected at: (%d, %d)\n", x, y);
+        LOG_D("Touch detected at: (%d, %d)", x, y);
         
-        if (graphRenderer.handleTouch(x, y)) {
-            // ボタンが押された場合、データを更新
-            Serial.println("Button pressed, updating data...");
-            updateData();
+        TouchAction action = graphRenderer.handleTouch(x, y);
+        if (action != TOUCH_NONE) {
+            // 変化したボタンとグラフ領域のみを即座に再描画
+            graphRenderer.draw();
+        }
+        if (action == TOUCH_TIME_RANGE && wifiManager.isWifiConnected()) {
+            // 時間範囲が変わった場合のみデータを取得（切断中は再接続時に取得する）
+            LOG_D("Time range changed, updating data...");
+            requestData();
+        }
+    }
+
+    // グラフ領域のタップで十字線を表示/消去し、長押しのまま指を動かすと十字線が追従する
+    // 十字線の移動はその周辺だけを描き直すので、タッチの読み取りごとに更新する
+    static bool inspecting = false;
+    if (touch.wasHold() && graphRenderer.isInPlotArea(touch.x, touch.y)) {
+        inspecting = true;
+    }
+    if (inspecting) {
+        if (touch.isPressed()) {
+            unsigned long startMicros = micros();
+            if (graphRenderer.inspectAt(touch.x)) {
+                Metrics::record(METRIC_TOUCH, micros() - startMicros);
+            }
+        } else {
+            inspecting = false;
+        }
+    } else if (touch.wasClicked() && graphRenderer.isInPlotArea(touch.x, touch.y)) {
+        if (graphRenderer.isInspecting()) {
+            graphRenderer.hideInspect();
+        } else {
+            graphRenderer.inspectAt(touch.x);
+        }
+    }
+
+    // グラフ領域のドラッグでパン、2本指でピンチズーム（手元のデータのみで再描画する）
+    TouchAction gesture = TOUCH_NONE;
+    if (M5.Touch.getCount() >= 2) {
+        auto first = M5.Touch.getDetail(0);
+        auto second = M5.Touch.getDetail(1);
+        gesture = graphRenderer.handlePinch(first.x, first.y, second.x, second.y);
+    } else {
+        graphRenderer.endPinch();
+        // 長押しせずに動かした場合（フリックからのドラッグを含む）のみパンする
+        bool moving = touch.isFlicking() || touch.isDragging();
+        if (moving && !inspecting && graphRenderer.isInPlotArea(touch.x, touch.y)) {
+            gesture = graphRenderer.handleDrag(touch.deltaX());
+        }
+    }
+    if (gesture != TOUCH_NONE) {
+        ScopedTimer timer(METRIC_TOUCH);
+        graphRenderer.draw();
+        // 保持している範囲の外まで移動した場合は、その分を追加で取得する
+        if (graphRenderer.getFetchHours() > requestedHours && wifiManager.isWifiConnected()) {
+            requestData();
         }
     }
 
-    // 設定で指定された間隔でデータを更新
-    if (millis() - lastDataUpdate >= dataUpdateInterval) {
-        updateData();
+    // 取得タスクの結果を反映
+    static FetchResult fetchResult;
+    if (dataFetcher.poll(fetchResult)) {
+        applyFetchResult(fetchResult);
     }
+    graphRenderer.setLoading(dataFetcher.isBusy());
 
-    // Wi-Fi接続状態の監視
-    if (!wifiManager.isWifiConnected()) {
-        Serial.println("Wi-Fi disconnected, attempting to reconnect...");
-        if (wifiManager.connect()) {
-            Serial.println("Wi-Fi reconnected");
+    // 受信した点をグラフに追加し、主系列の最新値を更新（InfluxDBは履歴の取得のみに使う）
+    static std::vector<LivePoint> livePoints;
+    livePoints.clear();
+    pushReceiver.poll(livePoints);
+    Metrics::increment(COUNTER_PUSH_POINTS, livePoints.size());
+    if (graphRenderer.appendLivePoints(livePoints)) {
+        graphRenderer.draw();
+        for (size_t i = livePoints.size(); i > 0; i--) {
+            if (livePoints[i - 1].seriesIndex == 0) {
+                graphRenderer.drawLatestValue(livePoints[i - 1].point.value);
+                break;
+            }
         }
     }
 
-    delay(100); // タッチ処理のため短く設定
+    // Wi-Fi接続状態の監視（切断中も画面とキャッシュ済みのグラフはそのまま操作できる）
+    wifiManager.update();
+    if (wifiManager.consumeReconnected()) {
+        onWifiConnected();
+    }
+
+    // 設定で指定された間隔でデータを更新（切断中は再接続時にまとめて取得する）
+    if (wifiManager.isWifiConnected() && millis() - lastDataUpdate >= dataUpdateInterval) {
+        requestData();
+    }
+
+    // 計測値の更新（空きメモリ等は1秒ごとに取得し、表示中なら描き直す）
+    metricsServer.poll();
+    configServer.poll();
+    static unsigned long lastMetricsMillis = 0;
+    if (millis() - lastMetricsMillis >= 1000) {
+        lastMetricsMillis = millis();
+        Metrics::setGauge(GAUGE_HEAP_FREE, ESP.getFreeHeap());
+        Metrics::setGauge(GAUGE_HEAP_MIN_FREE, ESP.getMinFreeHeap());
+        Metrics::setGauge(GAUGE_PSRAM_FREE, ESP.getFreePsram());
+        Metrics::setGauge(GAUGE_WIFI_RSSI, wifiManager.getSignalStrength());
+        graphRenderer.drawMetricsOverlay();
+    }
+
+    delay(20); // タッチ処理のため短く設定
 }
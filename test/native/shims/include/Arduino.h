@@ -0,0 +1,80 @@
+#pragma once
+
+// Arduinoコアのホスト版（env:nativeで本体のコードをビルドするための最小限の置き換え）
+// 時間は実時間に、FreeRTOSの排他とタスクは何もしない処理に置き換える
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Stream.h"
+#include "WString.h"
+
+#define ARDUINO_HOST 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// millis()/micros()を進める（更新間隔の経過などをテストで再現する）
+namespace HostClock {
+void advance(unsigned long ms);
+}
+
+// 標準出力へ書き出すSerial
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() const { return true; }
+};
+extern HostSerial Serial;
+
+// FreeRTOS（ホストは単一スレッドで動かすので排他もタスクも不要）
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+// タスクは作らない（Loggerの出力タスクなど。ログはリングバッファに溜まるだけになる）
+inline BaseType_t xTaskCreatePinnedToCore(void (*)(void*), const char*, uint32_t, void*, int,
+                                          TaskHandle_t* handle, int) {
+    if (handle) {
+        *handle = nullptr;
+    }
+    return pdFAIL;
+}
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// ConfigManager.hのピン定義で使うGPIO番号
+typedef enum {
+    GPIO_NUM_8 = 8,
+    GPIO_NUM_9 = 9,
+    GPIO_NUM_10 = 10,
+    GPIO_NUM_11 = 11,
+    GPIO_NUM_12 = 12,
+    GPIO_NUM_13 = 13,
+    GPIO_NUM_15 = 15,
+    GPIO_NUM_39 = 39,
+    GPIO_NUM_40 = 40,
+    GPIO_NUM_41 = 41,
+    GPIO_NUM_42 = 42,
+    GPIO_NUM_43 = 43,
+    GPIO_NUM_44 = 44,
+} gpio_num_t;
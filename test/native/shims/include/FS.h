@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+// ArduinoのFileのホスト版（ホストのファイルをstdioで読み書きする）
+class File {
+private:
+    std::shared_ptr<FILE> handle;
+
+public:
+    File() {}
+    explicit File(FILE* file);
+
+    operator bool() const { return (bool)handle; }
+    size_t size() const;
+    size_t position() const;
+    bool seek(uint32_t pos);
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(const uint8_t* buffer, size_t size);
+    void close() { handle.reset(); }
+};
+
+// マウント先のディレクトリを根とするファイルシステム（ESP32のVFSと同じく、パスはマウント先からの相対）
+class FS {
+protected:
+    String root;
+
+    String hostPath(const String& path) const { return root + path; }
+
+public:
+    File open(const String& path, const char* mode = FILE_READ);
+    bool exists(const String& path);
+    bool mkdir(const String& path);
+    bool remove(const String& path);
+    bool rename(const String& from, const String& to);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// InfluxDBのクエリ応答（Flux CSV）を組み立てる
+// 実機で記録した応答と同じ形式（CRLF、テーブルごとのヘッダ、空行での区切り）で、
+// 値は行番号から決まる波形にして何度作っても同じ内容になるようにする
+namespace FluxFixture {
+
+// RFC3339（UTC、小数秒なし）
+std::string formatTime(int32_t epoch);
+// row行目の値（0〜3000Wの範囲の決まった波形）
+float valueAt(size_t row);
+
+// 現在の系列クエリ（aggregateWindow + pivot）の応答の1テーブル
+// result列はyield名、fields[i]ごとに「field_mean/_min/_max」の列を持つ
+// withCountの場合はロールアップのバケット用に「field_count」（10秒ごとの点の件数）も持つ
+std::string pivotedSeries(const char* result, const std::vector<std::string>& fields,
+                          int32_t start, int intervalSeconds, size_t rows, bool withCount = false);
+// 値1点の応答（積算電力量のfirst/lastなど）
+std::string singleValue(const char* result, int32_t time, double value);
+
+// 以前のクエリ（aggregateWindowのみ、1行1点で_time/_value）の応答
+// InfluxDB-Client-for-Arduinoが要求する注釈（#datatypeなど）を含む
+std::string rawSeries(const char* field, int32_t start, int intervalSeconds, size_t rows);
+
+}  // namespace FluxFixture
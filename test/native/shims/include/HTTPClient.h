@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include "WiFi.h"
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+
+// HTTPClientのホスト版
+// POSTの本文と認証ヘッダをInfluxReplayに記録し、登録された応答を順に返す
+class HTTPClient {
+private:
+    bool active;
+    String url;
+    String authorization;
+    int status;
+    std::string body;  // 登録された応答（受け取った領域をそのまま持つ）
+
+public:
+    HTTPClient() : active(false), status(0) {}
+
+    void setReuse(bool) {}
+    bool begin(WiFiClient& client, const String& requestUrl);
+    void addHeader(const String& name, const String& value);
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+    String getString() { return String(body.c_str()); }
+    int writeToStream(Stream* stream);
+    void end();
+
+    static String errorToString(int error);
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+// ホストでのヒープ使用量の計測（operator new/deleteとheap_caps_*を数える）
+// reset()からの確保回数・確保量と、その間の使用量のピークを返す
+struct HostHeapStats {
+    size_t allocations;
+    size_t frees;
+    size_t allocatedBytes;  // 確保した量の合計（解放分を差し引かない）
+    size_t currentBytes;    // reset()以降に確保してまだ解放していない量
+    size_t peakBytes;       // reset()以降のcurrentBytesの最大
+};
+
+namespace HostHeap {
+void reset();
+HostHeapStats stats();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// InfluxDB-Client-for-Arduinoのクエリ部分のホスト版（以前のgetData()の経路の比較用）
+// ライブラリと同じく応答を1行ずつStringに読み、セルごとにFluxValueを確保して型変換する
+// 応答はInfluxReplayに登録されたものを使う
+
+class FluxDateTime {
+public:
+    struct tm value;
+    unsigned long microseconds;
+
+    String format(const String& formatString) const;
+};
+
+// セルの値（ライブラリと同じく生の文字列と変換後の値を持つ参照カウント付きのオブジェクト）
+class FluxValue {
+private:
+    struct Cell {
+        String rawValue;
+        String type;
+        double number;
+        FluxDateTime dateTime;
+    };
+    std::shared_ptr<Cell> cell;
+
+public:
+    FluxValue() {}
+    FluxValue(const String& rawValue, const String& type);
+
+    bool isNull() const { return !cell; }
+    double getDouble() const { return cell ? cell->number : 0; }
+    long getLong() const { return cell ? (long)cell->number : 0; }
+    String getString() const { return cell ? cell->rawValue : String(); }
+    String getRawValue() const { return getString(); }
+    FluxDateTime getDateTime() const { return cell ? cell->dateTime : FluxDateTime(); }
+};
+
+class FluxQueryResult {
+private:
+    std::shared_ptr<std::string> body;
+    size_t position;
+    std::vector<String> columnNames;
+    std::vector<String> columnTypes;
+    std::vector<FluxValue> values;
+    String error;
+
+    bool readLine(String& line);
+
+public:
+    FluxQueryResult() : position(0) {}
+    FluxQueryResult(std::string csv, const String& queryError);
+
+    bool next();
+    FluxValue getValueByName(const String& columnName);
+    FluxValue getValueByIndex(int index);
+    String getError() const { return error; }
+    void close() { body.reset(); }
+};
+
+class InfluxDBClient {
+public:
+    InfluxDBClient(const String&, const String&, const String&, const String&) {}
+    void setInsecure() {}
+    FluxQueryResult query(const String& fluxQuery);
+};
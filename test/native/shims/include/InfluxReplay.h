@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// InfluxDBのクエリAPIの代わりに、記録しておいたFlux CSVの応答を順に返す
+// HTTPClient（現在の経路）とInfluxDBClient（以前の経路）の両方がここから応答を受け取る
+namespace InfluxReplay {
+
+void reset();
+// 次のクエリへの応答を登録する（登録順に1つずつ使われる）
+void queueResponse(const std::string& csv, int status = 200);
+size_t pendingResponses();
+
+// 受信を1回あたりchunkSizeバイトに分けて渡す（TCPのセグメント相当）
+void setChunkSize(size_t chunkSize);
+size_t getChunkSize();
+
+// 受け付けたクエリの記録
+size_t requestCount();
+const std::string& lastRequestBody();
+const std::string& lastAuthorization();
+
+// HTTPClient/InfluxDBClientの実装から使う
+void recordRequest(const char* body, size_t size, const char* authorization);
+bool takeResponse(int& status, std::string& csv);
+
+}  // namespace InfluxReplay
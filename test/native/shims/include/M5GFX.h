@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+// M5GFX/LovyanGFXのホスト版
+// 描画はメモリ上のフレームバッファ（RGB565）に行い、呼び出しの種類ごとの回数を記録する
+
+#define TFT_BLACK 0x0000
+#define TFT_BLUE 0x001F
+#define TFT_RED 0xF800
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_YELLOW 0xFFE0
+#define TFT_ORANGE 0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_DARKGREY 0x7BEF
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_WHITE 0xFFFF
+
+namespace fonts {
+struct IFont {
+    int height;
+};
+extern const IFont lgfxJapanGothicP_12;
+extern const IFont lgfxJapanGothicP_16;
+extern const IFont lgfxJapanGothicP_24;
+extern const IFont lgfxJapanGothicP_32;
+extern const IFont lgfxJapanMinchoP_16;
+}  // namespace fonts
+
+// 描画呼び出しの回数（線・塗りつぶし・文字・転送）
+struct DrawStats {
+    uint32_t lines;      // drawLine
+    uint32_t fastLines;  // drawFastVLine/drawFastHLine
+    uint32_t rects;      // drawRect/fillRect/fillScreen
+    uint32_t circles;    // fillCircle
+    uint32_t texts;      // drawString
+    uint32_t pushes;     // スプライトの転送（転送先で数える）
+
+    uint32_t total() const { return lines + fastLines + rects + circles + texts + pushes; }
+};
+
+class LovyanGFX {
+protected:
+    int32_t canvasWidth;
+    int32_t canvasHeight;
+    uint16_t* pixels;
+    int32_t clipX, clipY, clipWidth, clipHeight;
+    const fonts::IFont* font;
+    uint32_t textColor;
+    float textSizeX, textSizeY;
+    int writeDepth;
+    DrawStats drawStats;
+    static DrawStats allStats;
+
+    void count(uint32_t DrawStats::*call);
+    void allocate(int32_t width, int32_t height);
+    void release();
+    void plot(int32_t x, int32_t y, uint16_t color);
+    void fill(int32_t x, int32_t y, int32_t width, int32_t height, uint16_t color);
+
+public:
+    LovyanGFX();
+    virtual ~LovyanGFX();
+    LovyanGFX(const LovyanGFX&) = delete;
+    LovyanGFX& operator=(const LovyanGFX&) = delete;
+
+    int32_t width() const { return canvasWidth; }
+    int32_t height() const { return canvasHeight; }
+    void startWrite() { writeDepth++; }
+    void endWrite() { writeDepth--; }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void drawFastVLine(int32_t x, int32_t y, int32_t height, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t width, uint32_t color);
+    void drawRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+    void fillRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+    void fillCircle(int32_t x, int32_t y, int32_t radius, uint32_t color);
+    void fillScreen(uint32_t color);
+    void pushImage(int32_t x, int32_t y, int32_t width, int32_t height, const uint16_t* image);
+
+    void setClipRect(int32_t x, int32_t y, int32_t width, int32_t height);
+    void clearClipRect();
+
+    // 文字はグリフを描かず、回数と大きさのみを扱う
+    void setFont(const fonts::IFont* newFont) { font = newFont; }
+    void setTextColor(uint32_t color) { textColor = color; }
+    void setTextColor(uint32_t color, uint32_t) { textColor = color; }
+    void setTextSize(float sizeX, float sizeY = 0);
+    float getTextSizeX() const { return textSizeX; }
+    float getTextSizeY() const { return textSizeY; }
+    int32_t fontHeight() const;
+    int32_t textWidth(const char* text) const;
+    int32_t textWidth(const String& text) const { return textWidth(text.c_str()); }
+    void drawString(const char* text, int32_t x, int32_t y);
+    void drawString(const String& text, int32_t x, int32_t y) { drawString(text.c_str(), x, y); }
+
+    // テスト用: フレームバッファの読み出しと描画回数
+    uint16_t readPixel(int32_t x, int32_t y) const;
+    const DrawStats& getDrawStats() const { return drawStats; }
+    void resetDrawStats() { drawStats = DrawStats(); }
+    // パネルとすべてのスプライトを合わせた回数（オフスクリーンへの描画も含む）
+    static const DrawStats& getAllDrawStats() { return allStats; }
+    static void resetAllDrawStats() { allStats = DrawStats(); }
+};
+
+class LGFX_Sprite : public LovyanGFX {
+public:
+    explicit LGFX_Sprite(LovyanGFX* parent = nullptr) { (void)parent; }
+
+    void setPsram(bool) {}
+    void setColorDepth(int) {}
+    void* createSprite(int32_t width, int32_t height);
+    void deleteSprite() { release(); }
+    void fillSprite(uint32_t color) { fillRect(0, 0, canvasWidth, canvasHeight, color); }
+    void* getBuffer() const { return pixels; }
+    size_t bufferLength() const { return (size_t)canvasWidth * canvasHeight * sizeof(uint16_t); }
+    void pushSprite(LovyanGFX* target, int32_t x, int32_t y);
+};
+
+class M5GFX : public LovyanGFX {
+public:
+    M5GFX(int32_t width, int32_t height) { allocate(width, height); }
+};
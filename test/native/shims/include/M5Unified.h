@@ -0,0 +1,14 @@
+#pragma once
+
+#include "M5GFX.h"
+
+// M5Unifiedのホスト版（1280x720のパネルを持つTab5相当）
+class M5UnifiedHost {
+public:
+    M5GFX Display;
+
+    M5UnifiedHost() : Display(1280, 720) {}
+    void update() {}
+};
+
+extern M5UnifiedHost M5;
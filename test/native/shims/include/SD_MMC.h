@@ -0,0 +1,20 @@
+#pragma once
+
+#include "FS.h"
+
+// SD_MMCのホスト版: begin()に渡したマウント先をホストのディレクトリとして使う
+class SDMMCFS : public fs::FS {
+private:
+    bool mounted;
+
+public:
+    SDMMCFS() : mounted(false) {}
+
+    bool setPins(int, int, int, int, int, int) { return true; }
+    bool begin(const char* mountpoint = "/sdcard", bool mode1bit = false,
+               bool formatOnFail = false);
+    void end() { mounted = false; }
+    uint64_t cardSize() const { return mounted ? 1024ULL * 1024 * 1024 : 0; }
+};
+
+extern SDMMCFS SD_MMC;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ArduinoのStringのホスト版（本体のコードが使う操作のみ）
+// 確保はnew[]で行うので、HostHeapの計測に含まれる
+class String {
+private:
+    char* buffer;
+    size_t capacity;
+    size_t len;
+
+    bool ensure(size_t size);
+    void assign(const char* text, size_t length);
+
+public:
+    String(const char* text = "");
+    String(const String& other);
+    String(String&& other) noexcept;
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other) noexcept;
+    String& operator=(const char* text);
+
+    bool reserve(size_t size);
+    size_t length() const { return len; }
+    bool isEmpty() const { return len == 0; }
+    const char* c_str() const { return buffer ? buffer : ""; }
+
+    bool concat(const char* text, size_t length);
+    bool concat(const char* text);
+    bool concat(const String& other) { return concat(other.c_str(), other.len); }
+    bool concat(char c) { return concat(&c, 1); }
+    String& operator+=(const String& other) { concat(other); return *this; }
+    String& operator+=(const char* text) { concat(text); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+    String& operator+=(int value) { concat(String(value)); return *this; }
+    String& operator+=(unsigned int value) { concat(String(value)); return *this; }
+    String& operator+=(long value) { concat(String(value)); return *this; }
+    String& operator+=(unsigned long value) { concat(String(value)); return *this; }
+
+    bool equals(const char* text) const;
+    bool operator==(const String& other) const { return equals(other.c_str()); }
+    bool operator==(const char* text) const { return equals(text); }
+    bool operator!=(const String& other) const { return !equals(other.c_str()); }
+    bool operator!=(const char* text) const { return !equals(text); }
+    bool operator<(const String& other) const;
+
+    char charAt(size_t index) const { return index < len ? buffer[index] : '\0'; }
+    char operator[](size_t index) const { return charAt(index); }
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& text, unsigned int from = 0) const;
+    String substring(unsigned int from) const { return substring(from, len); }
+    String substring(unsigned int from, unsigned int to) const;
+    void trim();
+    void toLowerCase();
+    long toInt() const;
+    float toFloat() const;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
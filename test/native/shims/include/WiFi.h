@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// WiFiのホスト版（接続状態のみ。通信はHTTPClientが応答を再生する）
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+class WiFiClient : public Stream {
+private:
+    bool isConnected;
+
+public:
+    WiFiClient() : isConnected(false) {}
+    virtual ~WiFiClient() {}
+
+    int connect(const char* host, uint16_t port);
+    uint8_t connected() { return isConnected; }
+    void stop() { isConnected = false; }
+
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+class WiFiClass {
+private:
+    wl_status_t currentStatus;
+
+public:
+    WiFiClass() : currentStatus(WL_CONNECTED) {}
+    wl_status_t status() const { return currentStatus; }
+    // テスト用: 切断状態を再現する
+    void setStatus(wl_status_t status) { currentStatus = status; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,26 @@
+#pragma once
+
+// env:native用の設定（実機用のinclude/env.hはリポジトリに含まれないため、テスト用の値を置く）
+// 接続先はInfluxReplayが応答を返すので、実在しない値でよい
+
+#define WIFI_SSID "host"
+#define WIFI_PASSWORD "host"
+
+#define INFLUXDB_URL "http://influxdb.test:8086"
+#define INFLUXDB_TOKEN "host-token"
+#define INFLUXDB_ORG "home"
+#define INFLUXDB_BUCKET "hems"
+
+#define MEASUREMENT_NAME "power"
+#define FIELD_NAME_INSTANT_POWER_W "instantaneous_power"
+#define FIELD_NAME_CUMULATIVE_ENERGY_KWH "cumulative_energy"
+
+#define DATA_INTERVAL_MINUTES 5
+#define DATA_HOURS 24
+
+#define GRAPH_TITLE "Power"
+#define X_AXIS_LABEL "Time"
+#define Y_AXIS_LABEL "W"
+
+#define DISPLAY_WIDTH 1280
+#define DISPLAY_HEIGHT 720
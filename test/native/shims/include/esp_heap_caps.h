@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+
+// ESP-IDFのheap_caps_*のホスト版（PSRAM/内部RAMの区別はせず、HostHeapで数える）
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+void* heap_caps_malloc(size_t size, unsigned int caps);
+void* heap_caps_realloc(void* ptr, size_t size, unsigned int caps);
+void heap_caps_free(void* ptr);
@@ -0,0 +1,47 @@
+#include "Arduino.h"
+#include <chrono>
+#include <stdarg.h>
+#include <thread>
+
+HostSerial Serial;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static unsigned long long advancedMicros = 0;
+
+unsigned long micros() {
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    return (unsigned long)(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() +
+                           advancedMicros);
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void HostClock::advance(unsigned long ms) { advancedMicros += (unsigned long long)ms * 1000; }
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) {
+        written++;
+    }
+    return written;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    return write((const uint8_t *)line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1);
+}
+
+size_t HostSerial::write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
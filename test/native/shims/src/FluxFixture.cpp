@@ -0,0 +1,85 @@
+#include "FluxFixture.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+std::string FluxFixture::formatTime(int32_t epoch) {
+    time_t t = epoch;
+    struct tm value;
+    gmtime_r(&t, &value);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &value);
+    return text;
+}
+
+float FluxFixture::valueAt(size_t row) {
+    // 1日周期の変化に短い周期のピークを重ねる
+    float base = 1200.0f + 900.0f * sinf((float)row * 0.0043f);
+    float peak = (row % 97 < 5) ? 800.0f : 0.0f;
+    return base + peak + (float)(row % 13) * 7.0f;
+}
+
+std::string FluxFixture::pivotedSeries(const char *result, const std::vector<std::string> &fields,
+                                       int32_t start, int intervalSeconds, size_t rows,
+                                       bool withCount) {
+    std::string csv = ",result,table,_time";
+    for (const auto &field : fields) {
+        csv += "," + field + "_mean," + field + "_min," + field + "_max";
+        if (withCount) {
+            csv += "," + field + "_count";
+        }
+    }
+    csv += "\r\n";
+    csv.reserve(csv.size() + rows * (36 + fields.size() * 30));
+
+    char cell[48];
+    for (size_t row = 0; row < rows; row++) {
+        csv += ",";
+        csv += result;
+        csv += ",0,";
+        csv += formatTime(start + (int32_t)(row + 1) * intervalSeconds);
+        for (size_t i = 0; i < fields.size(); i++) {
+            float value = valueAt(row + i * 1000);
+            snprintf(cell, sizeof(cell), ",%.4f,%.1f,%.1f", value, value * 0.8f, value * 1.3f);
+            csv += cell;
+            if (withCount) {
+                snprintf(cell, sizeof(cell), ",%d", intervalSeconds / 10);
+                csv += cell;
+            }
+        }
+        csv += "\r\n";
+    }
+    csv += "\r\n";
+    return csv;
+}
+
+std::string FluxFixture::singleValue(const char *result, int32_t time, double value) {
+    char row[128];
+    snprintf(row, sizeof(row), ",%s,0,%s,%.3f\r\n", result, formatTime(time).c_str(), value);
+    return std::string(",result,table,_time,_value\r\n") + row + "\r\n";
+}
+
+std::string FluxFixture::rawSeries(const char *field, int32_t start, int intervalSeconds,
+                                   size_t rows) {
+    std::string csv = "#datatype,string,long,dateTime:RFC3339,dateTime:RFC3339,dateTime:RFC3339,"
+                      "double,string,string\r\n"
+                      "#group,false,false,true,true,false,false,true,true\r\n"
+                      "#default,_result,,,,,,,\r\n"
+                      ",result,table,_start,_stop,_time,_value,_field,_measurement\r\n";
+    std::string range = formatTime(start) + "," +
+                        formatTime(start + (int32_t)rows * intervalSeconds) + ",";
+    csv.reserve(csv.size() + rows * 110);
+
+    char cell[32];
+    for (size_t row = 0; row < rows; row++) {
+        csv += ",,0,";
+        csv += range;
+        csv += formatTime(start + (int32_t)(row + 1) * intervalSeconds);
+        snprintf(cell, sizeof(cell), ",%.4f,", valueAt(row));
+        csv += cell;
+        csv += field;
+        csv += ",power\r\n";
+    }
+    csv += "\r\n";
+    return csv;
+}
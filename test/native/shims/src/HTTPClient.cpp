@@ -0,0 +1,64 @@
+#include "HTTPClient.h"
+#include "InfluxReplay.h"
+
+bool HTTPClient::begin(WiFiClient &client, const String &requestUrl) {
+    if (!client.connected()) {
+        return false;
+    }
+    active = true;
+    url = requestUrl;
+    authorization = "";
+    status = 0;
+    body.clear();
+    return true;
+}
+
+void HTTPClient::addHeader(const String &name, const String &value) {
+    if (name == "Authorization") {
+        authorization = value;
+    }
+}
+
+int HTTPClient::POST(uint8_t *payload, size_t size) {
+    if (!active) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    InfluxReplay::recordRequest((const char *)payload, size, authorization.c_str());
+
+    if (!InfluxReplay::takeResponse(status, body)) {
+        status = HTTPC_ERROR_CONNECTION_LOST;
+    }
+    return status;
+}
+
+int HTTPClient::writeToStream(Stream *stream) {
+    if (!active || status != HTTP_CODE_OK) {
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+
+    // 実機と同じく受信した単位ごとに書き出す
+    size_t chunk = InfluxReplay::getChunkSize();
+    const uint8_t *data = (const uint8_t *)body.data();
+    size_t total = body.size();
+    for (size_t offset = 0; offset < total; offset += chunk) {
+        size_t size = total - offset < chunk ? total - offset : chunk;
+        stream->write(data + offset, size);
+    }
+    return (int)total;
+}
+
+void HTTPClient::end() {
+    active = false;
+    body.clear();
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+        return String("connection refused");
+    case HTTPC_ERROR_CONNECTION_LOST:
+        return String("connection lost");
+    default:
+        return String();
+    }
+}
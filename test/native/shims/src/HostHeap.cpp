@@ -0,0 +1,88 @@
+#include "HostHeap.h"
+#include <esp_heap_caps.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// 確保した領域の先頭に大きさと確保した時点の世代を記録しておき、解放時に差し引く
+// reset()より前に確保した領域の解放は差し引かない（計測区間のピークが負にならないように）
+static const size_t HEADER_SIZE = 16;
+
+static HostHeapStats heapStats;
+static size_t currentBytes;
+static size_t generation;
+
+static void *allocate(size_t size) {
+    unsigned char *block = (unsigned char *)malloc(size + HEADER_SIZE);
+    if (!block) {
+        return nullptr;
+    }
+    memcpy(block, &size, sizeof(size));
+    memcpy(block + sizeof(size), &generation, sizeof(generation));
+    heapStats.allocations++;
+    heapStats.allocatedBytes += size;
+    currentBytes += size;
+    if (currentBytes > heapStats.peakBytes) {
+        heapStats.peakBytes = currentBytes;
+    }
+    return block + HEADER_SIZE;
+}
+
+static void release(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    unsigned char *block = (unsigned char *)ptr - HEADER_SIZE;
+    size_t size;
+    size_t allocatedIn;
+    memcpy(&size, block, sizeof(size));
+    memcpy(&allocatedIn, block + sizeof(size), sizeof(allocatedIn));
+    heapStats.frees++;
+    if (allocatedIn == generation) {
+        currentBytes -= size;
+    }
+    free(block);
+}
+
+void HostHeap::reset() {
+    heapStats = HostHeapStats();
+    currentBytes = 0;
+    generation++;
+}
+
+HostHeapStats HostHeap::stats() {
+    HostHeapStats result = heapStats;
+    result.currentBytes = currentBytes;
+    return result;
+}
+
+void *heap_caps_malloc(size_t size, unsigned int) { return allocate(size); }
+
+void *heap_caps_realloc(void *ptr, size_t size, unsigned int) {
+    void *grown = allocate(size);
+    if (grown && ptr) {
+        size_t old;
+        memcpy(&old, (unsigned char *)ptr - HEADER_SIZE, sizeof(old));
+        memcpy(grown, ptr, old < size ? old : size);
+        release(ptr);
+    }
+    return grown;
+}
+
+void heap_caps_free(void *ptr) { release(ptr); }
+
+void *operator new(size_t size) {
+    void *ptr = allocate(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void operator delete(void *ptr) noexcept { release(ptr); }
+void operator delete[](void *ptr) noexcept { release(ptr); }
+void operator delete(void *ptr, size_t) noexcept { release(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { release(ptr); }
@@ -0,0 +1,129 @@
+#include "InfluxDbClient.h"
+#include "InfluxReplay.h"
+
+String FluxDateTime::format(const String &formatString) const {
+    char text[64];
+    size_t length = strftime(text, sizeof(text), formatString.c_str(), &value);
+    return String(length > 0 ? text : "");
+}
+
+FluxValue::FluxValue(const String &rawValue, const String &type) : cell(new Cell()) {
+    cell->rawValue = rawValue;
+    cell->type = type;
+    cell->number = 0;
+    cell->dateTime = FluxDateTime();
+    if (type == "double" || type == "long" || type == "unsignedLong") {
+        cell->number = strtod(rawValue.c_str(), nullptr);
+    } else if (type.startsWith("dateTime")) {
+        // ライブラリと同じく日時を分解した値と小数秒を持つ（UTCの応答のみ扱う）
+        struct tm &value = cell->dateTime.value;
+        if (sscanf(rawValue.c_str(), "%d-%d-%dT%d:%d:%d", &value.tm_year, &value.tm_mon,
+                   &value.tm_mday, &value.tm_hour, &value.tm_min, &value.tm_sec) == 6) {
+            value.tm_year -= 1900;
+            value.tm_mon -= 1;
+        }
+        int dot = rawValue.indexOf('.');
+        cell->dateTime.microseconds = dot >= 0 ? rawValue.substring(dot + 1, dot + 7).toInt() : 0;
+    }
+}
+
+FluxQueryResult::FluxQueryResult(std::string csv, const String &queryError)
+    : body(new std::string(std::move(csv))), position(0), error(queryError) {}
+
+bool FluxQueryResult::readLine(String &line) {
+    line = "";
+    if (!body || position >= body->size()) {
+        return false;
+    }
+    // ストリームから1文字ずつ読んで連結する
+    while (position < body->size()) {
+        char c = (*body)[position++];
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r') {
+            line += c;
+        }
+    }
+    return true;
+}
+
+// 1行をセルに分割（引用符で囲まれたセルの区切りは無視する）
+static std::vector<String> splitRow(const String &line) {
+    std::vector<String> cells;
+    String cell;
+    bool quoted = false;
+    for (size_t i = 0; i < line.length(); i++) {
+        char c = line[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            cells.push_back(cell);
+            cell = "";
+        } else {
+            cell += c;
+        }
+    }
+    cells.push_back(cell);
+    return cells;
+}
+
+bool FluxQueryResult::next() {
+    String line;
+    bool expectHeader = columnNames.empty();
+    while (readLine(line)) {
+        if (line.isEmpty()) {
+            // テーブルの区切り。次の行は注釈かヘッダ
+            expectHeader = true;
+            continue;
+        }
+        std::vector<String> cells = splitRow(line);
+        if (line.startsWith("#datatype")) {
+            columnTypes = cells;
+            continue;
+        }
+        if (line.startsWith("#")) {
+            continue;
+        }
+        if (expectHeader) {
+            columnNames = cells;
+            expectHeader = false;
+            continue;
+        }
+
+        values.clear();
+        for (size_t i = 0; i < cells.size(); i++) {
+            String type = i < columnTypes.size() ? columnTypes[i] : String("string");
+            values.push_back(cells[i].isEmpty() ? FluxValue() : FluxValue(cells[i], type));
+        }
+        return true;
+    }
+    values.clear();
+    return false;
+}
+
+FluxValue FluxQueryResult::getValueByName(const String &columnName) {
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        if (columnNames[i] == columnName) {
+            return getValueByIndex((int)i);
+        }
+    }
+    return FluxValue();
+}
+
+FluxValue FluxQueryResult::getValueByIndex(int index) {
+    return index >= 0 && (size_t)index < values.size() ? values[index] : FluxValue();
+}
+
+FluxQueryResult InfluxDBClient::query(const String &fluxQuery) {
+    InfluxReplay::recordRequest(fluxQuery.c_str(), fluxQuery.length(), "");
+    int status;
+    std::string csv;
+    if (!InfluxReplay::takeResponse(status, csv)) {
+        return FluxQueryResult(std::string(), String("connection refused"));
+    }
+    if (status != 200) {
+        return FluxQueryResult(std::string(), String(csv.c_str()));
+    }
+    return FluxQueryResult(std::move(csv), String());
+}
@@ -0,0 +1,53 @@
+#include "InfluxReplay.h"
+#include <deque>
+
+struct ReplayResponse {
+    int status;
+    std::string csv;
+};
+
+static std::deque<ReplayResponse> responses;
+static size_t chunk = 1460;
+static size_t requests = 0;
+static std::string requestBody;
+static std::string requestAuthorization;
+
+void InfluxReplay::reset() {
+    responses.clear();
+    chunk = 1460;
+    requests = 0;
+    requestBody.clear();
+    requestAuthorization.clear();
+}
+
+void InfluxReplay::queueResponse(const std::string &csv, int status) {
+    responses.push_back({status, csv});
+}
+
+size_t InfluxReplay::pendingResponses() { return responses.size(); }
+
+void InfluxReplay::setChunkSize(size_t chunkSize) { chunk = chunkSize > 0 ? chunkSize : 1; }
+
+size_t InfluxReplay::getChunkSize() { return chunk; }
+
+size_t InfluxReplay::requestCount() { return requests; }
+
+const std::string &InfluxReplay::lastRequestBody() { return requestBody; }
+
+const std::string &InfluxReplay::lastAuthorization() { return requestAuthorization; }
+
+void InfluxReplay::recordRequest(const char *body, size_t size, const char *authorization) {
+    requests++;
+    requestBody.assign(body, size);
+    requestAuthorization = authorization;
+}
+
+bool InfluxReplay::takeResponse(int &status, std::string &csv) {
+    if (responses.empty()) {
+        return false;
+    }
+    status = responses.front().status;
+    csv.swap(responses.front().csv);
+    responses.pop_front();
+    return true;
+}
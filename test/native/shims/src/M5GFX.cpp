@@ -0,0 +1,186 @@
+#include "M5GFX.h"
+#include <string.h>
+#include "M5Unified.h"
+
+M5UnifiedHost M5;
+
+namespace fonts {
+const IFont lgfxJapanGothicP_12 = {12};
+const IFont lgfxJapanGothicP_16 = {16};
+const IFont lgfxJapanGothicP_24 = {24};
+const IFont lgfxJapanGothicP_32 = {32};
+const IFont lgfxJapanMinchoP_16 = {16};
+}  // namespace fonts
+
+DrawStats LovyanGFX::allStats;
+
+void LovyanGFX::count(uint32_t DrawStats::*call) {
+    drawStats.*call += 1;
+    allStats.*call += 1;
+}
+
+LovyanGFX::LovyanGFX()
+    : canvasWidth(0), canvasHeight(0), pixels(nullptr), clipX(0), clipY(0), clipWidth(0),
+      clipHeight(0), font(&fonts::lgfxJapanGothicP_12), textColor(TFT_WHITE), textSizeX(1),
+      textSizeY(1), writeDepth(0), drawStats() {}
+
+LovyanGFX::~LovyanGFX() { release(); }
+
+void LovyanGFX::allocate(int32_t width, int32_t height) {
+    release();
+    pixels = new uint16_t[(size_t)width * height]();
+    canvasWidth = width;
+    canvasHeight = height;
+    clearClipRect();
+}
+
+void LovyanGFX::release() {
+    delete[] pixels;
+    pixels = nullptr;
+    canvasWidth = 0;
+    canvasHeight = 0;
+    clearClipRect();
+}
+
+void LovyanGFX::plot(int32_t x, int32_t y, uint16_t color) {
+    if (x < clipX || y < clipY || x >= clipX + clipWidth || y >= clipY + clipHeight) {
+        return;
+    }
+    pixels[(size_t)y * canvasWidth + x] = color;
+}
+
+void LovyanGFX::fill(int32_t x, int32_t y, int32_t width, int32_t height, uint16_t color) {
+    int32_t left = x > clipX ? x : clipX;
+    int32_t top = y > clipY ? y : clipY;
+    int32_t right = x + width < clipX + clipWidth ? x + width : clipX + clipWidth;
+    int32_t bottom = y + height < clipY + clipHeight ? y + height : clipY + clipHeight;
+    for (int32_t row = top; row < bottom; row++) {
+        for (int32_t column = left; column < right; column++) {
+            pixels[(size_t)row * canvasWidth + column] = color;
+        }
+    }
+}
+
+void LovyanGFX::drawPixel(int32_t x, int32_t y, uint32_t color) { plot(x, y, (uint16_t)color); }
+
+void LovyanGFX::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+    count(&DrawStats::lines);
+
+    // Bresenham
+    int32_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int32_t dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    int32_t sx = x0 < x1 ? 1 : -1;
+    int32_t sy = y0 < y1 ? 1 : -1;
+    int32_t error = dx + dy;
+    for (;;) {
+        plot(x0, y0, (uint16_t)color);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int32_t doubled = error * 2;
+        if (doubled >= dy) {
+            error += dy;
+            x0 += sx;
+        }
+        if (doubled <= dx) {
+            error += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void LovyanGFX::drawFastVLine(int32_t x, int32_t y, int32_t height, uint32_t color) {
+    count(&DrawStats::fastLines);
+    fill(x, y, 1, height, (uint16_t)color);
+}
+
+void LovyanGFX::drawFastHLine(int32_t x, int32_t y, int32_t width, uint32_t color) {
+    count(&DrawStats::fastLines);
+    fill(x, y, width, 1, (uint16_t)color);
+}
+
+void LovyanGFX::drawRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color) {
+    count(&DrawStats::rects);
+    fill(x, y, width, 1, (uint16_t)color);
+    fill(x, y + height - 1, width, 1, (uint16_t)color);
+    fill(x, y, 1, height, (uint16_t)color);
+    fill(x + width - 1, y, 1, height, (uint16_t)color);
+}
+
+void LovyanGFX::fillRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color) {
+    count(&DrawStats::rects);
+    fill(x, y, width, height, (uint16_t)color);
+}
+
+void LovyanGFX::fillCircle(int32_t x, int32_t y, int32_t radius, uint32_t color) {
+    count(&DrawStats::circles);
+    for (int32_t dy = -radius; dy <= radius; dy++) {
+        for (int32_t dx = -radius; dx <= radius; dx++) {
+            if (dx * dx + dy * dy <= radius * radius) {
+                plot(x + dx, y + dy, (uint16_t)color);
+            }
+        }
+    }
+}
+
+void LovyanGFX::fillScreen(uint32_t color) {
+    count(&DrawStats::rects);
+    fill(0, 0, canvasWidth, canvasHeight, (uint16_t)color);
+}
+
+void LovyanGFX::pushImage(int32_t x, int32_t y, int32_t width, int32_t height,
+                          const uint16_t *image) {
+    count(&DrawStats::pushes);
+    for (int32_t row = 0; row < height; row++) {
+        for (int32_t column = 0; column < width; column++) {
+            plot(x + column, y + row, image[(size_t)row * width + column]);
+        }
+    }
+}
+
+void LovyanGFX::setClipRect(int32_t x, int32_t y, int32_t width, int32_t height) {
+    // パネルの外にはみ出す分は切り詰める
+    clipX = x > 0 ? x : 0;
+    clipY = y > 0 ? y : 0;
+    int32_t right = x + width < canvasWidth ? x + width : canvasWidth;
+    int32_t bottom = y + height < canvasHeight ? y + height : canvasHeight;
+    clipWidth = right > clipX ? right - clipX : 0;
+    clipHeight = bottom > clipY ? bottom - clipY : 0;
+}
+
+void LovyanGFX::clearClipRect() {
+    clipX = 0;
+    clipY = 0;
+    clipWidth = canvasWidth;
+    clipHeight = canvasHeight;
+}
+
+void LovyanGFX::setTextSize(float sizeX, float sizeY) {
+    textSizeX = sizeX;
+    textSizeY = sizeY > 0 ? sizeY : sizeX;
+}
+
+int32_t LovyanGFX::fontHeight() const { return (int32_t)(font->height * textSizeY); }
+
+int32_t LovyanGFX::textWidth(const char *text) const {
+    // 等幅とみなして、文字の高さの半分を1文字の幅とする
+    return (int32_t)(strlen(text) * font->height / 2 * textSizeX);
+}
+
+void LovyanGFX::drawString(const char *, int32_t, int32_t) { count(&DrawStats::texts); }
+
+uint16_t LovyanGFX::readPixel(int32_t x, int32_t y) const {
+    if (x < 0 || y < 0 || x >= canvasWidth || y >= canvasHeight) {
+        return 0;
+    }
+    return pixels[(size_t)y * canvasWidth + x];
+}
+
+void *LGFX_Sprite::createSprite(int32_t width, int32_t height) {
+    allocate(width, height);
+    return pixels;
+}
+
+void LGFX_Sprite::pushSprite(LovyanGFX *target, int32_t x, int32_t y) {
+    target->pushImage(x, y, canvasWidth, canvasHeight, pixels);
+}
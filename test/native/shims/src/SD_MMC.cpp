@@ -0,0 +1,62 @@
+#include "SD_MMC.h"
+#include <stdio.h>
+#include <sys/stat.h>
+
+SDMMCFS SD_MMC;
+
+fs::File::File(FILE *file) : handle(file, fclose) {}
+
+size_t fs::File::size() const {
+    struct stat info;
+    if (!handle || fstat(fileno(handle.get()), &info) != 0) {
+        return 0;
+    }
+    return (size_t)info.st_size;
+}
+
+size_t fs::File::position() const { return handle ? (size_t)ftell(handle.get()) : 0; }
+
+bool fs::File::seek(uint32_t pos) { return handle && fseek(handle.get(), pos, SEEK_SET) == 0; }
+
+size_t fs::File::read(uint8_t *buffer, size_t size) {
+    return handle ? fread(buffer, 1, size, handle.get()) : 0;
+}
+
+size_t fs::File::write(const uint8_t *buffer, size_t size) {
+    if (!handle) {
+        return 0;
+    }
+    size_t written = fwrite(buffer, 1, size, handle.get());
+    fflush(handle.get());
+    return written;
+}
+
+fs::File fs::FS::open(const String &path, const char *mode) {
+    // 読み出しは"rb"、書き込みはバイナリのまま開く（ESP32のVFSと同じ意味にする）
+    char hostMode[4] = {mode[0], 'b', '\0', '\0'};
+    FILE *file = fopen(hostPath(path).c_str(), hostMode);
+    return file ? File(file) : File();
+}
+
+bool fs::FS::exists(const String &path) {
+    struct stat info;
+    return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool fs::FS::mkdir(const String &path) { return ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+
+bool fs::FS::remove(const String &path) { return ::remove(hostPath(path).c_str()) == 0; }
+
+bool fs::FS::rename(const String &from, const String &to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool SDMMCFS::begin(const char *mountpoint, bool, bool) {
+    struct stat info;
+    if (stat(mountpoint, &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return false;
+    }
+    root = mountpoint;
+    mounted = true;
+    return true;
+}
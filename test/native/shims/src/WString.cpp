@@ -0,0 +1,218 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+String::String(const char *text) : buffer(nullptr), capacity(0), len(0) {
+    assign(text ? text : "", text ? strlen(text) : 0);
+}
+
+String::String(const String &other) : buffer(nullptr), capacity(0), len(0) {
+    assign(other.c_str(), other.len);
+}
+
+String::String(String &&other) noexcept
+    : buffer(other.buffer), capacity(other.capacity), len(other.len) {
+    other.buffer = nullptr;
+    other.capacity = 0;
+    other.len = 0;
+}
+
+String::String(char c) : buffer(nullptr), capacity(0), len(0) { assign(&c, 1); }
+
+static String formatInteger(unsigned long magnitude, bool negative, unsigned char base) {
+    char digits[72];
+    int n = sizeof(digits) - 1;
+    digits[n] = '\0';
+    do {
+        int digit = (int)(magnitude % base);
+        digits[--n] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        magnitude /= base;
+    } while (magnitude > 0);
+    if (negative) {
+        digits[--n] = '-';
+    }
+    return String(digits + n);
+}
+
+String::String(int value, unsigned char base) : String(long(value), base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+    bool negative = value < 0 && base == 10;
+    unsigned long magnitude = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+    *this = formatInteger(magnitude, negative, base);
+}
+
+String::String(unsigned long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+    *this = formatInteger(value, false, base);
+}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) : buffer(nullptr), capacity(0), len(0) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", (int)decimalPlaces, value);
+    assign(text, strlen(text));
+}
+
+String::~String() { delete[] buffer; }
+
+String &String::operator=(const String &other) {
+    if (this != &other) {
+        assign(other.c_str(), other.len);
+    }
+    return *this;
+}
+
+String &String::operator=(String &&other) noexcept {
+    if (this != &other) {
+        delete[] buffer;
+        buffer = other.buffer;
+        capacity = other.capacity;
+        len = other.len;
+        other.buffer = nullptr;
+        other.capacity = 0;
+        other.len = 0;
+    }
+    return *this;
+}
+
+String &String::operator=(const char *text) {
+    assign(text ? text : "", text ? strlen(text) : 0);
+    return *this;
+}
+
+bool String::ensure(size_t size) {
+    if (buffer && capacity >= size) {
+        return true;
+    }
+    // Arduino版と同じく必要な分だけ確保し直す（連結のたびに確保が起きる点も同じ）
+    char *grown = new char[size + 1];
+    if (buffer) {
+        memcpy(grown, buffer, len + 1);
+        delete[] buffer;
+    } else {
+        grown[0] = '\0';
+    }
+    buffer = grown;
+    capacity = size;
+    return true;
+}
+
+void String::assign(const char *text, size_t length) {
+    ensure(length);
+    memmove(buffer, text, length);
+    buffer[length] = '\0';
+    len = length;
+}
+
+bool String::reserve(size_t size) { return ensure(size); }
+
+bool String::concat(const char *text, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    ensure(len + length);
+    memcpy(buffer + len, text, length);
+    len += length;
+    buffer[len] = '\0';
+    return true;
+}
+
+bool String::concat(const char *text) { return text ? concat(text, strlen(text)) : false; }
+
+bool String::equals(const char *text) const { return strcmp(c_str(), text ? text : "") == 0; }
+
+bool String::operator<(const String &other) const { return strcmp(c_str(), other.c_str()) < 0; }
+
+bool String::startsWith(const String &prefix) const {
+    return prefix.len <= len && strncmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    return suffix.len <= len && strcmp(c_str() + len - suffix.len, suffix.c_str()) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    if (from >= len) {
+        return -1;
+    }
+    const char *found = strchr(c_str() + from, c);
+    return found ? (int)(found - c_str()) : -1;
+}
+
+int String::indexOf(const String &text, unsigned int from) const {
+    if (from > len) {
+        return -1;
+    }
+    const char *found = strstr(c_str() + from, text.c_str());
+    return found ? (int)(found - c_str()) : -1;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= len) {
+        return String();
+    }
+    if (to > len) {
+        to = len;
+    }
+    String result;
+    result.assign(c_str() + from, to - from);
+    return result;
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < len && isspace((unsigned char)buffer[begin])) {
+        begin++;
+    }
+    size_t end = len;
+    while (end > begin && isspace((unsigned char)buffer[end - 1])) {
+        end--;
+    }
+    if (begin > 0 || end < len) {
+        assign(c_str() + begin, end - begin);
+    }
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < len; i++) {
+        buffer[i] = (char)tolower((unsigned char)buffer[i]);
+    }
+}
+
+long String::toInt() const { return strtol(c_str(), nullptr, 10); }
+
+float String::toFloat() const { return strtof(c_str(), nullptr); }
+
+String operator+(const String &a, const String &b) {
+    String result(a);
+    result += b;
+    return result;
+}
+
+String operator+(const String &a, const char *b) {
+    String result(a);
+    result += b;
+    return result;
+}
+
+String operator+(const char *a, const String &b) {
+    String result(a);
+    result += b;
+    return result;
+}
+
+String operator+(const String &a, char b) {
+    String result(a);
+    result += b;
+    return result;
+}
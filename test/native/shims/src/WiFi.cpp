@@ -0,0 +1,8 @@
+#include "WiFi.h"
+
+WiFiClass WiFi;
+
+int WiFiClient::connect(const char *, uint16_t) {
+    isConnected = WiFi.status() == WL_CONNECTED;
+    return isConnected;
+}
@@ -0,0 +1,140 @@
+// データ線の描画: 隣接する点の組ごとにdrawLineする以前の描画と、M4で列に集約した描画の比較
+#include <unity.h>
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <env.h>
+#include <FluxFixture.h>
+#include <chrono>
+#include "../../src/frontend/GraphRenderer.h"
+
+// GraphRendererの既定のグラフ領域と同じ大きさ
+static const int GRAPH_X = 100;
+static const int GRAPH_Y = 120;
+static const int GRAPH_WIDTH = 1080;
+static const int GRAPH_HEIGHT = 400;
+static const int32_t SPAN = 7 * 24 * 3600;  // 7dの表示範囲に点を並べる
+static const int REPEAT = 20;
+
+static SeriesSet makeSeries(int32_t newest, size_t count, int interval) {
+    SeriesSet set(1);
+    set[0].reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        float value = FluxFixture::valueAt(i);
+        set[0].push_back({newest - (int32_t)(count - 1 - i) * interval, value, value - 50,
+                          value + 50});
+    }
+    return set;
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+// 以前のdrawDataLine(): 表示範囲の全点を順に線で結ぶ
+static void drawPairs(LovyanGFX& gfx, const std::vector<DataPoint>& points, int32_t windowStart,
+                      float maxValue) {
+    for (size_t i = 1; i < points.size(); i++) {
+        int x1 = GRAPH_X + (int)((int64_t)(points[i - 1].time - windowStart) * GRAPH_WIDTH / SPAN);
+        int y1 = GRAPH_Y + GRAPH_HEIGHT - (int)(points[i - 1].value / maxValue * GRAPH_HEIGHT);
+        int x2 = GRAPH_X + (int)((int64_t)(points[i].time - windowStart) * GRAPH_WIDTH / SPAN);
+        int y2 = GRAPH_Y + GRAPH_HEIGHT - (int)(points[i].value / maxValue * GRAPH_HEIGHT);
+        gfx.drawLine(x1, y1, x2, y2, TFT_YELLOW);
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void benchmark(size_t count) {
+    int interval = SPAN / (int)count;
+    int32_t now = (int32_t)time(nullptr);
+    SeriesSet set = makeSeries(now, count, interval);
+
+    // 以前: 点の組ごとに1回のdrawLine
+    LGFX_Sprite canvas(&M5.Display);
+    canvas.createSprite(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    double beforeMs = 1e9;
+    DrawStats before = {};
+    for (int i = 0; i < REPEAT; i++) {
+        canvas.resetDrawStats();
+        auto started = std::chrono::steady_clock::now();
+        drawPairs(canvas, set[0], now - SPAN, 3500);
+        double ms = elapsedMs(started);
+        before = canvas.getDrawStats();
+        if (ms < beforeMs) {
+            beforeMs = ms;
+        }
+    }
+    canvas.deleteSprite();
+
+    // 現在: ピラミッドの構築と列への集約（setData）と、グラフ領域の描画
+    GraphRenderer renderer;
+    renderer.handleTouch(640, 30);  // 7d
+    renderer.setData(set, interval);
+    renderer.draw();
+    double decimateMs = 1e9;
+    double drawMs = 1e9;
+    DrawStats after = {};
+    for (int i = 0; i < REPEAT; i++) {
+        auto started = std::chrono::steady_clock::now();
+        renderer.setData(set, interval);
+        double ms = elapsedMs(started);
+        if (ms < decimateMs) {
+            decimateMs = ms;
+        }
+
+        LovyanGFX::resetAllDrawStats();
+        started = std::chrono::steady_clock::now();
+        renderer.draw();
+        ms = elapsedMs(started);
+        after = LovyanGFX::getAllDrawStats();
+        if (ms < drawMs) {
+            drawMs = ms;
+        }
+    }
+
+    // グラフ領域の転送とラベルの分（データが無い場合の描画）を差し引く
+    double baseMs = 1e9;
+    for (int i = 0; i < REPEAT; i++) {
+        renderer.clearData();
+        auto started = std::chrono::steady_clock::now();
+        renderer.draw();
+        double ms = elapsedMs(started);
+        if (ms < baseMs) {
+            baseMs = ms;
+        }
+    }
+    double linesMs = drawMs > baseMs ? drawMs - baseMs : 0;
+
+    char line[200];
+    snprintf(line, sizeof(line), "%6u points: before %6u drawLine, %8.3f ms", (unsigned)count,
+             (unsigned)before.lines, beforeMs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line),
+             "%6u points: after  %6u drawLine + %4u drawFastVLine, %8.3f ms "
+             "(decimate %.3f ms + lines %.3f ms)",
+             (unsigned)count, (unsigned)after.lines, (unsigned)after.fastLines,
+             decimateMs + linesMs, decimateMs, linesMs);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(count - 1, before.lines);
+    // データ線は列ごとに高々1本（軸・グリッドは背景レイヤーに描いてあるので含まれない）
+    TEST_ASSERT_TRUE(after.lines <= (uint32_t)GRAPH_WIDTH + 1);
+    TEST_ASSERT_TRUE(after.fastLines <= 2 * ((uint32_t)GRAPH_WIDTH + 1));
+}
+
+void test_benchmark_100_points() { benchmark(100); }
+void test_benchmark_1k_points() { benchmark(1000); }
+void test_benchmark_10k_points() { benchmark(10000); }
+void test_benchmark_100k_points() { benchmark(100000); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_100_points);
+    RUN_TEST(test_benchmark_1k_points);
+    RUN_TEST(test_benchmark_10k_points);
+    RUN_TEST(test_benchmark_100k_points);
+    return UNITY_END();
+}
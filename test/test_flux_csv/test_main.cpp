@@ -0,0 +1,165 @@
+// Flux CSVの解析: 逐次パーサ（FluxCsvParser）と以前のStringを使う経路の比較
+#include <unity.h>
+#include <Arduino.h>
+#include <HostHeap.h>
+#include <FluxFixture.h>
+#include <InfluxDbClient.h>
+#include <InfluxReplay.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../../src/backend/DataPoint.h"
+#include "../../src/backend/FluxCsvParser.h"
+
+static const size_t ROWS = 10000;
+static const int INTERVAL = 60;
+static const int32_t START = 1767225600;  // 2026-01-01T00:00:00Z
+static const size_t CHUNK = 1460;         // TCPの1セグメント相当で分けて渡す
+static const int REPEAT = 5;
+
+// 以前のgetData()の1点（時刻は整形済みの文字列で持っていた）
+struct LegacyPoint {
+    String timestamp;
+    float value;
+};
+
+struct ParseContext {
+    int timeColumn;
+    int valueColumn;
+    std::vector<DataPoint>* points;
+};
+
+static void onRow(void* context, const FluxCsvParser& parser) {
+    ParseContext* ctx = (ParseContext*)context;
+    DataPoint point;
+    float value;
+    if (!parser.getTime(ctx->timeColumn, point.time) || !parser.getFloat(ctx->valueColumn, value)) {
+        return;
+    }
+    point.value = point.min = point.max = value;
+    ctx->points->push_back(point);
+}
+
+static void parseStreaming(const std::string& csv, std::vector<DataPoint>& points) {
+    FluxCsvParser parser;
+    ParseContext ctx;
+    ctx.timeColumn = parser.addColumn("_time");
+    ctx.valueColumn = parser.addColumn("_value");
+    ctx.points = &points;
+    parser.setRowHandler(onRow, &ctx);
+    for (size_t offset = 0; offset < csv.size(); offset += CHUNK) {
+        size_t length = csv.size() - offset < CHUNK ? csv.size() - offset : CHUNK;
+        parser.feed(csv.data() + offset, length);
+    }
+    parser.finish();
+}
+
+// 以前のgetData()の解析部分（ログ出力を除く）。応答はInfluxReplayに登録しておく
+static void parseLegacy(std::vector<LegacyPoint>& points) {
+    InfluxDBClient client("", "", "", "");
+    FluxQueryResult result = client.query("");
+    while (result.next()) {
+        LegacyPoint point;
+        FluxValue timeValue = result.getValueByName("_time");
+        if (!timeValue.isNull()) {
+            FluxDateTime time = timeValue.getDateTime();
+            point.timestamp = time.format("%Y-%m-%d %H:%M:%S");
+        }
+        FluxValue valueFlux = result.getValueByName("_value");
+        if (!valueFlux.isNull()) {
+            point.value = valueFlux.getDouble();
+        }
+        if (!point.timestamp.isEmpty()) {
+            points.push_back(point);
+        }
+    }
+    result.close();
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+static void report(const char* label, double ms, const HostHeapStats& heap) {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%s: %.0f rows/s (%.2f ms / %u rows), %u allocations, peak heap %u bytes", label,
+             ROWS * 1000.0 / ms, ms, (unsigned)ROWS, (unsigned)heap.allocations,
+             (unsigned)heap.peakBytes);
+    TEST_MESSAGE(line);
+}
+
+void setUp() { InfluxReplay::reset(); }
+
+void tearDown() {}
+
+void test_streaming_and_legacy_paths_agree() {
+    std::string csv = FluxFixture::rawSeries("instantaneous_power", START, INTERVAL, 100);
+    std::vector<DataPoint> points;
+    parseStreaming(csv, points);
+    std::vector<LegacyPoint> legacy;
+    InfluxReplay::queueResponse(csv);
+    parseLegacy(legacy);
+
+    TEST_ASSERT_EQUAL(100, points.size());
+    TEST_ASSERT_EQUAL(100, legacy.size());
+    TEST_ASSERT_EQUAL(START + INTERVAL, points[0].time);
+    TEST_ASSERT_EQUAL_STRING("2026-01-01 00:01:00", legacy[0].timestamp.c_str());
+    for (size_t i = 0; i < points.size(); i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, legacy[i].value, points[i].value);
+    }
+}
+
+void test_benchmark_parse_10k_rows() {
+    std::string csv = FluxFixture::rawSeries("instantaneous_power", START, INTERVAL, ROWS);
+
+    // 結果の格納先も含めて計測する（以前の経路は予約なし、現在の経路は行数分を予約）
+    double streamingMs = 1e9;
+    HostHeapStats streamingHeap = {};
+    for (int i = 0; i < REPEAT; i++) {
+        HostHeap::reset();
+        auto started = std::chrono::steady_clock::now();
+        std::vector<DataPoint> points;
+        points.reserve(ROWS);
+        parseStreaming(csv, points);
+        double ms = elapsedMs(started);
+        streamingHeap = HostHeap::stats();
+        TEST_ASSERT_EQUAL(ROWS, points.size());
+        if (ms < streamingMs) {
+            streamingMs = ms;
+        }
+    }
+
+    double legacyMs = 1e9;
+    HostHeapStats legacyHeap = {};
+    for (int i = 0; i < REPEAT; i++) {
+        // 応答の本文は受信済みとして計測に含めない（現在の経路も同じ）
+        InfluxReplay::queueResponse(csv);
+        HostHeap::reset();
+        auto started = std::chrono::steady_clock::now();
+        std::vector<LegacyPoint> points;
+        parseLegacy(points);
+        double ms = elapsedMs(started);
+        legacyHeap = HostHeap::stats();
+        TEST_ASSERT_EQUAL(ROWS, points.size());
+        if (ms < legacyMs) {
+            legacyMs = ms;
+        }
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "input: %u bytes of annotated CSV, %u-byte chunks",
+             (unsigned)csv.size(), (unsigned)CHUNK);
+    TEST_MESSAGE(line);
+    report("FluxCsvParser", streamingMs, streamingHeap);
+    report("String path  ", legacyMs, legacyHeap);
+    TEST_ASSERT_TRUE(streamingHeap.peakBytes < legacyHeap.peakBytes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_streaming_and_legacy_paths_agree);
+    RUN_TEST(test_benchmark_parse_10k_rows);
+    return UNITY_END();
+}
@@ -0,0 +1,301 @@
+// Fluxクエリの雛形（FluxTemplate）とまとめ実行（FluxBatch）の組み立て結果と応答の振り分け
+#include <unity.h>
+#include <Arduino.h>
+#include <FluxFixture.h>
+#include <InfluxReplay.h>
+#include <WiFi.h>
+#include <string>
+#include "../../src/backend/FluxBatch.h"
+#include "../../src/backend/FluxCsvParser.h"
+#include "../../src/backend/FluxTemplate.h"
+#include "../../src/backend/InfluxDBManager.h"
+
+static char buffer[4096];
+
+static std::string render(const char* source, const FluxParams& params) {
+    FluxTemplate queryTemplate;
+    TEST_ASSERT_TRUE(queryTemplate.compile(source));
+    FluxWriter out(buffer, sizeof(buffer));
+    queryTemplate.render(out, params);
+    TEST_ASSERT_FALSE(out.overflowed());
+    return out.c_str();
+}
+
+void setUp() {
+    InfluxReplay::reset();
+    WiFi.setStatus(WL_CONNECTED);
+}
+
+void tearDown() {}
+
+// --- FluxTemplate ---
+
+void test_name_placeholder() {
+    FluxParams params = {"series", nullptr, nullptr, nullptr, 0};
+    TEST_ASSERT_EQUAL_STRING("seriesData = from(bucket: \"hems\")",
+                             render("{name}Data = from(bucket: \"hems\")", params).c_str());
+}
+
+void test_start_and_stop_placeholders() {
+    FluxParams params = {nullptr, "-24h", "now()", nullptr, 0};
+    TEST_ASSERT_EQUAL_STRING("range(start: -24h, stop: now())",
+                             render("range(start: {start}, stop: {stop})", params).c_str());
+
+    FluxParams absolute = {nullptr, "1767225600", "1767312000", nullptr, 0};
+    TEST_ASSERT_EQUAL_STRING("range(start: 1767225600, stop: 1767312000)",
+                             render("range(start: {start}, stop: {stop})", absolute).c_str());
+}
+
+void test_every_placeholder() {
+    FluxParams params = {nullptr, nullptr, nullptr, nullptr, 120};
+    TEST_ASSERT_EQUAL_STRING(
+        "aggregateWindow(every: 120s, fn: mean, createEmpty: false)",
+        render("aggregateWindow(every: {every}s, fn: mean, createEmpty: false)", params).c_str());
+
+    FluxParams zero = {nullptr, nullptr, nullptr, nullptr, 0};
+    TEST_ASSERT_EQUAL_STRING("every: 0s", render("every: {every}s", zero).c_str());
+}
+
+void test_selector_placeholder() {
+    FluxParams params = {nullptr, nullptr, nullptr, "last", 0};
+    TEST_ASSERT_EQUAL_STRING("|> last()", render("|> {selector}()", params).c_str());
+}
+
+void test_repeated_placeholders() {
+    FluxParams params = {"tail", nullptr, nullptr, nullptr, 60};
+    TEST_ASSERT_EQUAL_STRING("tailData |> a(every: 60s), tailData |> b(every: 60s)",
+                             render("{name}Data |> a(every: {every}s), {name}Data |> b(every: {every}s)",
+                                    params)
+                                 .c_str());
+}
+
+void test_record_braces_and_unknown_names_are_kept() {
+    FluxParams params = {"series", nullptr, nullptr, nullptr, 0};
+    const char* source = "map(fn: (r) => ({r with _field: r._field + \"_mean\"})) {unknown} {name";
+    TEST_ASSERT_EQUAL_STRING(source, render(source, params).c_str());
+}
+
+void test_missing_value_renders_empty() {
+    FluxParams params = {nullptr, nullptr, nullptr, nullptr, 0};
+    TEST_ASSERT_EQUAL_STRING("range(start: , stop: )",
+                             render("range(start: {start}, stop: {stop})", params).c_str());
+}
+
+void test_too_many_placeholders_fail_to_compile() {
+    std::string source;
+    for (int i = 0; i < FluxTemplate::MAX_SEGMENTS; i++) {
+        source += "{name}";
+    }
+    FluxTemplate queryTemplate;
+    TEST_ASSERT_FALSE(queryTemplate.compile(source.c_str()));
+    TEST_ASSERT_FALSE(queryTemplate.isCompiled());
+
+    // 上限に収まる雛形で組み立て直せる
+    TEST_ASSERT_TRUE(queryTemplate.compile("{name}"));
+    TEST_ASSERT_TRUE(queryTemplate.isCompiled());
+}
+
+// --- FluxWriter ---
+
+void test_writer_exact_fit() {
+    char small[6];
+    FluxWriter out(small, sizeof(small));
+    out.append("abcde");
+    TEST_ASSERT_FALSE(out.overflowed());
+    TEST_ASSERT_EQUAL_STRING("abcde", out.c_str());
+    TEST_ASSERT_EQUAL(5, out.size());
+}
+
+void test_writer_overflow_keeps_written_text() {
+    char small[8];
+    FluxWriter out(small, sizeof(small));
+    out.append("abcd");
+    out.append("efgh");  // 終端の分を含めると9バイトで入らない
+    TEST_ASSERT_TRUE(out.overflowed());
+    TEST_ASSERT_EQUAL_STRING("abcd", out.c_str());
+
+    // 溢れた後の書き込みは入る長さでも捨てる（途中が欠けたクエリを作らない）
+    out.append("x");
+    out.appendInt(1);
+    TEST_ASSERT_EQUAL_STRING("abcd", out.c_str());
+    TEST_ASSERT_EQUAL(4, out.size());
+}
+
+void test_template_render_overflow() {
+    FluxTemplate queryTemplate;
+    TEST_ASSERT_TRUE(queryTemplate.compile("range(start: {start}, stop: {stop})"));
+    FluxParams params = {nullptr, "1767225600", "now()", nullptr, 0};
+    char small[24];
+    FluxWriter out(small, sizeof(small));
+    queryTemplate.render(out, params);
+    TEST_ASSERT_TRUE(out.overflowed());
+    TEST_ASSERT_EQUAL_STRING("range(start: 1767225600", out.c_str());
+}
+
+// --- FluxBatch ---
+
+void test_batch_build_exact_text() {
+    FluxTemplate series;
+    FluxTemplate edge;
+    TEST_ASSERT_TRUE(series.compile("{name}Data = from(bucket: \"hems\") |> range(start: {start}, "
+                                    "stop: {stop})\n{name}Data |> aggregateWindow(every: {every}s, "
+                                    "fn: mean, createEmpty: false)"));
+    TEST_ASSERT_TRUE(edge.compile("from(bucket: \"hems\") |> range(start: {start}, stop: {stop}) "
+                                  "|> {selector}()"));
+
+    FluxBatch batch;
+    batch.addImport("date");
+    batch.addImport("date");  // 同じimportは1回だけ書く
+    FluxParams tail = {"tail", "1767225600", "now()", nullptr, 120};
+    FluxParams latest = {"latest", "-1h", "now()", "last", 0};
+    FluxParams monthStart = {"monthStart", "date.truncate(t: now(), unit: 1mo)", "now()",
+                             "first", 0};
+    TEST_ASSERT_TRUE(batch.add(series, tail, nullptr, nullptr));
+    TEST_ASSERT_TRUE(batch.add(edge, latest, nullptr, nullptr));
+    TEST_ASSERT_TRUE(batch.add(edge, monthStart, nullptr, nullptr));
+    TEST_ASSERT_EQUAL(3, batch.size());
+
+    FluxWriter out(buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(batch.build(out));
+    TEST_ASSERT_EQUAL_STRING(
+        "import \"date\"\n"
+        "tailData = from(bucket: \"hems\") |> range(start: 1767225600, stop: now())\n"
+        "tailData |> aggregateWindow(every: 120s, fn: mean, createEmpty: false)"
+        " |> yield(name: \"tail\")\n"
+        "from(bucket: \"hems\") |> range(start: -1h, stop: now()) |> last()"
+        " |> yield(name: \"latest\")\n"
+        "from(bucket: \"hems\") |> range(start: date.truncate(t: now(), unit: 1mo), stop: now())"
+        " |> first() |> yield(name: \"monthStart\")\n",
+        out.c_str());
+}
+
+void test_batch_build_overflow() {
+    FluxTemplate edge;
+    TEST_ASSERT_TRUE(edge.compile("from(bucket: \"hems\") |> range(start: {start}) |> {selector}()"));
+    FluxBatch batch;
+    FluxParams latest = {"latest", "-1h", "now()", "last", 0};
+    batch.add(edge, latest, nullptr, nullptr);
+
+    char small[64];
+    FluxWriter out(small, sizeof(small));
+    TEST_ASSERT_FALSE(batch.build(out));
+    TEST_ASSERT_TRUE(out.overflowed());
+}
+
+void test_batch_part_limit() {
+    FluxTemplate edge;
+    TEST_ASSERT_TRUE(edge.compile("x"));
+    FluxBatch batch;
+    FluxParams params = {"p", nullptr, nullptr, nullptr, 0};
+    for (int i = 0; i < FluxBatch::MAX_PARTS; i++) {
+        TEST_ASSERT_TRUE(batch.add(edge, params, nullptr, nullptr));
+    }
+    TEST_ASSERT_FALSE(batch.add(edge, params, nullptr, nullptr));
+}
+
+struct RouteContext {
+    int valueColumn;
+    int rows;
+    float sum;
+};
+
+static void countRow(void* context, const FluxCsvParser& parser) {
+    RouteContext* ctx = (RouteContext*)context;
+    float value;
+    if (parser.getFloat(ctx->valueColumn, value)) {
+        ctx->rows++;
+        ctx->sum += value;
+    }
+}
+
+void test_batch_routes_rows_by_result_column() {
+    FluxTemplate edge;
+    TEST_ASSERT_TRUE(edge.compile("x"));
+    FluxCsvParser parser;
+    parser.begin();
+    int valueColumn = parser.addColumn("_value");
+    RouteContext latest = {valueColumn, 0, 0};
+    RouteContext monthStart = {valueColumn, 0, 0};
+
+    FluxBatch batch;
+    FluxParams latestParams = {"latest", nullptr, nullptr, nullptr, 0};
+    FluxParams monthStartParams = {"monthStart", nullptr, nullptr, nullptr, 0};
+    batch.add(edge, latestParams, countRow, &latest);
+    batch.add(edge, monthStartParams, countRow, &monthStart);
+    batch.attach(parser);
+
+    // テーブルごとにヘッダが付き、空行で区切られる（登録していないyield名の行は捨てる）
+    std::string csv = FluxFixture::singleValue("monthStart", 1767225600, 1000.0) +
+                      FluxFixture::singleValue("other", 1767225600, 5.0) +
+                      FluxFixture::singleValue("latest", 1767312000, 1234.5) +
+                      FluxFixture::singleValue("latest", 1767312060, 1235.5);
+    parser.feed(csv.data(), csv.size());
+    parser.finish();
+
+    TEST_ASSERT_FALSE(parser.hasError());
+    TEST_ASSERT_EQUAL(2, latest.rows);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2470.0f, latest.sum);
+    TEST_ASSERT_EQUAL(1, monthStart.rows);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1000.0f, monthStart.sum);
+}
+
+// --- InfluxDBManagerの雛形 ---
+
+// 起動直後の更新で送るスクリプト（既定の設定: 系列1つ、24h、集計間隔120秒）
+void test_manager_refresh_script() {
+    InfluxDBManager manager;
+    manager.connect();
+    int32_t now = (int32_t)time(nullptr);
+    InfluxReplay::queueResponse(FluxFixture::singleValue("latest", now, 1234.5) +
+                                FluxFixture::singleValue("monthStart", now, 1000.0));
+    SeriesSet series;
+    float usage = 0;
+    manager.refresh(24, series, usage);
+
+    TEST_ASSERT_EQUAL_STRING(
+        "import \"date\"\n"
+        "seriesData = from(bucket: \"hems\") |> range(start: -24h, stop: now())"
+        " |> filter(fn: (r) => (r[\"_measurement\"] == \"power\""
+        " and (r[\"_field\"] == \"instantaneous_power\")))\n"
+        "union(tables: ["
+        "seriesData |> aggregateWindow(every: 120s, fn: mean, createEmpty: false)"
+        " |> map(fn: (r) => ({r with _field: r._field + \"_mean\"})), "
+        "seriesData |> aggregateWindow(every: 120s, fn: min, createEmpty: false)"
+        " |> map(fn: (r) => ({r with _field: r._field + \"_min\"})), "
+        "seriesData |> aggregateWindow(every: 120s, fn: max, createEmpty: false)"
+        " |> map(fn: (r) => ({r with _field: r._field + \"_max\"}))])"
+        " |> keep(columns: [\"_time\", \"_field\", \"_value\"])"
+        " |> pivot(rowKey: [\"_time\"], columnKey: [\"_field\"], valueColumn: \"_value\")"
+        " |> yield(name: \"series\")\n"
+        "from(bucket: \"hems\") |> range(start: -1h, stop: now())"
+        " |> filter(fn: (r) => r[\"_measurement\"] == \"power\")"
+        " |> filter(fn: (r) => r[\"_field\"] == \"cumulative_energy\") |> last()"
+        " |> yield(name: \"latest\")\n"
+        "from(bucket: \"hems\") |> range(start: date.truncate(t: now(), unit: 1mo), stop: now())"
+        " |> filter(fn: (r) => r[\"_measurement\"] == \"power\")"
+        " |> filter(fn: (r) => r[\"_field\"] == \"cumulative_energy\") |> first()"
+        " |> yield(name: \"monthStart\")\n",
+        InfluxReplay::lastRequestBody().c_str());
+    TEST_ASSERT_EQUAL(1, InfluxReplay::requestCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_name_placeholder);
+    RUN_TEST(test_start_and_stop_placeholders);
+    RUN_TEST(test_every_placeholder);
+    RUN_TEST(test_selector_placeholder);
+    RUN_TEST(test_repeated_placeholders);
+    RUN_TEST(test_record_braces_and_unknown_names_are_kept);
+    RUN_TEST(test_missing_value_renders_empty);
+    RUN_TEST(test_too_many_placeholders_fail_to_compile);
+    RUN_TEST(test_writer_exact_fit);
+    RUN_TEST(test_writer_overflow_keeps_written_text);
+    RUN_TEST(test_template_render_overflow);
+    RUN_TEST(test_batch_build_exact_text);
+    RUN_TEST(test_batch_build_overflow);
+    RUN_TEST(test_batch_part_limit);
+    RUN_TEST(test_batch_routes_rows_by_result_column);
+    RUN_TEST(test_manager_refresh_script);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+// 解像度ピラミッドとM4の集約: 点の間隔が不均一な系列で欠損をまたいで線をつながないこと
+#include <unity.h>
+#include <vector>
+#include "../../src/frontend/Decimator.h"
+#include "../../src/frontend/SeriesPyramid.h"
+
+static const int32_t START = 1767225600;
+static const int INTERVAL = 60;
+
+static DataPoint point(int32_t time, float value) { return {time, value, value, value}; }
+
+// 1分間隔の点の途中に1日の欠損がある系列
+// 前半を奇数個にして、欠損がどのレベルでも区間の境界ではなく区間の中に入るようにする
+static std::vector<DataPoint> unevenSeries(size_t before, size_t after) {
+    std::vector<DataPoint> points;
+    for (size_t i = 0; i < before; i++) {
+        points.push_back(point(START + (int32_t)i * INTERVAL, 100));
+    }
+    int32_t resume = START + (int32_t)before * INTERVAL + 24 * 3600;
+    for (size_t i = 0; i < after; i++) {
+        points.push_back(point(resume + (int32_t)i * INTERVAL, 200));
+    }
+    return points;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_spans_record_the_largest_inner_gap() {
+    std::vector<DataPoint> points = unevenSeries(255, 256);
+    SeriesPyramid pyramid;
+    pyramid.build(points);
+    TEST_ASSERT_TRUE(pyramid.getLevelCount() > 3);
+
+    // 元の点の区間では最大の時刻差は点の間隔
+    const std::vector<SpanSample>& level1 = pyramid.getLevel(1);
+    TEST_ASSERT_EQUAL(INTERVAL, level1[0].maxGap);
+
+    // 欠損をまたぐ区間は欠損の長さを持ち、他の区間は点の間隔のまま
+    for (int level = 2; level < pyramid.getLevelCount(); level++) {
+        int32_t largest = 0;
+        for (const SpanSample& span : pyramid.getLevel(level)) {
+            if (span.maxGap > largest) {
+                largest = span.maxGap;
+            }
+            TEST_ASSERT_TRUE(span.maxGap == INTERVAL || span.maxGap > 24 * 3600);
+        }
+        TEST_ASSERT_TRUE(largest > 24 * 3600);
+    }
+}
+
+void test_extend_keeps_gap_of_appended_points() {
+    std::vector<DataPoint> points = unevenSeries(127, 128);
+    SeriesPyramid pyramid;
+    pyramid.build(points);
+
+    // 末尾に2時間の欠損を挟んで追加する
+    int32_t resume = points.back().time + 2 * 3600;
+    for (int i = 0; i < 4; i++) {
+        points.push_back(point(resume + i * INTERVAL, 300));
+    }
+    pyramid.extend(points);
+
+    const std::vector<SpanSample>& top = pyramid.getLevel(pyramid.getLevelCount() - 1);
+    TEST_ASSERT_EQUAL(points.back().time, top.back().endTime);
+    bool found = false;
+    for (const SpanSample& span : top) {
+        if (span.startTime < resume && span.endTime >= resume) {
+            TEST_ASSERT_TRUE(span.maxGap >= 2 * 3600);
+            found = true;
+        }
+    }
+    TEST_ASSERT_TRUE(found);
+}
+
+// 前後の区間の境界ではなく、区間の中に欠損がある場合
+void test_inner_gap_breaks_the_line() {
+    SpanSample spans[3];
+    int16_t xs[3] = {10, 11, 12};
+    float values[3] = {100, 200, 300};
+    for (int i = 0; i < 3; i++) {
+        spans[i].startTime = START + i * 600;
+        spans[i].endTime = spans[i].startTime + 540;
+        spans[i].maxGap = INTERVAL;
+        spans[i].first = spans[i].last = spans[i].minValue = spans[i].maxValue = values[i];
+        spans[i].rangeMin = spans[i].rangeMax = values[i];
+    }
+    std::vector<ColumnSample> columns;
+
+    Decimator::decimate(spans, xs, 3, 3 * INTERVAL, columns);
+    TEST_ASSERT_EQUAL(3, columns.size());
+    TEST_ASSERT_FALSE(columns[1].gapBefore);
+    TEST_ASSERT_FALSE(columns[2].gapBefore);
+
+    // 中央の区間が欠損をまたぐと、その列の前後の線を切る
+    spans[1].maxGap = 3600;
+    Decimator::decimate(spans, xs, 3, 3 * INTERVAL, columns);
+    TEST_ASSERT_TRUE(columns[1].gapBefore);
+    TEST_ASSERT_TRUE(columns[2].gapBefore);
+
+    // 判定しない設定ではつなぐ
+    Decimator::decimate(spans, xs, 3, 0, columns);
+    TEST_ASSERT_FALSE(columns[1].gapBefore);
+    TEST_ASSERT_FALSE(columns[2].gapBefore);
+}
+
+void test_inner_gap_merged_into_a_column() {
+    SpanSample spans[3];
+    int16_t xs[3] = {10, 10, 11};
+    for (int i = 0; i < 3; i++) {
+        spans[i].startTime = START + i * 600;
+        spans[i].endTime = spans[i].startTime + 540;
+        spans[i].maxGap = i == 1 ? 3600 : INTERVAL;
+        spans[i].first = spans[i].last = spans[i].minValue = spans[i].maxValue = 100;
+        spans[i].rangeMin = spans[i].rangeMax = 100;
+    }
+    std::vector<ColumnSample> columns;
+    Decimator::decimate(spans, xs, 3, 3 * INTERVAL, columns);
+    TEST_ASSERT_EQUAL(2, columns.size());
+    TEST_ASSERT_TRUE(columns[1].gapBefore);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_spans_record_the_largest_inner_gap);
+    RUN_TEST(test_extend_keeps_gap_of_appended_points);
+    RUN_TEST(test_inner_gap_breaks_the_line);
+    RUN_TEST(test_inner_gap_merged_into_a_column);
+    return UNITY_END();
+}
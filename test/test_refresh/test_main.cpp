@@ -0,0 +1,288 @@
+// InfluxDBManager::refresh()を記録済みの応答で実行し、取得範囲とヒープの使用量を確かめる
+#include <unity.h>
+#include <Arduino.h>
+#include <HostHeap.h>
+#include <env.h>
+#include <FluxFixture.h>
+#include <InfluxReplay.h>
+#include <SD_MMC.h>
+#include <stdlib.h>
+#include <string>
+#include "../../src/backend/InfluxDBManager.h"
+
+static const int HOURS = 24;
+static const int INTERVAL = 120;  // 24h / 1080px に対する集計間隔
+static const size_t ROWS = 24 * 3600 / INTERVAL + 2;
+static const std::vector<std::string> FIELDS = {"instantaneous_power"};
+
+static int32_t now() { return (int32_t)time(nullptr); }
+
+static int32_t monthStartOf(int32_t epoch) {
+    time_t t = epoch;
+    struct tm value;
+    gmtime_r(&t, &value);
+    value.tm_mday = 1;
+    value.tm_hour = value.tm_min = value.tm_sec = 0;
+    return (int32_t)timegm(&value);
+}
+
+static bool contains(const std::string& text, const char* part) {
+    return text.find(part) != std::string::npos;
+}
+
+// 起動直後の1回目（表示範囲全体と月間使用量の両端）の応答
+static int32_t queueColdResponse() {
+    int32_t newest = now() / INTERVAL * INTERVAL;
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("series", FIELDS, newest - (int32_t)ROWS * INTERVAL, INTERVAL, ROWS) +
+        FluxFixture::singleValue("latest", now(), 1234.5) +
+        FluxFixture::singleValue("monthStart", monthStartOf(now()), 1000.0));
+    return newest;
+}
+
+// ロールアップの表示範囲（1m）と、そのレベル（15分）
+static const int ROLLUP_HOURS = 720;
+static const int BUCKET = 900;
+static const int32_t DAY = 86400;
+
+// 1分値を取得する範囲の開始（前日の0時）
+static int32_t minuteStart() { return now() / DAY * DAY - DAY; }
+
+static std::string number(int32_t value) { return std::to_string(value); }
+
+// 初回: 前日の0時からの1分値、2回目: 表示範囲（30日）の開始の日までの15分のバケット
+static void refreshRollupWithBackfill(InfluxDBManager& manager) {
+    int32_t from = minuteStart();
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("series", FIELDS, from, 60, (size_t)(now() - from) / 60));
+    SeriesSet series = manager.getData(ROLLUP_HOURS);
+    TEST_ASSERT_FALSE(series.empty() || series[0].empty());
+    TEST_ASSERT_TRUE(manager.hasPendingBackfill(ROLLUP_HOURS));
+
+    int32_t headFrom = from - 29 * DAY;
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("head", FIELDS, headFrom, BUCKET, 29 * DAY / BUCKET, true));
+    manager.getData(ROLLUP_HOURS);
+}
+
+void setUp() {
+    InfluxReplay::reset();
+    WiFi.setStatus(WL_CONNECTED);
+}
+
+void tearDown() {}
+
+void test_cold_refresh_fetches_window_and_month_in_one_request() {
+    InfluxDBManager manager;
+    manager.connect();
+    int32_t newest = queueColdResponse();
+
+    SeriesSet series;
+    float usage = 0;
+    TEST_ASSERT_TRUE(manager.refresh(HOURS, series, usage));
+    TEST_ASSERT_TRUE(manager.lastRefreshSucceeded());
+
+    TEST_ASSERT_EQUAL(1, InfluxReplay::requestCount());
+    const std::string& query = InfluxReplay::lastRequestBody();
+    TEST_ASSERT_TRUE(contains(query, "import \"date\""));
+    TEST_ASSERT_TRUE(contains(query, "range(start: -24h, stop: now())"));
+    TEST_ASSERT_TRUE(contains(query, "every: 120s"));
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"series\")"));
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"latest\")"));
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"monthStart\")"));
+    TEST_ASSERT_EQUAL_STRING("Token host-token", InfluxReplay::lastAuthorization().c_str());
+
+    // 先頭のウィンドウは範囲の開始で切れているので捨てられる
+    TEST_ASSERT_EQUAL(1, series.size());
+    TEST_ASSERT_EQUAL(ROWS - 1, series[0].size());
+    TEST_ASSERT_EQUAL(newest, series[0].back().time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, FluxFixture::valueAt(ROWS - 1), series[0].back().value);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 234.5f, usage);
+}
+
+void test_next_refresh_fetches_only_the_tail() {
+    InfluxDBManager manager;
+    manager.connect();
+    int32_t newest = queueColdResponse();
+    SeriesSet series;
+    float usage = 0;
+    TEST_ASSERT_TRUE(manager.refresh(HOURS, series, usage));
+
+    // 更新間隔が過ぎたら、最後のウィンドウ以降と最新の積算値のみを取得する
+    HostClock::advance(DATA_INTERVAL_MINUTES * 60 * 1000UL + 1000);
+    InfluxReplay::queueResponse(FluxFixture::pivotedSeries("tail", FIELDS, newest - INTERVAL, INTERVAL, 3) +
+                                FluxFixture::singleValue("latest", now(), 1240.0));
+    TEST_ASSERT_TRUE(manager.refresh(HOURS, series, usage));
+
+    const std::string& query = InfluxReplay::lastRequestBody();
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"tail\")"));
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"latest\")"));
+    TEST_ASSERT_FALSE(contains(query, "yield(name: \"series\")"));
+    TEST_ASSERT_FALSE(contains(query, "yield(name: \"head\")"));
+    TEST_ASSERT_FALSE(contains(query, "yield(name: \"monthStart\")"));
+
+    TEST_ASSERT_EQUAL(newest + 2 * INTERVAL, series[0].back().time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 240.0f, usage);
+}
+
+void test_query_error_is_reported() {
+    InfluxDBManager manager;
+    manager.connect();
+    InfluxReplay::queueResponse("{\"code\":\"unauthorized\"}", 401);
+
+    SeriesSet series;
+    float usage = 0;
+    manager.refresh(HOURS, series, usage);
+    TEST_ASSERT_FALSE(manager.lastRefreshSucceeded());
+    TEST_ASSERT_TRUE(series.empty() || series[0].empty());
+}
+
+void test_disconnected_wifi_skips_the_query() {
+    InfluxDBManager manager;
+    manager.connect();
+    WiFi.setStatus(WL_DISCONNECTED);
+
+    SeriesSet series;
+    float usage = 0;
+    TEST_ASSERT_FALSE(manager.refresh(HOURS, series, usage));
+    TEST_ASSERT_EQUAL(0, InfluxReplay::requestCount());
+}
+
+void test_rollup_fetches_minutes_for_two_days_and_buckets_before() {
+    InfluxDBManager manager;
+    manager.connect();
+    int32_t from = minuteStart();
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("series", FIELDS, from, 60, (size_t)(now() - from) / 60));
+    manager.getData(ROLLUP_HOURS);
+
+    const std::string first = InfluxReplay::lastRequestBody();
+    TEST_ASSERT_TRUE(contains(first, ("range(start: " + number(from) + ", stop: now())").c_str()));
+    TEST_ASSERT_TRUE(contains(first, "every: 60s"));
+    TEST_ASSERT_FALSE(contains(first, "fn: count"));
+    TEST_ASSERT_TRUE(manager.hasPendingBackfill(ROLLUP_HOURS));
+
+    // 1分値の保持期間より前は、15分のバケットを平均/最小/最大/件数で直接取得する
+    // （表示範囲の開始を含む日まで）
+    int32_t headFrom = from - 29 * DAY;
+    size_t rows = 29 * DAY / BUCKET;
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("head", FIELDS, headFrom, BUCKET, rows, true));
+    SeriesSet series = manager.getData(ROLLUP_HOURS);
+
+    const std::string& head = InfluxReplay::lastRequestBody();
+    TEST_ASSERT_EQUAL(2, InfluxReplay::requestCount());
+    TEST_ASSERT_TRUE(contains(head, ("range(start: " + number(headFrom) + ", stop: " +
+                                     number(from) + ")").c_str()));
+    TEST_ASSERT_TRUE(contains(head, "every: 900s, fn: count"));
+    TEST_ASSERT_FALSE(contains(head, "every: 60s"));
+    TEST_ASSERT_FALSE(manager.hasPendingBackfill(ROLLUP_HOURS));
+
+    // 表示範囲は15分のレベルから切り出され、取得したバケットの平均がそのまま残る
+    TEST_ASSERT_EQUAL(1, series.size());
+    TEST_ASSERT_EQUAL(BUCKET, series[0][1].time - series[0][0].time);
+    bool found = false;
+    for (const auto& point : series[0]) {
+        if (point.time == from) {
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, FluxFixture::valueAt(rows - 1), point.value);
+            found = true;
+        }
+    }
+    TEST_ASSERT_TRUE(found);
+}
+
+void test_rollup_levels_are_restored_from_store() {
+    char dir[] = "/tmp/rollup_store_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    int32_t from = minuteStart();
+    {
+        SeriesStore store;
+        TEST_ASSERT_TRUE(store.begin(dir));
+        InfluxDBManager manager;
+        manager.setSeriesStore(&store);
+        manager.connect();
+        refreshRollupWithBackfill(manager);
+    }
+
+    // 再起動後: 保存データだけで表示でき、更新は今日の0時以降の1分値のみを取得する
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(dir));
+    InfluxDBManager manager;
+    manager.setSeriesStore(&store);
+    manager.connect();
+    size_t requests = InfluxReplay::requestCount();
+    SeriesSet stored = manager.getStoredData(ROLLUP_HOURS);
+    TEST_ASSERT_EQUAL(requests, InfluxReplay::requestCount());
+    TEST_ASSERT_FALSE(stored.empty() || stored[0].empty());
+    TEST_ASSERT_TRUE(stored[0].front().time <= now() - ROLLUP_HOURS * 3600 + BUCKET);
+    TEST_ASSERT_FALSE(manager.hasPendingBackfill(ROLLUP_HOURS));
+
+    int32_t today = from + DAY;
+    InfluxReplay::queueResponse(
+        FluxFixture::pivotedSeries("tail", FIELDS, today, 60, (size_t)(now() - today) / 60));
+    SeriesSet series = manager.getData(ROLLUP_HOURS);
+    const std::string& query = InfluxReplay::lastRequestBody();
+    TEST_ASSERT_TRUE(contains(query, ("range(start: " + number(today) + ", stop: now())").c_str()));
+    TEST_ASSERT_TRUE(contains(query, "yield(name: \"tail\")"));
+    TEST_ASSERT_FALSE(contains(query, "yield(name: \"head\")"));
+    TEST_ASSERT_TRUE(series[0].front().time <= now() - ROLLUP_HOURS * 3600 + BUCKET);
+    TEST_ASSERT_TRUE(series[0].back().time >= now() - 60);
+
+    std::string command = std::string("rm -rf ") + dir;
+    TEST_ASSERT_EQUAL(0, system(command.c_str()));
+}
+
+// 1回の更新あたりのヒープの確保回数と使用量のピーク（定常状態の末尾の更新）
+void test_benchmark_refresh_heap_churn() {
+    InfluxDBManager manager;
+    manager.connect();
+    int32_t newest = queueColdResponse();
+    SeriesSet series;
+    float usage = 0;
+
+    HostHeap::reset();
+    TEST_ASSERT_TRUE(manager.refresh(HOURS, series, usage));
+    HostHeapStats cold = HostHeap::stats();
+
+    const int REFRESHES = 20;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    size_t peak = 0;
+    for (int i = 0; i < REFRESHES; i++) {
+        HostClock::advance(DATA_INTERVAL_MINUTES * 60 * 1000UL + 1000);
+        InfluxReplay::queueResponse(
+            FluxFixture::pivotedSeries("tail", FIELDS, newest - INTERVAL, INTERVAL, 3) +
+            FluxFixture::singleValue("latest", now(), 1240.0 + i));
+        newest += 2 * INTERVAL;
+
+        HostHeap::reset();
+        TEST_ASSERT_TRUE(manager.refresh(HOURS, series, usage));
+        HostHeapStats stats = HostHeap::stats();
+        allocations += stats.allocations;
+        bytes += stats.allocatedBytes;
+        if (stats.peakBytes > peak) {
+            peak = stats.peakBytes;
+        }
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "cold refresh (%u rows): %u allocations, %u bytes, peak %u bytes",
+             (unsigned)ROWS, (unsigned)cold.allocations, (unsigned)cold.allocatedBytes,
+             (unsigned)cold.peakBytes);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "tail refresh: %.1f allocations, %.0f bytes per refresh, peak %u bytes",
+             (double)allocations / REFRESHES, (double)bytes / REFRESHES, (unsigned)peak);
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_cold_refresh_fetches_window_and_month_in_one_request);
+    RUN_TEST(test_next_refresh_fetches_only_the_tail);
+    RUN_TEST(test_query_error_is_reported);
+    RUN_TEST(test_disconnected_wifi_skips_the_query);
+    RUN_TEST(test_rollup_fetches_minutes_for_two_days_and_buckets_before);
+    RUN_TEST(test_rollup_levels_are_restored_from_store);
+    RUN_TEST(test_benchmark_refresh_heap_churn);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// GraphRendererの描画呼び出しを数え、変更の無い領域を描き直さないことを確かめる
+#include <unity.h>
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <FluxFixture.h>
+#include "../../src/frontend/GraphRenderer.h"
+
+static const int INTERVAL = 120;
+static const size_t POINTS = 24 * 3600 / INTERVAL;
+
+static SeriesSet makeSeries(int32_t newest) {
+    SeriesSet set(1);
+    for (size_t i = 0; i < POINTS; i++) {
+        float value = FluxFixture::valueAt(i);
+        set[0].push_back({newest - (int32_t)(POINTS - 1 - i) * INTERVAL, value, value - 50,
+                          value + 50});
+    }
+    return set;
+}
+
+static DrawStats drawAndCount(GraphRenderer& renderer) {
+    LovyanGFX::resetAllDrawStats();
+    M5.Display.resetDrawStats();
+    renderer.draw();
+    return LovyanGFX::getAllDrawStats();
+}
+
+static void printStats(const char* label, const DrawStats& stats) {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%s: %u lines, %u fast lines, %u rects, %u texts, %u pushes (%u calls)", label,
+             (unsigned)stats.lines, (unsigned)stats.fastLines, (unsigned)stats.rects,
+             (unsigned)stats.texts, (unsigned)stats.pushes, (unsigned)stats.total());
+    TEST_MESSAGE(line);
+}
+
+void setUp() { M5.Display.fillScreen(TFT_BLACK); }
+
+void tearDown() {}
+
+void test_first_draw_paints_chrome_and_plot() {
+    GraphRenderer renderer;
+    int32_t now = (int32_t)time(nullptr);
+    renderer.setData(makeSeries(now), INTERVAL);
+
+    DrawStats stats = drawAndCount(renderer);
+    printStats("first draw", stats);
+    TEST_ASSERT_EQUAL(1, stats.pushes);
+    // データ線はグラフ幅（1080列）の列ごとに高々1本
+    TEST_ASSERT_TRUE(stats.lines <= 1080 + 16);
+    TEST_ASSERT_TRUE(stats.lines >= POINTS / 2);
+}
+
+void test_redraw_without_changes_draws_nothing() {
+    GraphRenderer renderer;
+    renderer.setData(makeSeries((int32_t)time(nullptr)), INTERVAL);
+    renderer.draw();
+
+    DrawStats stats = drawAndCount(renderer);
+    TEST_ASSERT_EQUAL(0, stats.total());
+}
+
+void test_live_point_redraws_only_the_plot() {
+    GraphRenderer renderer;
+    int32_t now = (int32_t)time(nullptr);
+    renderer.setData(makeSeries(now - INTERVAL), INTERVAL);
+    renderer.draw();
+
+    std::vector<LivePoint> live = {{0, {now, 500, 500, 500}}};
+    TEST_ASSERT_TRUE(renderer.appendLivePoints(live));
+    DrawStats stats = drawAndCount(renderer);
+    printStats("live point", stats);
+    // グラフ領域を1回転送するだけで、画面全体の塗りつぶしやボタンは描き直さない
+    TEST_ASSERT_EQUAL(1, stats.pushes);
+    TEST_ASSERT_EQUAL(0, M5.Display.getDrawStats().rects);
+}
+
+void test_plot_reaches_the_display() {
+    GraphRenderer renderer;
+    renderer.setData(makeSeries((int32_t)time(nullptr)), INTERVAL);
+    renderer.draw();
+
+    // グラフ領域内に主系列の色（黄）の画素がある
+    size_t yellow = 0;
+    for (int y = 120; y < 520; y++) {
+        for (int x = 100; x < 1180; x++) {
+            if (M5.Display.readPixel(x, y) == TFT_YELLOW) {
+                yellow++;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(yellow > 1000);
+}
+
+// 自動スケールは表示範囲外の点（保持している古いピーク）を含めない
+void test_auto_scale_uses_visible_points() {
+    GraphRenderer renderer;
+    int32_t now = (int32_t)time(nullptr);
+    SeriesSet set(1);
+    set[0].push_back({now - 30 * 3600, 3000, 3000, 3000});
+    for (size_t i = 0; i < POINTS; i++) {
+        set[0].push_back({now - (int32_t)(POINTS - 1 - i) * INTERVAL, 200, 200, 200});
+    }
+    renderer.setData(set, INTERVAL);
+    renderer.draw();
+
+    // 0〜500Wの軸なら200Wの線はグラフ領域の下から4割の高さ（y=360付近）に来る
+    int top = 720;
+    for (int y = 120; y < 520; y++) {
+        for (int x = 200; x < 1180 && top == 720; x++) {
+            if (M5.Display.readPixel(x, y) == TFT_YELLOW) {
+                top = y;
+            }
+        }
+    }
+    TEST_ASSERT_INT_WITHIN(3, 360, top);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_draw_paints_chrome_and_plot);
+    RUN_TEST(test_redraw_without_changes_draws_nothing);
+    RUN_TEST(test_live_point_redraws_only_the_plot);
+    RUN_TEST(test_plot_reaches_the_display);
+    RUN_TEST(test_auto_scale_uses_visible_points);
+    return UNITY_END();
+}
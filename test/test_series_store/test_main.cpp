@@ -0,0 +1,236 @@
+// SeriesStore: 末尾の切れたファイルの復旧、上限件数での詰め直し、先頭への追加、読み出しでファイルを作らないこと
+#include <unity.h>
+#include <Arduino.h>
+#include <SD_MMC.h>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../../src/backend/SeriesStore.h"
+
+static const int INTERVAL = 60;
+static const int32_t START = 1767225600;  // 2026-01-01T00:00:00Z
+static const size_t HEADER_SIZE = 16;
+
+static std::string mountPoint;
+static uint32_t id;
+
+static std::vector<DataPoint> makePoints(size_t from, size_t count) {
+    std::vector<DataPoint> points;
+    for (size_t i = from; i < from + count; i++) {
+        float value = (float)i;
+        points.push_back({START + (int32_t)i * INTERVAL, value, value - 1, value + 1});
+    }
+    return points;
+}
+
+static std::string path(const char* extension) {
+    char name[32];
+    snprintf(name, sizeof(name), "/hems/%08lx_%d%s", (unsigned long)id, INTERVAL, extension);
+    return mountPoint + name;
+}
+
+static long fileSize(const std::string& file) {
+    struct stat info;
+    return stat(file.c_str(), &info) == 0 ? (long)info.st_size : -1;
+}
+
+static int countFiles() {
+    DIR* dir = opendir((mountPoint + "/hems").c_str());
+    int count = 0;
+    while (struct dirent* item = readdir(dir)) {
+        if (item->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void appendBytes(const std::string& file, const char* bytes, size_t length) {
+    FILE* handle = fopen(file.c_str(), "ab");
+    fwrite(bytes, 1, length, handle);
+    fclose(handle);
+}
+
+// 保存済みの点を順に読み出し、時刻と値が連続していることを確かめる
+static void assertStored(SeriesStore& store, size_t from, size_t count) {
+    int32_t oldest, newest;
+    TEST_ASSERT_TRUE(store.getRange(id, INTERVAL, oldest, newest));
+    TEST_ASSERT_EQUAL(START + (int32_t)from * INTERVAL, oldest);
+    TEST_ASSERT_EQUAL(START + (int32_t)(from + count - 1) * INTERVAL, newest);
+
+    std::vector<DataPoint> out;
+    TEST_ASSERT_EQUAL(count, store.read(id, INTERVAL, oldest, newest, out));
+    for (size_t i = 0; i < out.size(); i++) {
+        TEST_ASSERT_EQUAL(START + (int32_t)(from + i) * INTERVAL, out[i].time);
+    }
+
+    // 途中から読み出す（索引の二分探索）
+    size_t middle = from + count / 2;
+    int32_t start = START + (int32_t)middle * INTERVAL;
+    TEST_ASSERT_EQUAL(from + count - middle, store.read(id, INTERVAL, start, newest, out));
+    TEST_ASSERT_EQUAL(start, out[0].time);
+}
+
+void setUp() {
+    char dir[] = "/tmp/series_store_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    mountPoint = dir;
+    id = SeriesStore::seriesId("power/instantaneous_power");
+}
+
+void tearDown() {
+    std::string command = "rm -rf " + mountPoint;
+    TEST_ASSERT_EQUAL(0, system(command.c_str()));
+}
+
+void test_append_and_read_back() {
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    TEST_ASSERT_EQUAL(200, store.append(id, INTERVAL, makePoints(0, 200)));
+    // 保存済みの末尾以前の点は追記しない
+    TEST_ASSERT_EQUAL(50, store.append(id, INTERVAL, makePoints(150, 100)));
+    assertStored(store, 0, 250);
+
+    SeriesStore reopened;
+    TEST_ASSERT_TRUE(reopened.begin(mountPoint.c_str()));
+    assertStored(reopened, 0, 250);
+}
+
+void test_read_only_lookups_do_not_create_files() {
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+
+    int32_t oldest, newest;
+    std::vector<DataPoint> out;
+    TEST_ASSERT_FALSE(store.getRange(id, INTERVAL, oldest, newest));
+    TEST_ASSERT_EQUAL(0, store.read(id, INTERVAL, START, START + 3600, out));
+    TEST_ASSERT_EQUAL(0, countFiles());
+
+    // ファイルは最初の追記で作る
+    TEST_ASSERT_EQUAL(10, store.append(id, INTERVAL, makePoints(0, 10)));
+    TEST_ASSERT_EQUAL((long)(HEADER_SIZE + 10 * sizeof(DataPoint)), fileSize(path(".bin")));
+}
+
+void test_torn_record_keeps_history() {
+    {
+        SeriesStore store;
+        TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+        TEST_ASSERT_EQUAL(300, store.append(id, INTERVAL, makePoints(0, 300)));
+    }
+    // 書き込み途中で切れたレコード
+    appendBytes(path(".bin"), "\x01\x02\x03\x04\x05\x06\x07", 7);
+
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    assertStored(store, 0, 300);
+    TEST_ASSERT_EQUAL((long)(HEADER_SIZE + 300 * sizeof(DataPoint)), fileSize(path(".bin")));
+    TEST_ASSERT_EQUAL((long)((300 + 63) / 64 * sizeof(int32_t)), fileSize(path(".idx")));
+
+    // 切り詰めた後の追記はレコードの境界から続く
+    TEST_ASSERT_EQUAL(20, store.append(id, INTERVAL, makePoints(300, 20)));
+    assertStored(store, 0, 320);
+
+    SeriesStore reopened;
+    TEST_ASSERT_TRUE(reopened.begin(mountPoint.c_str()));
+    assertStored(reopened, 0, 320);
+}
+
+void test_invalid_header_is_replaced_only_on_append() {
+    {
+        SeriesStore store;
+        TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+        store.append(id, INTERVAL, makePoints(0, 10));
+    }
+    // 集計間隔が異なるヘッダ
+    FILE* handle = fopen(path(".bin").c_str(), "r+b");
+    int32_t interval = INTERVAL * 2;
+    fseek(handle, 8, SEEK_SET);
+    fwrite(&interval, sizeof(interval), 1, handle);
+    fclose(handle);
+    long size = fileSize(path(".bin"));
+
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    int32_t oldest, newest;
+    TEST_ASSERT_FALSE(store.getRange(id, INTERVAL, oldest, newest));
+    TEST_ASSERT_EQUAL(size, fileSize(path(".bin")));
+
+    TEST_ASSERT_EQUAL(5, store.append(id, INTERVAL, makePoints(100, 5)));
+    assertStored(store, 100, 5);
+}
+
+void test_record_limit_drops_oldest_records() {
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    store.setRecordLimit(200);
+
+    TEST_ASSERT_EQUAL(190, store.append(id, INTERVAL, makePoints(0, 190)));
+    assertStored(store, 0, 190);
+
+    // 上限を超える追記で上限の3/4（追記分を含む）まで詰め直す
+    TEST_ASSERT_EQUAL(20, store.append(id, INTERVAL, makePoints(190, 20)));
+    assertStored(store, 60, 150);
+    TEST_ASSERT_EQUAL((long)(HEADER_SIZE + 150 * sizeof(DataPoint)), fileSize(path(".bin")));
+    TEST_ASSERT_EQUAL(-1, fileSize(path(".tmp")));
+
+    SeriesStore reopened;
+    TEST_ASSERT_TRUE(reopened.begin(mountPoint.c_str()));
+    assertStored(reopened, 60, 150);
+
+    // 1回で上限を超える追記は新しい側のみを残す
+    TEST_ASSERT_EQUAL(200, store.append(id, INTERVAL, makePoints(1000, 500)));
+    assertStored(store, 1300, 200);
+}
+
+void test_prepend_adds_older_records() {
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    TEST_ASSERT_EQUAL(100, store.append(id, INTERVAL, makePoints(200, 100)));
+
+    // 保存済みの先頭以降の点は飛ばす
+    TEST_ASSERT_EQUAL(150, store.prepend(id, INTERVAL, makePoints(50, 200)));
+    assertStored(store, 50, 250);
+    TEST_ASSERT_EQUAL(0, store.prepend(id, INTERVAL, makePoints(60, 10)));
+    TEST_ASSERT_EQUAL(-1, fileSize(path(".tmp")));
+
+    // 上限に入りきらない古い点は捨てる
+    store.setRecordLimit(260);
+    TEST_ASSERT_EQUAL(10, store.prepend(id, INTERVAL, makePoints(0, 50)));
+    assertStored(store, 40, 260);
+
+    // 追記は先頭に追加した後も続けられる
+    store.setRecordLimit(SeriesStore::DEFAULT_MAX_RECORDS);
+    TEST_ASSERT_EQUAL(5, store.append(id, INTERVAL, makePoints(300, 5)));
+    SeriesStore reopened;
+    TEST_ASSERT_TRUE(reopened.begin(mountPoint.c_str()));
+    assertStored(reopened, 40, 265);
+}
+
+void test_interrupted_rewrite_uses_the_new_file() {
+    {
+        SeriesStore store;
+        TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+        store.append(id, INTERVAL, makePoints(0, 100));
+    }
+    // 古いファイルを消した後、改名の前に止まった状態
+    TEST_ASSERT_EQUAL(0, rename(path(".bin").c_str(), path(".tmp").c_str()));
+
+    SeriesStore store;
+    TEST_ASSERT_TRUE(store.begin(mountPoint.c_str()));
+    assertStored(store, 0, 100);
+    TEST_ASSERT_EQUAL(-1, fileSize(path(".tmp")));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_read_back);
+    RUN_TEST(test_read_only_lookups_do_not_create_files);
+    RUN_TEST(test_torn_record_keeps_history);
+    RUN_TEST(test_invalid_header_is_replaced_only_on_append);
+    RUN_TEST(test_record_limit_drops_oldest_records);
+    RUN_TEST(test_prepend_adds_older_records);
+    RUN_TEST(test_interrupted_rewrite_uses_the_new_file);
+    return UNITY_END();
+}
@@ -0,0 +1,32 @@
+// TokenAuth: Authorizationヘッダの値の形式とトークンの比較（ホストのトークンは"host-token"）
+#include <unity.h>
+#include "../../src/common/TokenAuth.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_matching_token_is_accepted() {
+    TEST_ASSERT_TRUE(TokenAuth::check(" Token host-token"));
+    TEST_ASSERT_TRUE(TokenAuth::check("\ttoken   host-token \t"));
+}
+
+void test_other_forms_are_rejected() {
+    TEST_ASSERT_FALSE(TokenAuth::check(""));
+    TEST_ASSERT_FALSE(TokenAuth::check(" host-token"));
+    TEST_ASSERT_FALSE(TokenAuth::check(" Bearer host-token"));
+    TEST_ASSERT_FALSE(TokenAuth::check(" Token "));
+}
+
+void test_wrong_token_is_rejected() {
+    TEST_ASSERT_FALSE(TokenAuth::check(" Token host-tokeN"));
+    TEST_ASSERT_FALSE(TokenAuth::check(" Token host-token2"));
+    TEST_ASSERT_FALSE(TokenAuth::check(" Token host"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matching_token_is_accepted);
+    RUN_TEST(test_other_forms_are_rejected);
+    RUN_TEST(test_wrong_token_is_rejected);
+    return UNITY_END();
+}